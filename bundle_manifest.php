@@ -0,0 +1,99 @@
+<?php
+// bundle_manifest.php
+// Shared helpers for published plugin bundles (see publish_bundles.php and download.php).
+//
+// Bundles are published into downloads/bundles/<sha256 prefix>/<name>.zip, so a
+// bundle's URL changes whenever its content does and the files can be cached forever.
+// downloads/manifest.json maps each bundle name to its current file, size and
+// checksum, plus optional deltas from earlier versions.
+
+define('BUNDLE_MANIFEST_VERSION', 1);
+define('BUNDLE_DIR', __DIR__ . '/downloads');
+define('BUNDLE_MANIFEST_FILE', BUNDLE_DIR . '/manifest.json');
+
+// Bundle names are used in paths and URLs
+function is_valid_bundle_name($name) {
+    return is_string($name) && preg_match('/^[A-Za-z0-9][A-Za-z0-9._-]{0,127}$/', $name) === 1;
+}
+
+function load_bundle_manifest() {
+    if (!file_exists(BUNDLE_MANIFEST_FILE)) {
+        return ['version' => BUNDLE_MANIFEST_VERSION, 'bundles' => []];
+    }
+    $manifest = json_decode(file_get_contents(BUNDLE_MANIFEST_FILE), true);
+    if (!is_array($manifest) || ($manifest['version'] ?? null) !== BUNDLE_MANIFEST_VERSION) {
+        error_log("bundle_manifest: ignoring unreadable or outdated manifest");
+        return ['version' => BUNDLE_MANIFEST_VERSION, 'bundles' => []];
+    }
+    $manifest['bundles'] = $manifest['bundles'] ?? [];
+    return $manifest;
+}
+
+// Write the manifest atomically so downloads never see a half-written file
+function save_bundle_manifest($manifest) {
+    $json = json_encode($manifest, JSON_PRETTY_PRINT | JSON_UNESCAPED_SLASHES);
+    if ($json === false) {
+        throw new Exception("JSON encoding failed: " . json_last_error_msg());
+    }
+    $tmp = BUNDLE_MANIFEST_FILE . '.' . getmypid() . '.tmp';
+    if (file_put_contents($tmp, $json . "\n") === false || !rename($tmp, BUNDLE_MANIFEST_FILE)) {
+        @unlink($tmp);
+        throw new Exception("Could not write " . BUNDLE_MANIFEST_FILE);
+    }
+}
+
+// Look up the current published version of a bundle, or null
+function find_bundle($name) {
+    if (!is_valid_bundle_name($name)) {
+        return null;
+    }
+    $manifest = load_bundle_manifest();
+    $bundle = $manifest['bundles'][$name] ?? null;
+    if (!$bundle || !is_file(BUNDLE_DIR . '/' . $bundle['file'])) {
+        return null;
+    }
+    return $bundle;
+}
+
+// Check that a file is a real zip archive, not a renamed placeholder.
+// Returns null if valid, otherwise the reason it was rejected.
+function zip_validation_error($path) {
+    $size = @filesize($path);
+    if ($size === false) {
+        return 'unreadable';
+    }
+    // Local file header + end of central directory record at minimum
+    if ($size < 30 + 22) {
+        return "too small for a zip archive ($size bytes)";
+    }
+
+    if (class_exists('ZipArchive')) {
+        $zip = new ZipArchive();
+        $result = $zip->open($path, ZipArchive::CHECKCONS);
+        if ($result !== true) {
+            return "not a valid zip archive (ZipArchive error $result)";
+        }
+        $entries = $zip->numFiles;
+        $zip->close();
+        return $entries > 0 ? null : 'empty zip archive';
+    }
+
+    // Without the zip extension: check the signatures at both ends
+    $fh = fopen($path, 'rb');
+    if (!$fh) {
+        return 'unreadable';
+    }
+    $head = fread($fh, 4);
+    $tailLength = min($size, 22 + 65535);
+    fseek($fh, -$tailLength, SEEK_END);
+    $tail = fread($fh, $tailLength);
+    fclose($fh);
+
+    if ($head !== "PK\x03\x04") {
+        return 'missing zip header';
+    }
+    if (strrpos($tail, "PK\x05\x06") === false) {
+        return 'missing zip central directory';
+    }
+    return null;
+}
@@ -17,6 +17,11 @@ return [
     // Admin Notification Email
     'ADMIN_EMAIL' => 'admin@gradientsound.shop',
 
+    // Plugin Downloads (download.php)
+    // 'redirect' (default) lets the web server send bundles itself;
+    // 'stream' sends them through PHP, for hosts where downloads/ is not public
+    // 'DOWNLOAD_MODE' => 'redirect',
+
     // GitHub Delivery (Optional - Can also be set in Admin Dashboard)
     // 'GITHUB_PAT' => 'ghp_xxxxxxxxxxxxxxxxxxxx',
     // 'GITHUB_REPO' => 'username/repository',
@@ -0,0 +1,171 @@
+<?php
+// download.php
+// Delivers a published plugin bundle: download.php?bundle=rhythm_engine_vst3
+//
+// By default this redirects to the bundle's content-addressed file, which the web
+// server sends itself (with Range/resume support and long-lived caching), so a
+// download costs a PHP worker a few milliseconds. With DOWNLOAD_MODE = 'stream'
+// (for hosts where downloads/ isn't publicly readable) the file is streamed from
+// here instead, in fixed-size chunks with Range, If-Range and ETag handling.
+//
+// Add &delta_from=<sha256> to get a delta from an earlier version, when the
+// manifest has one (falls back to the full bundle otherwise).
+
+ini_set('display_errors', 0);
+ini_set('log_errors', 1);
+error_reporting(E_ALL);
+
+require_once __DIR__ . '/env_loader.php';
+require_once __DIR__ . '/bundle_manifest.php';
+
+define('DOWNLOAD_CHUNK_BYTES', 1048576);
+
+function sendError($code, $message) {
+    http_response_code($code);
+    header('Content-Type: text/plain; charset=utf-8');
+    header('Cache-Control: no-store');
+    echo $message;
+    exit;
+}
+
+// Parse a single "bytes=" range against a file size.
+// Returns [start, end] (inclusive), null for no usable range, or false if unsatisfiable.
+function parseRange($header, $size) {
+    if (!preg_match('/^bytes=(\d*)-(\d*)$/', trim($header), $m) || ($m[1] === '' && $m[2] === '')) {
+        // Malformed or multi-range: serve the whole file
+        return null;
+    }
+    if ($m[1] === '') {
+        // Suffix range: the last N bytes
+        $length = (int)$m[2];
+        if ($length === 0) {
+            return false;
+        }
+        return [max(0, $size - $length), $size - 1];
+    }
+    $start = (int)$m[1];
+    $end = $m[2] === '' ? $size - 1 : min((int)$m[2], $size - 1);
+    if ($start >= $size || $start > $end) {
+        return false;
+    }
+    return [$start, $end];
+}
+
+function streamFile($path, $etag, $downloadName) {
+    $size = filesize($path);
+    $mtime = filemtime($path);
+
+    header('Accept-Ranges: bytes');
+    header('ETag: ' . $etag);
+    header('Last-Modified: ' . gmdate('D, d M Y H:i:s', $mtime) . ' GMT');
+    header('Cache-Control: public, max-age=31536000, immutable');
+
+    $ifNoneMatch = $_SERVER['HTTP_IF_NONE_MATCH'] ?? '';
+    if ($ifNoneMatch !== '' && ($ifNoneMatch === '*' || in_array($etag, array_map('trim', explode(',', $ifNoneMatch)), true))) {
+        http_response_code(304);
+        exit;
+    }
+
+    $range = null;
+    if (isset($_SERVER['HTTP_RANGE'])) {
+        // A resume only applies to the version the client already has part of
+        $ifRange = $_SERVER['HTTP_IF_RANGE'] ?? '';
+        if ($ifRange === '' || $ifRange === $etag) {
+            $range = parseRange($_SERVER['HTTP_RANGE'], $size);
+        }
+    }
+    if ($range === false) {
+        http_response_code(416);
+        header("Content-Range: bytes */$size");
+        exit;
+    }
+
+    [$start, $end] = $range ?? [0, $size - 1];
+    $length = $end - $start + 1;
+
+    if ($range !== null) {
+        http_response_code(206);
+        header("Content-Range: bytes $start-$end/$size");
+    }
+    header('Content-Type: application/zip');
+    header('Content-Length: ' . $length);
+    header('Content-Disposition: attachment; filename="' . $downloadName . '"');
+    // Let the reverse proxy pass chunks straight through
+    header('X-Accel-Buffering: no');
+
+    if ($_SERVER['REQUEST_METHOD'] === 'HEAD') {
+        exit;
+    }
+
+    // Send chunks as they are read; nothing is buffered in PHP
+    while (ob_get_level() > 0) {
+        ob_end_clean();
+    }
+    set_time_limit(0);
+    ignore_user_abort(false);
+
+    $fh = fopen($path, 'rb');
+    if (!$fh) {
+        error_log("download.php: cannot open $path");
+        exit;
+    }
+    fseek($fh, $start);
+    $remaining = $length;
+    while ($remaining > 0 && !feof($fh) && !connection_aborted()) {
+        $chunk = fread($fh, min(DOWNLOAD_CHUNK_BYTES, $remaining));
+        if ($chunk === false || $chunk === '') {
+            break;
+        }
+        echo $chunk;
+        flush();
+        $remaining -= strlen($chunk);
+    }
+    fclose($fh);
+    exit;
+}
+
+try {
+    if (!in_array($_SERVER['REQUEST_METHOD'], ['GET', 'HEAD'], true)) {
+        header('Allow: GET, HEAD');
+        sendError(405, 'Method not allowed.');
+    }
+
+    $name = $_GET['bundle'] ?? '';
+    $bundle = find_bundle($name);
+    if (!$bundle) {
+        sendError(404, 'This download is not available yet.');
+    }
+
+    $file = $bundle['file'];
+    $sha256 = $bundle['sha256'];
+    $downloadName = $name . '.zip';
+
+    $deltaFrom = $_GET['delta_from'] ?? '';
+    if ($deltaFrom !== '') {
+        foreach ($bundle['deltas'] ?? [] as $delta) {
+            if (hash_equals($delta['from_sha256'], strtolower($deltaFrom)) && is_file(BUNDLE_DIR . '/' . $delta['file'])) {
+                $file = $delta['file'];
+                $sha256 = $delta['sha256'];
+                $downloadName = $name . '.delta.zip';
+                break;
+            }
+        }
+    }
+
+    header('X-Content-SHA256: ' . $sha256);
+
+    if (get_config('DOWNLOAD_MODE') === 'stream') {
+        streamFile(BUNDLE_DIR . '/' . $file, '"' . $sha256 . '"', $downloadName);
+    }
+
+    // The target changes whenever a new version is published, so the redirect
+    // itself must not be cached
+    $base = rtrim(str_replace('\\', '/', dirname($_SERVER['SCRIPT_NAME'])), '/');
+    header('Cache-Control: no-cache');
+    header('Location: ' . $base . '/downloads/' . $file, true, 302);
+    exit;
+
+} catch (Throwable $e) {
+    error_log("download.php error: " . $e->getMessage());
+    sendError(500, 'Download failed. Please try again.');
+}
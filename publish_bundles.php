@@ -0,0 +1,229 @@
+<?php
+// publish_bundles.php
+// Command-line release tool: validates plugin zips, publishes them as
+// content-addressed bundles and updates downloads/manifest.json.
+//
+// Usage (over SSH, from the site root):
+//   php publish_bundles.php                 # every downloads/*.zip
+//   php publish_bundles.php --deltas        # also build deltas from earlier versions
+//   php publish_bundles.php path/to/Plugin_v1.1.zip --name=rhythm_engine_vst3
+//
+// Invalid archives (e.g. placeholder text files renamed to .zip) are rejected and
+// the bundle keeps its previously published version. Exits with status 1 if any
+// file was rejected.
+
+if (PHP_SAPI !== 'cli') {
+    http_response_code(403);
+    exit;
+}
+
+require_once __DIR__ . '/bundle_manifest.php';
+
+// Published versions kept on disk per bundle (and offered as delta bases)
+define('BUNDLE_KEEP_VERSIONS', 3);
+
+function publish_log($message) {
+    fwrite(STDOUT, $message . "\n");
+}
+
+// Build a zip holding only the entries of $newPath that are new or changed since
+// $oldPath. Returns the list of entries removed since $oldPath, or null if the
+// delta isn't worth it (no zip extension, or not smaller than the full bundle).
+function build_delta($oldPath, $newPath, $deltaPath) {
+    if (!class_exists('ZipArchive')) {
+        return null;
+    }
+    $old = new ZipArchive();
+    $new = new ZipArchive();
+    if ($old->open($oldPath) !== true || $new->open($newPath) !== true) {
+        return null;
+    }
+
+    $oldEntries = [];
+    for ($i = 0; $i < $old->numFiles; $i++) {
+        $stat = $old->statIndex($i);
+        $oldEntries[$stat['name']] = [$stat['crc'], $stat['size']];
+    }
+
+    $delta = new ZipArchive();
+    if ($delta->open($deltaPath, ZipArchive::CREATE | ZipArchive::OVERWRITE) !== true) {
+        return null;
+    }
+    // Changed entries are extracted through streams to temp files, so neither
+    // archive is ever held in memory; ZipArchive reads them on close()
+    $tmpDir = sys_get_temp_dir() . '/bundle-delta-' . getmypid();
+    if (!is_dir($tmpDir)) {
+        mkdir($tmpDir, 0700, true);
+    }
+    $tmpFiles = [];
+    for ($i = 0; $i < $new->numFiles; $i++) {
+        $stat = $new->statIndex($i);
+        $name = $stat['name'];
+        $previous = $oldEntries[$name] ?? null;
+        unset($oldEntries[$name]);
+        if ($previous === [$stat['crc'], $stat['size']]) {
+            continue;
+        }
+        if (substr($name, -1) === '/') {
+            $delta->addEmptyDir(rtrim($name, '/'));
+            continue;
+        }
+        $tmpFile = $tmpDir . '/' . $i;
+        $in = $new->getStream($name);
+        $out = fopen($tmpFile, 'wb');
+        stream_copy_to_stream($in, $out);
+        fclose($in);
+        fclose($out);
+        $delta->addFile($tmpFile, $name);
+        $tmpFiles[] = $tmpFile;
+    }
+    $removed = array_keys($oldEntries);
+    if ($delta->numFiles === 0) {
+        // Only removals: the archive still has to exist to carry the list
+        $delta->addFromString('.delta', '');
+    }
+    $delta->close();
+    $old->close();
+    $new->close();
+    array_map('unlink', $tmpFiles);
+    @rmdir($tmpDir);
+
+    if (!is_file($deltaPath) || filesize($deltaPath) >= filesize($newPath)) {
+        @unlink($deltaPath);
+        return null;
+    }
+    return $removed;
+}
+
+function publish_bundle(&$manifest, $name, $source, $withDeltas) {
+    $sha256 = hash_file('sha256', $source);
+    $current = $manifest['bundles'][$name] ?? null;
+    if ($current && $current['sha256'] === $sha256) {
+        publish_log("  unchanged  $name");
+        return;
+    }
+
+    $relative = 'bundles/' . substr($sha256, 0, 16) . '/' . $name . '.zip';
+    $target = BUNDLE_DIR . '/' . $relative;
+    if (!is_dir(dirname($target)) && !mkdir(dirname($target), 0755, true)) {
+        throw new Exception("Could not create " . dirname($target));
+    }
+    // Copy to a temp name first; bundle URLs must never serve a partial file
+    $tmp = $target . '.' . getmypid() . '.tmp';
+    if (!copy($source, $tmp) || hash_file('sha256', $tmp) !== $sha256 || !rename($tmp, $target)) {
+        @unlink($tmp);
+        throw new Exception("Could not publish $source");
+    }
+
+    $previous = [];
+    if ($current) {
+        $previous[] = ['sha256' => $current['sha256'], 'file' => $current['file']];
+        foreach ($current['previous'] ?? [] as $old) {
+            $previous[] = $old;
+        }
+    }
+    // Republishing an earlier version makes it current again: it is no longer a
+    // previous version (or a delta base for itself)
+    $previous = array_values(array_filter($previous, function ($old) use ($sha256) {
+        return $old['sha256'] !== $sha256;
+    }));
+    // Forget versions beyond the limit, and their files
+    foreach (array_slice($previous, BUNDLE_KEEP_VERSIONS - 1) as $expired) {
+        $dir = dirname(BUNDLE_DIR . '/' . $expired['file']);
+        if (realpath($dir) === realpath(dirname($target))) {
+            // Never delete the version being published
+            continue;
+        }
+        array_map('unlink', glob($dir . '/' . $name . '.*') ?: []);
+        @rmdir($dir);
+    }
+    $previous = array_slice($previous, 0, BUNDLE_KEEP_VERSIONS - 1);
+
+    $deltas = [];
+    if ($withDeltas) {
+        foreach ($previous as $old) {
+            $oldPath = BUNDLE_DIR . '/' . $old['file'];
+            if (!is_file($oldPath)) {
+                continue;
+            }
+            $deltaRelative = dirname($relative) . '/' . $name . '.from-' . substr($old['sha256'], 0, 16) . '.delta.zip';
+            $removed = build_delta($oldPath, $target, BUNDLE_DIR . '/' . $deltaRelative);
+            if ($removed === null) {
+                continue;
+            }
+            $deltas[] = [
+                'from_sha256' => $old['sha256'],
+                'file' => $deltaRelative,
+                'size' => filesize(BUNDLE_DIR . '/' . $deltaRelative),
+                'sha256' => hash_file('sha256', BUNDLE_DIR . '/' . $deltaRelative),
+                'removed' => $removed
+            ];
+        }
+    }
+
+    $manifest['bundles'][$name] = [
+        'file' => $relative,
+        'size' => filesize($target),
+        'sha256' => $sha256,
+        'published_at' => date('c'),
+        'deltas' => $deltas,
+        'previous' => $previous
+    ];
+    publish_log("  published  $name (" . round(filesize($target) / 1048576, 1) . " MB, " . count($deltas) . " deltas)");
+}
+
+// --- Main ---
+
+$withDeltas = false;
+$nameOverride = null;
+$sources = [];
+foreach (array_slice($argv, 1) as $arg) {
+    if ($arg === '--deltas') {
+        $withDeltas = true;
+    } elseif (strpos($arg, '--name=') === 0) {
+        $nameOverride = substr($arg, 7);
+    } else {
+        $sources[] = $arg;
+    }
+}
+if (empty($sources)) {
+    $sources = glob(BUNDLE_DIR . '/*.zip') ?: [];
+}
+if ($nameOverride !== null && count($sources) !== 1) {
+    fwrite(STDERR, "--name needs exactly one zip\n");
+    exit(2);
+}
+
+try {
+    $manifest = load_bundle_manifest();
+    $rejected = 0;
+
+    publish_log("Publishing " . count($sources) . " bundle(s)");
+    foreach ($sources as $source) {
+        $name = $nameOverride ?? basename($source, '.zip');
+        if (!is_valid_bundle_name($name)) {
+            publish_log("  REJECTED   $source: invalid bundle name '$name'");
+            $rejected++;
+            continue;
+        }
+        $error = zip_validation_error($source);
+        if ($error !== null) {
+            publish_log("  REJECTED   $name: $error");
+            $rejected++;
+            continue;
+        }
+        publish_bundle($manifest, $name, $source, $withDeltas);
+    }
+
+    $manifest['version'] = BUNDLE_MANIFEST_VERSION;
+    $manifest['generated_at'] = date('c');
+    ksort($manifest['bundles']);
+    save_bundle_manifest($manifest);
+    publish_log("Wrote " . BUNDLE_MANIFEST_FILE);
+
+    exit($rejected > 0 ? 1 : 0);
+
+} catch (Throwable $e) {
+    fwrite(STDERR, "publish_bundles.php error: " . $e->getMessage() . "\n");
+    exit(2);
+}
@@ -26,6 +26,19 @@ def cli():
         
         # Export to Ableton
         stem-gen export-ableton ./stems/MySong
+        
+        # Benchmark a fixed corpus and compare with the last release
+        stem-gen bench ./bench-corpus -o bench.json --baseline bench-1.0.json
+        
+        # Build a sample pack from every vocal stem in a library
+        stem-gen chop ./stems --batch -o ./sample-pack
+        
+        # Prepare a gig USB stick for Rekordbox
+        stem-gen organize ./music /media/usb/STEMS --target rekordbox
+        
+        # Keep models loaded and submit jobs to the warm server
+        stem-gen serve --device cuda:0 --device cuda:1
+        stem-gen separate song.mp3 --server
     """
     pass
 
@@ -33,14 +46,29 @@ def cli():
 @cli.command()
 @click.argument('input_file', type=click.Path(exists=True))
 @click.option('--engine', '-e', 
-              type=click.Choice(['auto', 'demucs', 'lalal']), 
+              type=click.Choice(['auto', 'demucs', 'lalal', 'native', 'uvr']), 
               default='auto',
               help='Separation engine to use')
 @click.option('--output', '-o', type=click.Path(), default=None,
               help='Output directory (defaults to data/stems/)')
 @click.option('--no-fallback', is_flag=True,
               help='Disable quality-based fallback to other engines')
-def separate(input_file: str, engine: str, output: str, no_fallback: bool):
+@click.option('--streaming', is_flag=True,
+              help='Separate in segments with constant memory (long mixes)')
+@click.option('--in-memory', is_flag=True,
+              help='Score stems from memory and write them in the background')
+@click.option('--format', 'stem_format',
+              type=click.Choice(['wav', 'wav24', 'flac']), default='wav',
+              help='Stem storage format (wav = 32-bit float, the only bit-exact one; '
+                   'wav24/flac are 24-bit and clip peaks above 0 dBFS)')
+@click.option('--precision', type=click.Choice(['fp32', 'fp16', 'bf16', 'int8']),
+              default='fp32',
+              help='Demucs inference precision (fp16/bf16 on GPU, int8 on CPU)')
+@click.option('--server', 'use_server', is_flag=True,
+              help='Submit to a running `serve` daemon (output is the server\'s)')
+def separate(input_file: str, engine: str, output: str, no_fallback: bool,
+             streaming: bool, in_memory: bool, stem_format: str, precision: str,
+             use_server: bool):
     """
     Separate a single audio file into stems.
     
@@ -51,14 +79,30 @@ def separate(input_file: str, engine: str, output: str, no_fallback: bool):
     click.echo(f"[*] Processing: {input_file}")
     click.echo(f"   Engine: {engine}")
     
-    pipeline = StemPipeline(base_dir=output) if output else StemPipeline()
+    client = _connect_server(output or "data/stems") if use_server else None
     
-    result = pipeline.separate(
-        input_file,
-        engine=engine,
-        skip_if_exists=False,
-        quality_fallback=not no_fallback
-    )
+    if client is not None:
+        result = client.separate(
+            input_file,
+            engine=engine,
+            skip_if_exists=False,
+            quality_fallback=not no_fallback
+        )
+    else:
+        pipeline = StemPipeline(
+            base_dir=output or "data/stems",
+            streaming=streaming,
+            in_memory=in_memory,
+            stem_format=stem_format,
+            precision=precision
+        )
+        
+        result = pipeline.separate(
+            input_file,
+            engine=engine,
+            skip_if_exists=False,
+            quality_fallback=not no_fallback
+        )
     
     if result.success:
         click.echo(click.style("[OK] Separation complete!", fg="green"))
@@ -80,7 +124,37 @@ def separate(input_file: str, engine: str, output: str, no_fallback: bool):
               help='Maximum number of files to process')
 @click.option('--skip-existing', is_flag=True, default=True,
               help='Skip files that already have stems')
-def batch(input_dir: str, output: str, limit: int, skip_existing: bool):
+@click.option('--streaming', is_flag=True,
+              help='Separate in segments with constant memory (long mixes)')
+@click.option('--in-memory', is_flag=True,
+              help='Score stems from memory and write them in the background')
+@click.option('--format', 'stem_format',
+              type=click.Choice(['wav', 'wav24', 'flac']), default='wav',
+              help='Stem storage format (wav = 32-bit float, the only bit-exact one; '
+                   'wav24/flac are 24-bit and clip peaks above 0 dBFS)')
+@click.option('--precision', type=click.Choice(['fp32', 'fp16', 'bf16', 'int8']),
+              default='fp32',
+              help='Demucs inference precision (fp16/bf16 on GPU, int8 on CPU)')
+@click.option('--batched', is_flag=True,
+              help='Share GPU inference batches across tracks')
+@click.option('--batch-size', type=int, default=None,
+              help='Segments per GPU batch (defaults to VRAM-based size)')
+@click.option('--watch', is_flag=True,
+              help='Keep running and process tracks as they are added or changed')
+@click.option('--resume', is_flag=True,
+              help='Only finish jobs left over from an interrupted run')
+@click.option('--multi-gpu', is_flag=True,
+              help='Run a model replica on every GPU and spread tracks across them')
+@click.option('--server', 'use_server', is_flag=True,
+              help='Submit to a running `serve` daemon (output is the server\'s)')
+@click.option('--metrics-port', type=int, default=None,
+              help='Serve Prometheus metrics on this port (e.g. 9477)')
+@click.option('--metrics-host', default='127.0.0.1',
+              help='Address for the metrics endpoint')
+def batch(input_dir: str, output: str, limit: int, skip_existing: bool,
+          streaming: bool, in_memory: bool, stem_format: str, precision: str, batched: bool,
+          batch_size: int, watch: bool, resume: bool, multi_gpu: bool,
+          use_server: bool, metrics_port: int, metrics_host: str):
     """
     Batch process all audio files in a directory.
     
@@ -89,6 +163,7 @@ def batch(input_dir: str, output: str, limit: int, skip_existing: bool):
     from ..dj.batch_processor import DJBatchProcessor
     from ..dj.library_scanner import ScannedTrack
     from ..core.stem_pipeline import StemPipeline
+    from ..core.engines.demucs_engine import DemucsEngine
     
     def progress_callback(progress, track: ScannedTrack):
         status = f"[{progress.completed + progress.skipped}/{progress.total}]"
@@ -97,16 +172,44 @@ def batch(input_dir: str, output: str, limit: int, skip_existing: bool):
     click.echo(f"[*] Batch processing: {input_dir}")
     click.echo(f"   Output: {output}")
     
-    pipeline = StemPipeline(base_dir=output)
-    processor = DJBatchProcessor(pipeline=pipeline)
+    pipeline = StemPipeline(
+        base_dir=output,
+        streaming=streaming,
+        in_memory=in_memory,
+        stem_format=stem_format,
+        precision=precision,
+        # Batch jobs are resumable, so let them resume mid-track too
+        checkpoint_segments=DemucsEngine.RESUMABLE_CHECKPOINT_SEGMENTS
+    )
     
-    result = processor.process_directory(
-        input_dir,
-        progress_callback=progress_callback,
-        skip_existing=skip_existing,
-        limit=limit
+    metrics = None
+    if metrics_port is not None:
+        from ..optimization.metrics import PipelineMetrics
+        
+        metrics = PipelineMetrics()
+        _watch_stem_cache(metrics)
+        metrics.serve(metrics_host, metrics_port)
+        click.echo(f"   Metrics: http://{metrics_host}:{metrics_port}/metrics")
+    
+    processor = DJBatchProcessor(
+        pipeline=pipeline,
+        max_workers=batch_size,
+        batched=batched,
+        client=_connect_server(output) if use_server else None,
+        multi_gpu=multi_gpu,
+        metrics=metrics
     )
     
+    if resume:
+        result = processor.resume_processing(input_dir, progress_callback=progress_callback)
+    else:
+        result = processor.process_directory(
+            input_dir,
+            progress_callback=progress_callback,
+            skip_existing=skip_existing,
+            limit=limit
+        )
+    
     click.echo("")
     click.echo(click.style("Batch Complete!", fg="green"))
     click.echo(f"   Processed: {result.progress.completed}")
@@ -118,13 +221,119 @@ def batch(input_dir: str, output: str, limit: int, skip_existing: bool):
         click.echo(click.style("\nErrors:", fg="yellow"))
         for track, error in result.errors[:5]:  # Show first 5 errors
             click.echo(f"   {track.display_name}: {error}")
+    
+    if watch:
+        click.echo(f"\n[*] Watching {input_dir} for changes (Ctrl+C to stop)")
+        try:
+            processor.watch_directory(input_dir, progress_callback=progress_callback)
+        except KeyboardInterrupt:
+            click.echo("Stopped watching")
+
+
+def _watch_stem_cache(metrics, cache_dir: str = "data/cache") -> None:
+    """Export the stem cache's hit rate, if this machine has one."""
+    if Path(cache_dir).exists():
+        from ..optimization.stem_cache import StemCache
+        metrics.watch_cache(StemCache(cache_dir))
+
+
+def _connect_server(key_dir: str = "data/stems"):
+    """Get a client for the local separation server, or None if it's down."""
+    from ..server.client import SeparationClient
+    
+    try:
+        client = SeparationClient(key_dir=key_dir)
+    except RuntimeError as e:
+        click.echo(click.style(f"[!] {e}, processing locally", fg="yellow"))
+        return None
+    if client.is_available():
+        click.echo("   Server: connected")
+        return client
+    
+    click.echo(click.style(
+        "[!] Separation server not reachable, processing locally", fg="yellow"
+    ))
+    return None
+
+
+@cli.command()
+@click.option('--output', '-o', type=click.Path(), default='data/stems',
+              help='Output directory for stems')
+@click.option('--device', '-d', 'devices', multiple=True,
+              help='Device to keep a model on (repeat; defaults to every GPU)')
+@click.option('--host', default='127.0.0.1',
+              help='Address to listen on (non-loopback needs STEM_SERVER_AUTHKEY)')
+@click.option('--port', type=int, default=50777, help='Port to listen on')
+@click.option('--streaming', is_flag=True,
+              help='Separate in segments with constant memory (long mixes)')
+@click.option('--in-memory', is_flag=True,
+              help='Score stems from memory and write them in the background')
+@click.option('--format', 'stem_format',
+              type=click.Choice(['wav', 'wav24', 'flac']), default='wav',
+              help='Stem storage format (wav = 32-bit float, the only bit-exact one; '
+                   'wav24/flac are 24-bit and clip peaks above 0 dBFS)')
+@click.option('--precision', type=click.Choice(['fp32', 'fp16', 'bf16', 'int8']),
+              default='fp32',
+              help='Demucs inference precision (fp16/bf16 on GPU, int8 on CPU)')
+@click.option('--metrics-port', type=int, default=None,
+              help='Serve Prometheus metrics on this port (e.g. 9477)')
+@click.option('--metrics-host', default='127.0.0.1',
+              help='Address for the metrics endpoint')
+def serve(output: str, devices: tuple[str, ...], host: str, port: int,
+          streaming: bool, in_memory: bool, stem_format: str, precision: str,
+          metrics_port: int, metrics_host: str):
+    """
+    Run the warm separation server.
+    
+    Loads models once and keeps them resident; `separate --server` and
+    `batch --server` submit jobs to it. Local clients authenticate with a
+    key generated next to the database on first start; to listen on a
+    non-loopback --host, set STEM_SERVER_AUTHKEY for server and clients.
+    """
+    import logging
+    from ..server.separation_server import SeparationServer
+    
+    logging.basicConfig(level=logging.INFO, format="%(asctime)s %(message)s")
+    
+    server = SeparationServer(
+        base_dir=output,
+        devices=list(devices) or None,
+        address=(host, port),
+        streaming=streaming,
+        in_memory=in_memory,
+        stem_format=stem_format,
+        precision=precision,
+        metrics_port=metrics_port,
+        metrics_host=metrics_host
+    )
+    _watch_stem_cache(server.metrics)
+    
+    click.echo(f"[*] Loading models on {', '.join(devices) or 'all devices'}")
+    try:
+        server.start()
+    except RuntimeError as e:
+        click.echo(click.style(f"[FAIL] {e}", fg="red"))
+        sys.exit(1)
+    click.echo(click.style(f"[OK] Listening on {host}:{port}", fg="green"))
+    if metrics_port is not None:
+        click.echo(f"   Metrics: http://{metrics_host}:{metrics_port}/metrics")
+    
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        server.stop()
+    click.echo("Server stopped")
 
 
 @cli.command('export-ableton')
 @click.argument('stem_dir', type=click.Path(exists=True))
 @click.option('--output', '-o', type=click.Path(), default=None,
-              help='Output .als file path')
-def export_ableton(stem_dir: str, output: str):
+              help='Output .als file path (output directory with --batch)')
+@click.option('--batch', is_flag=True,
+              help='Export every stem directory inside STEM_DIR')
+@click.option('--workers', '-w', type=int, default=None,
+              help='Parallel export processes for --batch (default: CPU count)')
+def export_ableton(stem_dir: str, output: str, batch: bool, workers: int):
     """
     Export stems as an Ableton Live project.
     
@@ -136,6 +345,15 @@ def export_ableton(stem_dir: str, output: str):
     
     exporter = AbletonProjectExporter()
     
+    if batch:
+        created = exporter.export_batch(
+            Path(stem_dir),
+            Path(output) if output else None,
+            max_workers=workers
+        )
+        click.echo(click.style(f"[OK] Created {len(created)} projects", fg="green"))
+        return
+    
     try:
         als_path = exporter.export(
             Path(stem_dir),
@@ -147,24 +365,248 @@ def export_ableton(stem_dir: str, output: str):
         sys.exit(1)
 
 
+@cli.command('validate-precision')
+@click.argument('reference_files', nargs=-1, required=True, type=click.Path(exists=True))
+@click.option('--mode', '-m', 'modes', multiple=True,
+              type=click.Choice(['fp16', 'bf16', 'int8']),
+              help='Mode to check against fp32 (repeat; default: all)')
+@click.option('--device', '-d', default=None, help='Device to validate on')
+@click.option('--threshold', type=float, default=None,
+              help='Minimum per-stem SI-SDR vs fp32 in dB')
+@click.option('--output', '-o', type=click.Path(), default='data/stems',
+              help='Stem library whose precision report is updated')
+def validate_precision(reference_files: tuple[str, ...], modes: tuple[str, ...],
+                       device: str, threshold: float, output: str):
+    """
+    Validate reduced-precision Demucs modes against fp32.
+    
+    Separates each reference file in fp32 and in every mode, scores the
+    stems against the fp32 ones and records which modes pass, so
+    `--precision` falls back to fp32 where a mode failed.
+    """
+    from ..optimization.precision_validator import (
+        REPORT_FILE, PrecisionValidator
+    )
+    
+    validator = PrecisionValidator(
+        device=device,
+        threshold_db=threshold if threshold is not None else PrecisionValidator.DEFAULT_THRESHOLD_DB
+    )
+    click.echo(f"[*] Validating on {len(reference_files)} reference file(s)")
+    
+    checks = validator.validate(
+        [Path(f) for f in reference_files],
+        precisions=modes or ('fp16', 'bf16', 'int8')
+    )
+    
+    for precision, check in checks.items():
+        if check.error:
+            click.echo(click.style(f"   {precision}: [X] {check.error}", fg="yellow"))
+            continue
+        label = click.style("[OK]", fg="green") if check.passed else click.style("[FAIL]", fg="red")
+        speedup = f", {check.speedup:.2f}x" if check.speedup else ""
+        click.echo(f"   {precision}: {label} min {check.min_si_sdr:.1f} dB vs fp32{speedup}")
+        for stem_name, score in sorted(check.stem_si_sdr.items()):
+            click.echo(f"      {stem_name}: {score:.1f} dB")
+    
+    report_path = Path(output) / REPORT_FILE
+    validator.save_report(checks, report_path)
+    click.echo(f"   Report: {report_path}")
+
+
+@cli.command()
+@click.argument('corpus', type=click.Path(exists=True))
+@click.option('--engine', '-e',
+              type=click.Choice(['demucs', 'native', 'lalal', 'auto']),
+              default='demucs', help='Engine to benchmark')
+@click.option('--device', '-d', 'devices', multiple=True,
+              help='Device to benchmark (repeat for several GPUs; default: auto)')
+@click.option('--limit', '-n', type=int, default=None,
+              help='Use only the first N tracks of the corpus')
+@click.option('--repeat', '-r', type=int, default=1,
+              help='Passes over the corpus per device')
+@click.option('--streaming', is_flag=True,
+              help='Benchmark segment-streaming separation')
+@click.option('--in-memory', is_flag=True,
+              help='Score stems from memory and write them in the background')
+@click.option('--batched', is_flag=True,
+              help='Share GPU inference batches across tracks')
+@click.option('--format', 'stem_format',
+              type=click.Choice(['wav', 'wav24', 'flac']), default='wav',
+              help='Stem storage format (wav = 32-bit float, the only bit-exact one; '
+                   'wav24/flac are 24-bit and clip peaks above 0 dBFS)')
+@click.option('--precision', type=click.Choice(['fp32', 'fp16', 'bf16', 'int8']),
+              default='fp32', help='Demucs inference precision')
+@click.option('--output', '-o', type=click.Path(), default=None,
+              help='Write the JSON report here')
+@click.option('--baseline', '-b', type=click.Path(exists=True), default=None,
+              help='Earlier JSON report to compare against')
+def bench(corpus: str, engine: str, devices: tuple[str, ...], limit: int, repeat: int,
+          streaming: bool, in_memory: bool, batched: bool, stem_format: str,
+          precision: str, output: str, baseline: str):
+    """
+    Benchmark the pipeline on a fixed corpus.
+    
+    Reports per-stage timings, real-time factor, peak RAM/VRAM and
+    throughput per device. Use the same CORPUS between releases and pass
+    the previous report as --baseline to see what changed.
+    """
+    from ..optimization.benchmark import PipelineBenchmark, load_corpus
+    
+    tracks = load_corpus(Path(corpus), limit)
+    if not tracks:
+        click.echo(click.style(f"[FAIL] No audio files in {corpus}", fg="red"))
+        sys.exit(1)
+    
+    click.echo(f"[*] Benchmarking {len(tracks)} tracks with {engine}")
+    
+    report = PipelineBenchmark(
+        tracks,
+        engine=engine,
+        devices=list(devices) or None,
+        streaming=streaming,
+        in_memory=in_memory,
+        precision=precision,
+        stem_format=stem_format,
+        batched=batched,
+        repeat=repeat
+    ).run()
+    
+    def fmt(value, spec=".2f"):
+        return "-" if value is None else format(value, spec)
+    
+    for run in report["runs"]:
+        failed = sum(1 for t in run["tracks"] if not t["success"])
+        click.echo(f"\n   Device: {run['device']} (model load {run['model_load_seconds']:.1f}s)")
+        click.echo(f"   Wall: {run['wall_seconds']:.1f}s for {run['audio_seconds']:.0f}s of audio"
+                   f" (RTF {fmt(run['real_time_factor'], '.3f')},"
+                   f" {fmt(run['tracks_per_hour'], '.0f')} tracks/h)")
+        click.echo(f"   Peak RAM: {fmt(run['peak_rss_mb'], '.0f')} MB"
+                   f"  Peak VRAM: {fmt(run['peak_vram_mb'], '.0f')} MB")
+        for stage, timing in run["stages"].items():
+            click.echo(f"      {stage:<10} {timing['seconds']:8.2f}s"
+                       f"  {fmt(timing['share'] and timing['share'] * 100, '5.1f')}%"
+                       f"  ({timing['calls']} calls)")
+        if failed:
+            click.echo(click.style(f"   {failed} track runs failed", fg="red"))
+    
+    if baseline:
+        rows = PipelineBenchmark.compare(report, PipelineBenchmark.load_report(Path(baseline)))
+        click.echo("\n   vs baseline:")
+        for name, before, after in rows:
+            change = (after - before) / before * 100 if before else 0.0
+            color = "green" if change < -2 else "red" if change > 2 else None
+            click.echo(click.style(
+                f"      {name:<32} {before:10.2f} -> {after:10.2f}  ({change:+.1f}%)", fg=color
+            ))
+    
+    if output:
+        PipelineBenchmark.save_report(report, Path(output))
+        click.echo(f"\n   Report: {output}")
+
+
+@cli.command()
+@click.argument('music_dir', type=click.Path(exists=True))
+@click.argument('target_dir', type=click.Path())
+@click.option('--target', '-t', type=click.Choice(['rekordbox', 'serato']),
+              default='rekordbox', help='DJ software layout')
+@click.option('--library', '-l', type=click.Path(), default='data/stems',
+              help='Stem library the stems are taken from')
+@click.option('--workers', '-w', type=int, default=None,
+              help='Parallel tracks (default: 8 linking, 4 copying)')
+@click.option('--verify/--no-verify', default=None,
+              help='Read copies back from the target (default: on for other drives)')
+def organize(music_dir: str, target_dir: str, target: str, library: str,
+             workers: int, verify: bool):
+    """
+    Lay out stems for DJ software, e.g. on a USB stick.
+    
+    Stems are linked when TARGET_DIR is on the library's drive and copied
+    otherwise; files already copied by an earlier run are skipped.
+    """
+    from ..dj.stem_organizer import StemOrganizer
+    from ..utils.file_manager import StemFileManager
+    
+    click.echo(f"[*] Organizing stems for {target}: {target_dir}")
+    
+    organizer = StemOrganizer(StemFileManager(base_dir=library))
+    create = (
+        organizer.create_rekordbox_structure if target == 'rekordbox'
+        else organizer.create_serato_structure
+    )
+    
+    bar = click.progressbar(length=1, label="Exporting", show_percent=True)
+    
+    def progress_callback(progress):
+        bar.length = max(progress.bytes_total, 1)
+        bar.update(progress.bytes_done - bar.pos)
+    
+    with bar:
+        results = create(
+            Path(music_dir),
+            Path(target_dir),
+            max_workers=workers,
+            verify=verify,
+            progress_callback=progress_callback
+        )
+    
+    failed = [r for r in results if not r.success]
+    click.echo(click.style(
+        f"[OK] Organized {len(results) - len(failed)} tracks",
+        fg="green" if not failed else "yellow"
+    ))
+    for r in failed:
+        click.echo(click.style(f"   {r.message}", fg="red"))
+    if failed:
+        sys.exit(1)
+
+
 @cli.command()
 @click.argument('vocal_file', type=click.Path(exists=True))
 @click.option('--output', '-o', type=click.Path(), default=None,
               help='Output directory for chops')
 @click.option('--max-chops', '-n', type=int, default=32,
               help='Maximum number of chops to create')
-def chop(vocal_file: str, output: str, max_chops: int):
+@click.option('--batch', is_flag=True,
+              help='Chop the vocal stem of every stem directory inside VOCAL_FILE')
+@click.option('--workers', '-w', type=int, default=None,
+              help='Parallel processes for --batch (default: CPU count)')
+def chop(vocal_file: str, output: str, max_chops: int, batch: bool, workers: int):
     """
     Create vocal chops from a vocal stem.
     
     Detects transients and slices into one-shot samples.
     """
     from ..production.stem_remixer import StemRemixer
-    
-    click.echo(f"[*] Creating chops from: {vocal_file}")
+    from ..utils.audio_io import find_stem_file
     
     remixer = StemRemixer(output_dir=output)
     
+    if batch:
+        vocals = [
+            path for path in (
+                find_stem_file(item, "vocals")
+                for item in sorted(Path(vocal_file).iterdir()) if item.is_dir()
+            )
+            if path is not None
+        ]
+        click.echo(f"[*] Creating chops from {len(vocals)} vocal stems")
+        
+        results = remixer.create_vocal_chops_batch(
+            vocals,
+            output_dir=Path(output) if output else None,
+            max_chops=max_chops,
+            max_workers=workers
+        )
+        total = sum(len(chops) for chops in results.values())
+        empty = sum(1 for chops in results.values() if not chops)
+        click.echo(click.style(f"[OK] Created {total} chops", fg="green"))
+        if empty:
+            click.echo(click.style(f"   {empty} stems gave no chops", fg="yellow"))
+        return
+    
+    click.echo(f"[*] Creating chops from: {vocal_file}")
+    
     chops = remixer.create_vocal_chops(
         Path(vocal_file),
         output_dir=Path(output) if output else None,
@@ -203,6 +645,7 @@ def cache(clear: bool, older_than: int):
         click.echo("Cache Statistics:")
         click.echo(f"   Entries: {stats['total_entries']}")
         click.echo(f"   Size: {stats['total_size_mb']:.1f} MB")
+        click.echo(f"   Hit rate: {stats['hit_rate']:.0%} ({stats['hits']} hits, {stats['misses']} misses)")
         click.echo(f"   Location: {stats['cache_dir']}")
 
 
@@ -214,6 +657,7 @@ def info():
     from ..optimization.gpu_manager import GPUManager
     from ..core.engines.demucs_engine import DemucsEngine
     from ..core.engines.lalal_engine import LalalEngine
+    from ..core.engines.native_engine import NativeEngine
     
     click.echo("System Information")
     click.echo("=" * 40)
@@ -243,6 +687,20 @@ def info():
     lalal = LalalEngine()
     status = click.style("[OK] Configured", fg="green") if lalal.is_available() else click.style("[!] API key not set", fg="yellow")
     click.echo(f"LALAL.AI: {status}")
+    
+    # Native engine library
+    native = NativeEngine()
+    if native.is_available():
+        engine_info = native.info
+        status = click.style(
+            f"[OK] {engine_info.name} ({engine_info.latency_seconds * 1000:.0f} ms latency)",
+            fg="green"
+        )
+    elif native.library_path:
+        status = click.style(f"[X] {native.load_error}", fg="red")
+    else:
+        status = click.style("[!] STEM_NATIVE_ENGINE not set", fg="yellow")
+    click.echo(f"Native: {status}")
 
 
 def main():
@@ -0,0 +1,326 @@
+"""
+Load-Aware Engine Router
+
+Picks the separation engine for each track from live backlog, measured
+throughput and the chance the local result fails the quality gate.
+"""
+
+import itertools
+import logging
+import threading
+import time
+from dataclasses import dataclass
+from typing import Optional
+
+from .engines.base_engine import StemEngine
+from .engines.lalal_engine import LalalEngine
+from .quality_analyzer import StemQualityAnalyzer
+from ..optimization.gpu_manager import GPUManager
+from ..utils.database import StemDatabase
+
+
+logger = logging.getLogger(__name__)
+
+BYTES_PER_MB = 1024 * 1024
+
+
+@dataclass
+class Route:
+    """Routing decision for one track."""
+    engine: StemEngine
+    # Expected completion time from now, including queued work and any
+    # expected quality retry
+    estimate_seconds: float
+    # Chance the engine's stems fail the quality gate
+    fallback_probability: float
+    # Start the fallback engine right away, alongside this one
+    speculate: bool = False
+
+
+@dataclass
+class _EngineStats:
+    """Measured separation speed of one engine."""
+    jobs: int = 0
+    seconds: float = 0.0
+    megabytes: float = 0.0
+    # Estimated seconds of work routed to the engine and not yet finished
+    backlog_seconds: float = 0.0
+
+
+class EngineRouter:
+    """
+    Routes tracks to engines so a batch finishes as early as possible.
+    
+    For every candidate the router estimates when the track would be
+    done if sent there now:
+        
+        queued work / engine concurrency
+        + track size * seconds-per-MB (blended from a prior and the jobs
+          table, and updated as jobs finish)
+        + P(quality fallback) * fallback time, for engines with a fallback
+    
+    and picks the earliest, with cloud estimates weighted by
+    `cloud_cost_factor` so paid processing is only used when it really
+    shortens the batch. A GPU that is busy with someone else's work (NVML
+    utilization while this process has nothing queued on it) counts as
+    proportionally slower.
+    
+    The fallback probability is the past rate of the engine's jobs failing
+    the quality gate (any stem below its threshold, as in
+    StemQualityAnalyzer.needs_reprocessing), per genre, smoothed towards
+    the engine-wide rate.
+    When it reaches `speculate_probability` on a local engine whose
+    fallback is the cloud, the route asks for the cloud job to start
+    immediately, so a quality retry costs no extra wall time.
+    
+    Thread-safe; StemPipeline shares one router between its workers.
+    """
+    
+    # Prior seconds per MB of source audio, used until history builds up
+    PRIOR_SECONDS_PER_MB = {
+        "demucs_gpu": 1.0,
+        "demucs_cpu": 25.0,
+        "lalal_cloud": 8.0,
+        "native": 1.0,
+    }
+    
+    # Weight of the prior, in MB of observed audio
+    PRIOR_MEGABYTES = 50.0
+    
+    # Prior fallback probability and its weight in jobs
+    PRIOR_FALLBACK_PROBABILITY = 0.1
+    PRIOR_FALLBACK_JOBS = 5
+    
+    DEFAULT_CLOUD_COST_FACTOR = 1.5
+    DEFAULT_SPECULATE_PROBABILITY = 0.5
+    
+    # History is re-read from the database at most this often
+    REFRESH_SECONDS = 300.0
+    
+    # GPUs busier than this with other work are treated as saturated
+    MAX_FOREIGN_UTILIZATION = 0.9
+    
+    def __init__(
+        self,
+        db: StemDatabase,
+        cloud_cost_factor: float = DEFAULT_CLOUD_COST_FACTOR,
+        speculate_probability: Optional[float] = DEFAULT_SPECULATE_PROBABILITY,
+        gpu: Optional[GPUManager] = None
+    ):
+        """
+        Initialize the router.
+        
+        Args:
+            db: Database with job history
+            cloud_cost_factor: Multiplier on cloud time estimates (1.0
+                routes on time alone)
+            speculate_probability: Fallback probability at which the cloud
+                fallback is started speculatively (None disables)
+            gpu: GPU manager used for utilization (created lazily)
+        """
+        self.db = db
+        self.cloud_cost_factor = cloud_cost_factor
+        self.speculate_probability = speculate_probability
+        self._gpu = gpu
+        
+        self._lock = threading.Lock()
+        self._stats: dict[str, _EngineStats] = {}
+        # (engine, genre) -> (scored jobs, failures)
+        self._failures: dict[tuple[str, Optional[str]], list[int]] = {}
+        self._loaded_at = 0.0
+        self._tickets = itertools.count()
+        self._active: dict[int, tuple[str, float]] = {}
+    
+    # -------------------------------------------------------------------------
+    # History
+    # -------------------------------------------------------------------------
+    
+    def _refresh(self) -> None:
+        """Reload history from the jobs table (lock held)."""
+        if time.time() - self._loaded_at < self.REFRESH_SECONDS:
+            return
+        self._loaded_at = time.time()
+        
+        try:
+            throughput = self.db.get_engine_throughput()
+            failures = self.db.get_quality_failures(
+                StemQualityAnalyzer.VOCAL_QUALITY_THRESHOLD,
+                StemQualityAnalyzer.THRESHOLD_ACCEPTABLE
+            )
+        except Exception as e:
+            logger.warning(f"Could not load engine history: {e}")
+            return
+        
+        for engine_name, (jobs, seconds, size) in throughput.items():
+            stats = self._stats.setdefault(engine_name, _EngineStats())
+            stats.jobs, stats.seconds, stats.megabytes = jobs, seconds, size / BYTES_PER_MB
+        self._failures = {key: [jobs, failed] for key, (jobs, failed) in failures.items()}
+    
+    def _prior(self, engine: StemEngine) -> float:
+        if engine.name.startswith("demucs"):
+            on_gpu = str(getattr(engine, "device", "cpu")).startswith("cuda")
+            return self.PRIOR_SECONDS_PER_MB["demucs_gpu" if on_gpu else "demucs_cpu"]
+        if isinstance(engine, LalalEngine):
+            return self.PRIOR_SECONDS_PER_MB["lalal_cloud"]
+        return self.PRIOR_SECONDS_PER_MB["native"]
+    
+    def _seconds_per_mb(self, engine: StemEngine) -> float:
+        """Blend of the prior and measured speed (lock held)."""
+        stats = self._stats.get(engine.name, _EngineStats())
+        prior = self._prior(engine)
+        return (prior * self.PRIOR_MEGABYTES + stats.seconds) / (
+            self.PRIOR_MEGABYTES + stats.megabytes
+        )
+    
+    def fallback_probability(self, engine: StemEngine, genre: Optional[str]) -> float:
+        """Chance a job on an engine fails the quality gate (any stem) for a genre."""
+        with self._lock:
+            self._refresh()
+            return self._fallback_probability(engine.name, genre)
+    
+    def _fallback_probability(self, engine_name: str, genre: Optional[str]) -> float:
+        """Genre rate smoothed towards the engine rate (lock held)."""
+        total_jobs = total_failed = 0
+        for (name, _), (jobs, failed) in self._failures.items():
+            if name == engine_name:
+                total_jobs += jobs
+                total_failed += failed
+        
+        k = self.PRIOR_FALLBACK_JOBS
+        engine_rate = (self.PRIOR_FALLBACK_PROBABILITY * k + total_failed) / (k + total_jobs)
+        
+        jobs, failed = self._failures.get((engine_name, genre), (0, 0))
+        return (engine_rate * k + failed) / (k + jobs)
+    
+    # -------------------------------------------------------------------------
+    # Routing
+    # -------------------------------------------------------------------------
+    
+    @staticmethod
+    def _concurrency(engine: StemEngine) -> int:
+        return max(1, getattr(engine, "max_in_flight", 1))
+    
+    def _slowdown(self, engine: StemEngine, stats: _EngineStats) -> float:
+        """Factor for a GPU that other processes are keeping busy."""
+        device = str(getattr(engine, "device", ""))
+        if not device.startswith("cuda") or stats.backlog_seconds > 0:
+            # Our own queued work is already counted in the backlog
+            return 1.0
+        if self._gpu is None:
+            self._gpu = GPUManager()
+        index = int(device.split(":")[1]) if ":" in device else 0
+        utilization = self._gpu.get_utilization(index)
+        if utilization is None:
+            return 1.0
+        return 1.0 / (1.0 - min(utilization, self.MAX_FOREIGN_UTILIZATION))
+    
+    def _finish_estimate(self, engine: StemEngine, file_size: int) -> float:
+        """Seconds until a track sent to engine now would be done (lock held)."""
+        stats = self._stats.setdefault(engine.name, _EngineStats())
+        run = file_size / BYTES_PER_MB * self._seconds_per_mb(engine)
+        wait = stats.backlog_seconds / self._concurrency(engine)
+        return wait + run * self._slowdown(engine, stats)
+    
+    def route(
+        self,
+        file_size: int,
+        genre: Optional[str],
+        candidates: list[tuple[StemEngine, Optional[StemEngine]]]
+    ) -> Route:
+        """
+        Pick the engine that finishes a track soonest.
+        
+        Args:
+            file_size: Source file size in bytes
+            genre: Track genre (for the fallback probability)
+            candidates: (engine, its quality fallback or None) pairs
+        
+        Returns:
+            The chosen route
+        """
+        if not candidates:
+            raise RuntimeError("No stem separation engines available")
+        
+        with self._lock:
+            self._refresh()
+            
+            best: Optional[tuple[float, Route]] = None
+            for engine, fallback in candidates:
+                finish = self._finish_estimate(engine, file_size)
+                probability = self._fallback_probability(engine.name, genre)
+                expected = finish
+                speculate = False
+                
+                if fallback is not None:
+                    fallback_finish = self._finish_estimate(fallback, file_size)
+                    speculate = (
+                        self.speculate_probability is not None
+                        and probability >= self.speculate_probability
+                        and isinstance(fallback, LalalEngine)
+                        and not isinstance(engine, LalalEngine)
+                    )
+                    if speculate:
+                        # Both run at once; the retry costs no extra time
+                        expected = max(finish, fallback_finish)
+                    else:
+                        expected = finish + probability * fallback_finish
+                
+                cost = expected
+                if isinstance(engine, LalalEngine) or speculate:
+                    cost *= self.cloud_cost_factor
+                
+                if best is None or cost < best[0]:
+                    best = (cost, Route(engine, expected, probability, speculate))
+            
+            return best[1]
+    
+    # -------------------------------------------------------------------------
+    # Bookkeeping
+    # -------------------------------------------------------------------------
+    
+    def start(self, engine: StemEngine, file_size: int) -> int:
+        """
+        Count a job against an engine's backlog.
+        
+        Returns:
+            Ticket to pass to finish()
+        """
+        with self._lock:
+            run = file_size / BYTES_PER_MB * self._seconds_per_mb(engine)
+            self._stats.setdefault(engine.name, _EngineStats()).backlog_seconds += run
+            ticket = next(self._tickets)
+            self._active[ticket] = (engine.name, run)
+            return ticket
+    
+    def finish(
+        self,
+        ticket: int,
+        file_size: int,
+        seconds: Optional[float] = None
+    ) -> None:
+        """
+        Take a job off the backlog and fold its measured time in.
+        
+        Args:
+            ticket: Value returned by start()
+            file_size: Source file size in bytes
+            seconds: Separation time, or None if it failed or was cancelled
+        """
+        with self._lock:
+            entry = self._active.pop(ticket, None)
+            if entry is None:
+                return
+            engine_name, run = entry
+            stats = self._stats.setdefault(engine_name, _EngineStats())
+            stats.backlog_seconds = max(0.0, stats.backlog_seconds - run)
+            if seconds and seconds > 0 and file_size > 0:
+                stats.jobs += 1
+                stats.seconds += seconds
+                stats.megabytes += file_size / BYTES_PER_MB
+    
+    def record_quality(self, engine_name: str, genre: Optional[str], failed: bool) -> None:
+        """Fold a quality gate outcome into the fallback history."""
+        with self._lock:
+            counts = self._failures.setdefault((engine_name, genre), [0, 0])
+            counts[0] += 1
+            counts[1] += int(failed)
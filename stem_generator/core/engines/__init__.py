@@ -3,5 +3,6 @@
 from .base_engine import StemEngine
 from .demucs_engine import DemucsEngine
 from .lalal_engine import LalalEngine
+from .native_engine import NativeEngine
 
-__all__ = ["StemEngine", "DemucsEngine", "LalalEngine"]
+__all__ = ["StemEngine", "DemucsEngine", "LalalEngine", "NativeEngine"]
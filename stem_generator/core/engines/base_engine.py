@@ -5,10 +5,13 @@ Defines the interface that all stem separation engines must implement.
 """
 
 from abc import ABC, abstractmethod
+from concurrent.futures import Future
 from dataclasses import dataclass
 from pathlib import Path
 from typing import Optional
 
+import numpy as np
+
 
 @dataclass
 class SeparationResult:
@@ -18,6 +21,22 @@ class SeparationResult:
     processing_time_seconds: float
     engine_name: str
     error_message: Optional[str] = None
+    
+    # In-memory stems (stem_name -> (frames, channels) float32) for engines
+    # that hand audio over directly. When set, stem_paths may still be
+    # being written by `flush`.
+    stem_audio: Optional[dict[str, np.ndarray]] = None
+    sample_rate: Optional[int] = None
+    flush: Optional[Future] = None
+    
+    def wait_for_flush(self) -> None:
+        """Block until any background stem writes have reached disk."""
+        if self.flush is not None:
+            self.flush.result()
+    
+    def release_audio(self) -> None:
+        """Drop in-memory stems once consumers are done with them."""
+        self.stem_audio = None
 
 
 class StemEngine(ABC):
@@ -4,11 +4,40 @@ Demucs v4 Local Stem Separation Engine
 Uses Facebook's Demucs model for local GPU-accelerated stem separation.
 """
 
+import contextlib
+import queue
+import threading
 import time
+from collections import deque
+from concurrent.futures import Future, ThreadPoolExecutor
+from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Optional
+from typing import Callable, Optional
 
 from .base_engine import StemEngine, SeparationResult
+from .segment_stream import (
+    AudioSegment, SegmentReader, OverlapAddWriter, SegmentCheckpointWriter
+)
+from ...optimization.profiler import is_profiling, profile_stage
+from ...utils.audio_io import StemFormat, get_stem_format, write_stem
+
+
+# Background stem writes for in-memory handoff (shared by all engines)
+_FLUSH_POOL = ThreadPoolExecutor(max_workers=2, thread_name_prefix="stem-flush")
+
+
+@dataclass
+class _BatchTrack:
+    """Per-track state while a track's segments flow through a batch."""
+    input_path: Path
+    output_dir: Path
+    segments: queue.Queue
+    cancel: threading.Event = field(default_factory=threading.Event)
+    writer: Optional[OverlapAddWriter] = None
+    last_write: Optional[Future] = None
+    started_at: float = 0.0
+    finished_at: float = 0.0
+    error: Optional[str] = None
 
 
 class DemucsEngine(StemEngine):
@@ -18,6 +47,11 @@ class DemucsEngine(StemEngine):
     Demucs is a state-of-the-art music source separation model
     that separates audio into 4 stems: vocals, drums, bass, other.
     
+    Inference precision is selectable: fp32 (reference), fp16/bf16
+    autocast (activations in half precision, roughly halving VRAM per
+    segment) or int8 dynamic quantization of the linear/LSTM layers for
+    CPU-only nodes. PrecisionValidator checks each mode against fp32.
+    
     Requires: torch, torchaudio, demucs packages
     """
     
@@ -27,21 +61,78 @@ class DemucsEngine(StemEngine):
     # Stem name mapping (Demucs uses these exact names)
     STEM_NAMES = ["vocals", "drums", "bass", "other"]
     
-    def __init__(self, model_name: str = DEFAULT_MODEL, device: Optional[str] = None):
+    # Streaming mode window sizes (seconds at the model sample rate)
+    DEFAULT_SEGMENT_SECONDS = 30.0
+    DEFAULT_OVERLAP_SECONDS = 1.0
+    
+    # Streaming mode checkpoints every this many segments (0 disables).
+    # Off by default: checkpointed stems are spooled and encoded at the end,
+    # which only pays off for runs that can be resumed (batch jobs)
+    DEFAULT_CHECKPOINT_SEGMENTS = 0
+    RESUMABLE_CHECKPOINT_SEGMENTS = 4
+    CHECKPOINT_DIR_NAME = ".checkpoint"
+    
+    # Inference precision modes
+    PRECISIONS = ("fp32", "fp16", "bf16", "int8")
+    DEFAULT_PRECISION = "fp32"
+    
+    # Half-precision activations fit this many times more segments per batch
+    HALF_PRECISION_BATCH_FACTOR = 2
+    
+    def __init__(
+        self,
+        model_name: str = DEFAULT_MODEL,
+        device: Optional[str] = None,
+        streaming: bool = False,
+        segment_seconds: float = DEFAULT_SEGMENT_SECONDS,
+        overlap_seconds: float = DEFAULT_OVERLAP_SECONDS,
+        keep_in_memory: bool = False,
+        stem_format: Optional[str] = None,
+        checkpoint_segments: int = DEFAULT_CHECKPOINT_SEGMENTS,
+        precision: str = DEFAULT_PRECISION
+    ):
         """
         Initialize the Demucs engine.
         
         Args:
             model_name: Demucs model to use ('htdemucs', 'htdemucs_ft', etc.)
             device: PyTorch device ('cuda', 'cpu', or None for auto)
+            streaming: Decode, separate and write in overlapping segments
+                so peak RAM/VRAM does not grow with track length
+            segment_seconds: Segment length used in streaming mode
+            overlap_seconds: Cross-fade overlap between streaming segments
+            keep_in_memory: Return stems as in-memory buffers on the
+                result and write the files in the background (whole-file
+                mode only; streaming never holds a full track)
+            stem_format: Stem storage format ('wav', 'wav24', 'flac';
+                see utils.audio_io.STEM_FORMATS)
+            checkpoint_segments: In streaming mode, make progress durable
+                every this many segments so a crashed run resumes
+                mid-track (0 writes stems directly, without checkpoints)
+            precision: Inference precision ('fp32', 'fp16' and 'bf16'
+                autocast, or 'int8' dynamic quantization on CPU)
         """
+        if precision not in self.PRECISIONS:
+            raise ValueError(
+                f"Unknown precision '{precision}' (expected one of {', '.join(self.PRECISIONS)})"
+            )
+        
         self.model_name = model_name
         self._device = device
         self._model = None
         self._torch = None
+        self.streaming = streaming
+        self.segment_seconds = segment_seconds
+        self.overlap_seconds = overlap_seconds
+        self.keep_in_memory = keep_in_memory
+        self.stem_format = get_stem_format(stem_format)
+        self.checkpoint_segments = checkpoint_segments
+        self.precision = precision
     
     @property
     def name(self) -> str:
+        if self.precision != self.DEFAULT_PRECISION:
+            return f"demucs_{self.model_name}_{self.precision}"
         return f"demucs_{self.model_name}"
     
     def _lazy_import(self) -> bool:
@@ -81,10 +172,57 @@ class DemucsEngine(StemEngine):
         
         from demucs.pretrained import get_model
         
+        device_type = self._torch.device(self.device).type
+        if self.precision == "int8" and device_type != "cpu":
+            raise RuntimeError("int8 inference is CPU-only (use fp16/bf16 on GPUs)")
+        if self.precision == "fp16" and device_type != "cuda":
+            raise RuntimeError("fp16 inference needs a CUDA device (use bf16 or int8 on CPU)")
+        
         # Load the pretrained model
-        self._model = get_model(self.model_name)
-        self._model.to(self._torch.device(self.device))
-        self._model.eval()
+        model = get_model(self.model_name)
+        model.to(self._torch.device(self.device))
+        model.eval()
+        
+        if self.precision == "int8":
+            # Weights of the transformer/LSTM layers go to int8; activations
+            # are quantized on the fly. Convolutions stay fp32.
+            model = self._torch.quantization.quantize_dynamic(
+                model,
+                {self._torch.nn.Linear, self._torch.nn.LSTM},
+                dtype=self._torch.qint8
+            )
+        
+        self._model = model
+    
+    def _autocast(self):
+        """Autocast context for the configured precision."""
+        if self.precision == "fp16":
+            dtype = self._torch.float16
+        elif self.precision == "bf16":
+            dtype = self._torch.bfloat16
+        else:
+            return contextlib.nullcontext()
+        return self._torch.autocast(
+            device_type=self._torch.device(self.device).type, dtype=dtype
+        )
+    
+    def _apply(self, waveform):
+        """
+        Run the model on a (batch, channels, frames) waveform.
+        
+        Returns:
+            (batch, sources, channels, frames) float32 tensor on the device
+        """
+        from demucs.apply import apply_model
+        
+        with profile_stage("inference"):
+            with self._torch.no_grad(), self._autocast():
+                sources = apply_model(self._model, waveform, device=self.device)
+            sources = sources.float()
+            if is_profiling() and self.device.startswith("cuda"):
+                # Charge queued kernels to inference, not to the copy-out
+                self._torch.cuda.synchronize(self.device)
+        return sources
     
     def separate(self, input_path: Path, output_dir: Path) -> SeparationResult:
         """
@@ -97,6 +235,9 @@ class DemucsEngine(StemEngine):
         Returns:
             SeparationResult with paths to generated stems
         """
+        if self.streaming:
+            return self._separate_streaming(input_path, output_dir)
+        
         start_time = time.time()
         stem_paths = {}
         
@@ -104,13 +245,14 @@ class DemucsEngine(StemEngine):
             self._load_model()
             
             import librosa
-            from demucs.apply import apply_model
+            import torchaudio
             
             # Ensure output directory exists
             output_dir.mkdir(parents=True, exist_ok=True)
             
             # Load audio file using librosa (better format support)
-            audio_np, sample_rate = librosa.load(str(input_path), sr=None, mono=False)
+            with profile_stage("decode"):
+                audio_np, sample_rate = librosa.load(str(input_path), sr=None, mono=False)
             
             # librosa returns (samples,) for mono or (channels, samples) for stereo
             if audio_np.ndim == 1:
@@ -131,35 +273,159 @@ class DemucsEngine(StemEngine):
                     orig_freq=sample_rate, 
                     new_freq=self._model.samplerate
                 )
-                waveform = resampler(waveform)
+                with profile_stage("resample"):
+                    waveform = resampler(waveform)
                 sample_rate = self._model.samplerate
             
             # Add batch dimension and move to device
             waveform = waveform.unsqueeze(0).to(self.device)
             
             # Apply the model
-            with self._torch.no_grad():
-                sources = apply_model(self._model, waveform, device=self.device)
+            sources = self._apply(waveform)
             
             # sources shape: (batch, num_sources, channels, samples)
-            # Remove batch dimension
-            sources = sources.squeeze(0)
-            
-            # Save each stem using soundfile (better compatibility)
-            import soundfile as sf
+            # Remove batch dimension and copy to host once; every stem
+            # below is a view into this one array
+            sources = sources.squeeze(0).cpu().numpy()
             
+            stem_audio = {}
             for idx, stem_name in enumerate(self._model.sources):
                 if stem_name in self.STEM_NAMES:
-                    output_path = output_dir / f"{stem_name}.wav"
-                    stem_audio = sources[idx].cpu().numpy()
-                    
+                    stem_paths[stem_name] = self._stem_path(output_dir, stem_name)
                     # soundfile expects (samples, channels) shape
-                    sf.write(
-                        str(output_path),
-                        stem_audio.T,  # Transpose to (samples, channels)
-                        sample_rate
-                    )
-                    stem_paths[stem_name] = output_path
+                    stem_audio[stem_name] = sources[idx].T
+            
+            # Save each stem using soundfile (better compatibility)
+            flush = None
+            if self.keep_in_memory:
+                flush = _FLUSH_POOL.submit(
+                    self._write_stems, stem_audio, stem_paths, sample_rate, self.stem_format
+                )
+            else:
+                self._write_stems(stem_audio, stem_paths, sample_rate, self.stem_format)
+                stem_audio = None
+            
+            processing_time = time.time() - start_time
+            
+            return SeparationResult(
+                success=True,
+                stem_paths=stem_paths,
+                processing_time_seconds=processing_time,
+                engine_name=self.name,
+                stem_audio=stem_audio,
+                sample_rate=sample_rate if stem_audio else None,
+                flush=flush
+            )
+            
+        except Exception as e:
+            processing_time = time.time() - start_time
+            return SeparationResult(
+                success=False,
+                stem_paths=stem_paths,
+                processing_time_seconds=processing_time,
+                engine_name=self.name,
+                error_message=str(e)
+            )
+    
+    @staticmethod
+    def _write_stems(
+        stem_audio: dict,
+        stem_paths: dict[str, Path],
+        sample_rate: int,
+        stem_format: StemFormat
+    ) -> None:
+        """Write (frames, channels) stem buffers to their output paths."""
+        for stem_name, audio in stem_audio.items():
+            write_stem(stem_paths[stem_name], audio, sample_rate, stem_format)
+    
+    def _stem_path(self, output_dir: Path, stem_name: str) -> Path:
+        """Get the output path of a stem in the configured format."""
+        return output_dir / f"{stem_name}{self.stem_format.extension}"
+    
+    def _separate_streaming(self, input_path: Path, output_dir: Path) -> SeparationResult:
+        """
+        Separate audio in overlapping segments, writing stems as it goes.
+        
+        Only one segment and its four sources are resident on the device
+        at a time, and each segment's finished frames are appended to the
+        stem files before the next one is decoded. With checkpointing on,
+        frames go to spools under output_dir/.checkpoint instead and a
+        rerun after a crash picks up at the last checkpointed segment.
+        
+        Args:
+            input_path: Path to input audio file
+            output_dir: Directory to save output stems
+            
+        Returns:
+            SeparationResult with paths to generated stems
+        """
+        start_time = time.time()
+        stem_paths = {}
+        
+        try:
+            self._load_model()
+            
+            output_dir.mkdir(parents=True, exist_ok=True)
+            
+            sample_rate = self._model.samplerate
+            segment_frames = int(self.segment_seconds * sample_rate)
+            overlap_frames = int(self.overlap_seconds * sample_rate)
+            
+            stem_indices = self._stem_indices()
+            stem_paths = {
+                stem_name: self._stem_path(output_dir, stem_name)
+                for stem_name in stem_indices
+            }
+            
+            reader = SegmentReader(input_path, sample_rate, segment_frames, overlap_frames)
+            
+            if self.checkpoint_segments > 0:
+                st = input_path.stat()
+                writer = SegmentCheckpointWriter(
+                    stem_paths, stem_indices, sample_rate, overlap_frames,
+                    checkpoint_dir=output_dir / self.CHECKPOINT_DIR_NAME,
+                    identity={
+                        "source": str(input_path.resolve()),
+                        "size": st.st_size,
+                        "mtime_ns": st.st_mtime_ns,
+                        "model": self.model_name,
+                        "precision": self.precision,
+                        "sample_rate": sample_rate,
+                        "segment_frames": segment_frames,
+                        "overlap_frames": overlap_frames,
+                        "stems": sorted(stem_indices),
+                    },
+                    stem_format=self.stem_format
+                )
+            else:
+                writer = OverlapAddWriter(
+                    stem_paths, stem_indices, sample_rate, overlap_frames,
+                    stem_format=self.stem_format
+                )
+            
+            with writer:
+                resume_segment = getattr(writer, "resume_segment", 0)
+                
+                for segment in reader:
+                    if segment.index < resume_segment:
+                        continue  # Already separated before a restart
+                    
+                    waveform = self._torch.from_numpy(segment.audio).unsqueeze(0).to(self.device)
+                    
+                    sources = self._apply(waveform)
+                    
+                    # (1, sources, channels, frames) -> drop padding, move off device
+                    segment_out = sources[0, :, :, :segment.valid_frames].cpu().numpy()
+                    del sources, waveform
+                    
+                    writer.push(segment_out, segment.is_last)
+                    
+                    if (
+                        self.checkpoint_segments > 0
+                        and not segment.is_last
+                        and (segment.index + 1) % self.checkpoint_segments == 0
+                    ):
+                        writer.checkpoint(segment.index)
             
             processing_time = time.time() - start_time
             
@@ -180,8 +446,209 @@ class DemucsEngine(StemEngine):
                 error_message=str(e)
             )
     
+    def _stem_indices(self) -> dict[str, int]:
+        """Map output stem names to indices on the model's source axis."""
+        return {
+            stem_name: idx
+            for idx, stem_name in enumerate(self._model.sources)
+            if stem_name in self.STEM_NAMES
+        }
+    
+    @staticmethod
+    def _prefetch_segments(reader: SegmentReader, track: _BatchTrack) -> None:
+        """Decode a track's segments into its queue (runs on a decode thread)."""
+        try:
+            for segment in reader:
+                while True:
+                    if track.cancel.is_set():
+                        return
+                    try:
+                        track.segments.put(segment, timeout=0.5)
+                        break
+                    except queue.Full:
+                        continue
+        except Exception as e:
+            track.segments.put(e)
+    
+    @staticmethod
+    def _chain_write(
+        pool: ThreadPoolExecutor,
+        previous: Optional[Future],
+        fn: Callable,
+        *args
+    ) -> Future:
+        """Submit a write that runs only after the track's previous write."""
+        def run():
+            if previous is not None:
+                previous.result()
+            return fn(*args)
+        return pool.submit(run)
+    
+    def separate_batch(
+        self,
+        jobs: list[tuple[Path, Path]],
+        batch_size: Optional[int] = None,
+        write_workers: int = 2
+    ) -> list[SeparationResult]:
+        """
+        Separate several tracks, packing their segments into shared batches.
+        
+        Up to `batch_size` tracks are active at once; each inference call
+        stacks one segment from every active track into a single
+        `apply_model` batch. Decoding/resampling runs ahead on one thread
+        per active track (plus one track of lookahead) and stem encoding
+        runs on a separate writer pool, so the GPU isn't left waiting on
+        librosa/soundfile between calls.
+        
+        Args:
+            jobs: List of (input_path, output_dir) pairs
+            batch_size: Segments per inference call (defaults to
+                get_recommended_batch_size())
+            write_workers: Threads used for stem encoding
+        
+        Returns:
+            SeparationResult for each job, in the same order
+        """
+        batch_size = max(1, batch_size or self.get_recommended_batch_size())
+        
+        try:
+            self._load_model()
+            import numpy as np
+        except Exception as e:
+            return [
+                SeparationResult(
+                    success=False,
+                    stem_paths={},
+                    processing_time_seconds=0,
+                    engine_name=self.name,
+                    error_message=str(e)
+                )
+                for _ in jobs
+            ]
+        
+        sample_rate = self._model.samplerate
+        segment_frames = int(self.segment_seconds * sample_rate)
+        overlap_frames = int(self.overlap_seconds * sample_rate)
+        stem_indices = self._stem_indices()
+        
+        tracks = [
+            _BatchTrack(
+                input_path=Path(input_path),
+                output_dir=Path(output_dir),
+                segments=queue.Queue(maxsize=2)
+            )
+            for input_path, output_dir in jobs
+        ]
+        
+        def fail(track: _BatchTrack, message: str) -> None:
+            track.error = message
+            track.cancel.set()
+            if track.writer is not None:
+                track.last_write = self._chain_write(
+                    write_pool, track.last_write, track.writer.abort
+                )
+        
+        pending = deque(tracks)
+        active: list[_BatchTrack] = []
+        
+        with ThreadPoolExecutor(batch_size + 1, thread_name_prefix="demucs-decode") as decode_pool, \
+                ThreadPoolExecutor(write_workers, thread_name_prefix="demucs-write") as write_pool:
+            
+            # Pool is FIFO, so tracks start decoding in order as slots free up
+            for track in tracks:
+                reader = SegmentReader(
+                    track.input_path, sample_rate, segment_frames, overlap_frames
+                )
+                decode_pool.submit(self._prefetch_segments, reader, track)
+            
+            while pending or active:
+                while pending and len(active) < batch_size:
+                    track = pending.popleft()
+                    track.started_at = time.time()
+                    try:
+                        track.output_dir.mkdir(parents=True, exist_ok=True)
+                        track.writer = OverlapAddWriter(
+                            {name: self._stem_path(track.output_dir, name) for name in stem_indices},
+                            stem_indices,
+                            sample_rate,
+                            overlap_frames,
+                            stem_format=self.stem_format
+                        )
+                        track.writer.open()
+                    except Exception as e:
+                        fail(track, str(e))
+                        track.finished_at = time.time()
+                        continue
+                    active.append(track)
+                
+                batch: list[tuple[_BatchTrack, AudioSegment]] = []
+                for track in list(active):
+                    item = track.segments.get()
+                    if isinstance(item, Exception):
+                        fail(track, str(item))
+                        active.remove(track)
+                        track.finished_at = time.time()
+                        continue
+                    batch.append((track, item))
+                
+                if not batch:
+                    continue
+                
+                try:
+                    waveform = self._torch.from_numpy(
+                        np.stack([segment.audio for _, segment in batch])
+                    ).to(self.device)
+                    
+                    sources = self._apply(waveform)
+                    
+                    # (batch, sources, channels, frames)
+                    batch_out = sources.cpu().numpy()
+                    del sources, waveform
+                except Exception as e:
+                    for track, _ in batch:
+                        fail(track, str(e))
+                        active.remove(track)
+                        track.finished_at = time.time()
+                    continue
+                
+                for i, (track, segment) in enumerate(batch):
+                    segment_out = batch_out[i, :, :, :segment.valid_frames]
+                    track.last_write = self._chain_write(
+                        write_pool, track.last_write,
+                        track.writer.push, segment_out, segment.is_last
+                    )
+                    if segment.is_last:
+                        track.last_write = self._chain_write(
+                            write_pool, track.last_write, track.writer.close
+                        )
+                        active.remove(track)
+                        track.finished_at = time.time()
+            
+            # Wait for each track's writes to land before reporting success
+            for track in tracks:
+                if track.last_write is None:
+                    continue
+                try:
+                    track.last_write.result()
+                except Exception as e:
+                    if track.error is None:
+                        track.error = str(e)
+                        track.writer.abort()
+        
+        results = []
+        for track in tracks:
+            stem_paths = dict(track.writer.stem_paths) if track.writer and not track.error else {}
+            results.append(SeparationResult(
+                success=track.error is None,
+                stem_paths=stem_paths,
+                processing_time_seconds=max(0.0, track.finished_at - track.started_at),
+                engine_name=self.name,
+                error_message=track.error
+            ))
+        return results
+    
     def get_recommended_batch_size(self) -> int:
-        """Get recommended batch size based on available VRAM."""
+        """Get recommended batch size based on available VRAM and precision."""
         if not self._lazy_import():
             return 1
             
@@ -194,10 +661,14 @@ class DemucsEngine(StemEngine):
             vram_gb = vram_bytes / (1024 ** 3)
             
             if vram_gb >= 16:
-                return 4
+                batch_size = 4
             elif vram_gb >= 12:
-                return 2
+                batch_size = 2
             else:
-                return 1
+                batch_size = 1
         except Exception:
             return 1
+        
+        if self.precision in ("fp16", "bf16"):
+            batch_size *= self.HALF_PRECISION_BATCH_FACTOR
+        return batch_size
@@ -7,7 +7,10 @@ Requires API key set in environment variable LALAL_API_KEY.
 
 import logging
 import os
+import random
+import threading
 import time
+from concurrent.futures import Future, ThreadPoolExecutor
 from pathlib import Path
 from typing import Optional
 
@@ -15,6 +18,7 @@ import requests
 from dotenv import load_dotenv
 
 from .base_engine import StemEngine, SeparationResult
+from ...utils.file_linker import prepare_output
 
 
 logger = logging.getLogger(__name__)
@@ -25,6 +29,12 @@ ALLOWED_EXTENSIONS = {'.mp3', '.wav', '.flac', '.ogg', '.m4a', '.aac', '.wma'}
 # Maximum file size for upload (100 MB)
 MAX_FILE_SIZE_BYTES = 100 * 1024 * 1024
 
+# Cloud jobs kept in flight at once (override with LALAL_MAX_JOBS)
+MAX_IN_FLIGHT = 4
+
+# Stem downloads are streamed to disk in chunks of this size
+DOWNLOAD_CHUNK_BYTES = 1024 * 1024
+
 
 class LalalEngine(StemEngine):
     """
@@ -33,6 +43,13 @@ class LalalEngine(StemEngine):
     LALAL.AI provides high-quality stem separation as a cloud service.
     Useful as a fallback when local processing quality is insufficient.
     
+    Jobs are pipelined: submit() returns a Future immediately and up to
+    `max_in_flight` jobs upload, process and download concurrently, so
+    cloud work runs alongside local Demucs rather than blocking a worker
+    per track. Status polling backs off adaptively, the stems of a
+    finished job are downloaded in parallel, and all requests share one
+    keep-alive session.
+    
     Requires: LALAL_API_KEY environment variable
     """
     
@@ -51,15 +68,33 @@ class LalalEngine(StemEngine):
         "other": "other"
     }
     
-    def __init__(self, api_key: Optional[str] = None):
+    # Status polling: start fast, back off geometrically up to the cap
+    POLL_INITIAL_SECONDS = 1.0
+    POLL_MAX_SECONDS = 20.0
+    POLL_BACKOFF = 1.6
+    
+    def __init__(self, api_key: Optional[str] = None, max_in_flight: Optional[int] = None):
         """
         Initialize the LALAL.AI engine.
         
         Args:
             api_key: LALAL.AI API key (or set LALAL_API_KEY env var)
+            max_in_flight: Concurrent cloud jobs (or set LALAL_MAX_JOBS,
+                default MAX_IN_FLIGHT)
         """
         load_dotenv()
         self._api_key = api_key or os.getenv("LALAL_API_KEY")
+        self.max_in_flight = max(1, max_in_flight or int(os.getenv("LALAL_MAX_JOBS", MAX_IN_FLIGHT)))
+        
+        # Created on first use
+        self._session: Optional[requests.Session] = None
+        self._job_pool: Optional[ThreadPoolExecutor] = None
+        self._download_pool: Optional[ThreadPoolExecutor] = None
+        self._lock = threading.Lock()
+        
+        # Submitted-but-unfinished and currently running jobs (metrics)
+        self.jobs_submitted = 0
+        self.jobs_running = 0
     
     @property
     def name(self) -> str:
@@ -69,6 +104,42 @@ class LalalEngine(StemEngine):
         """Check if LALAL.AI API key is configured."""
         return bool(self._api_key)
     
+    def get_recommended_batch_size(self) -> int:
+        """Cloud jobs are limited by in-flight slots, not local memory."""
+        return self.max_in_flight
+    
+    def _get_session(self) -> requests.Session:
+        """Get the shared HTTP session, sized for every in-flight request."""
+        with self._lock:
+            if self._session is None:
+                from requests.adapters import HTTPAdapter
+                
+                # One upload/poll per job plus one download per stem
+                pool_size = self.max_in_flight * (1 + len(self.STEM_TYPES))
+                session = requests.Session()
+                adapter = HTTPAdapter(pool_connections=4, pool_maxsize=pool_size)
+                session.mount("https://", adapter)
+                session.mount("http://", adapter)
+                self._session = session
+            return self._session
+    
+    def _get_pools(self) -> tuple[ThreadPoolExecutor, ThreadPoolExecutor]:
+        """Get the (job, download) thread pools."""
+        with self._lock:
+            if self._job_pool is None:
+                self._job_pool = ThreadPoolExecutor(
+                    max_workers=self.max_in_flight, thread_name_prefix="lalal-job"
+                )
+                self._download_pool = ThreadPoolExecutor(
+                    max_workers=self.max_in_flight * len(self.STEM_TYPES),
+                    thread_name_prefix="lalal-download"
+                )
+            return self._job_pool, self._download_pool
+    
+    def _auth_headers(self) -> dict[str, str]:
+        """Headers for API calls (never sent to download URLs)."""
+        return {"Authorization": f"license {self._api_key}"}
+    
     def _validate_file(self, file_path: Path) -> tuple[bool, str]:
         """
         Validate file before upload.
@@ -80,16 +151,16 @@ class LalalEngine(StemEngine):
         if file_path.suffix.lower() not in ALLOWED_EXTENSIONS:
             return False, f"Unsupported file type: {file_path.suffix}"
         
+        # Check file exists and is readable
+        if not file_path.exists():
+            return False, "File does not exist"
+        
         # Check file size
         file_size = file_path.stat().st_size
         if file_size > MAX_FILE_SIZE_BYTES:
             size_mb = file_size / (1024 * 1024)
             return False, f"File too large: {size_mb:.1f}MB (max 100MB)"
         
-        # Check file exists and is readable
-        if not file_path.exists():
-            return False, "File does not exist"
-        
         return True, ""
     
     def _validate_api_response(self, response: dict, required_fields: list[str]) -> bool:
@@ -103,16 +174,12 @@ class LalalEngine(StemEngine):
         Returns:
             Job ID if successful, None otherwise
         """
-        headers = {
-            "Authorization": f"license {self._api_key}"
-        }
-        
         try:
             with open(file_path, 'rb') as f:
                 files = {"file": (file_path.name, f)}
-                response = requests.post(
+                response = self._get_session().post(
                     f"{self.API_BASE_URL}{self.UPLOAD_ENDPOINT}",
-                    headers=headers,
+                    headers=self._auth_headers(),
                     files=files,
                     data={"stem": "vocals"},
                     timeout=120  # 2 minute timeout for upload
@@ -139,17 +206,17 @@ class LalalEngine(StemEngine):
         """
         Check the status of a processing job.
         
+        Rate limiting (429), server errors and network failures are
+        reported as a "retry" status so polling continues; only a
+        rejected request ends the job.
+        
         Returns:
             Status dictionary with 'status' and result URLs
         """
-        headers = {
-            "Authorization": f"license {self._api_key}"
-        }
-        
         try:
-            response = requests.get(
+            response = self._get_session().get(
                 f"{self.API_BASE_URL}{self.CHECK_ENDPOINT}",
-                headers=headers,
+                headers=self._auth_headers(),
                 params={"id": job_id},
                 timeout=30
             )
@@ -159,76 +226,132 @@ class LalalEngine(StemEngine):
                 if self._validate_api_response(data, ["status"]):
                     return data
                 logger.warning("Invalid status response: missing 'status' field")
+            elif response.status_code == 429 or response.status_code >= 500:
+                logger.debug(f"Status check deferred: {response.status_code}")
+                try:
+                    retry_after = float(response.headers.get("Retry-After", 0))
+                except ValueError:
+                    retry_after = 0.0
+                return {"status": "retry", "retry_after": retry_after}
             else:
                 logger.warning(f"Status check failed: {response.status_code}")
         except requests.RequestException as e:
             logger.warning(f"Status check request failed: {type(e).__name__}")
+            return {"status": "retry"}
         
         return {"status": "error"}
     
+    def _next_poll_interval(self, interval: float, status: dict, elapsed: float) -> float:
+        """
+        Pick the delay before the next status check.
+        
+        Honors Retry-After, otherwise aims halfway to the completion time
+        extrapolated from reported progress, otherwise backs off
+        geometrically. Always within [POLL_INITIAL_SECONDS, POLL_MAX_SECONDS].
+        """
+        retry_after = status.get("retry_after")
+        if retry_after:
+            return max(retry_after, self.POLL_INITIAL_SECONDS)
+        
+        progress = status.get("progress")  # Percent complete, when reported
+        if isinstance(progress, (int, float)) and 0 < progress < 100:
+            remaining = elapsed * (100 - progress) / progress
+            return min(max(remaining / 2, self.POLL_INITIAL_SECONDS), self.POLL_MAX_SECONDS)
+        
+        return min(interval * self.POLL_BACKOFF, self.POLL_MAX_SECONDS)
+    
     def _download_stem(self, url: str, output_path: Path) -> bool:
         """
-        Download a processed stem from LALAL.AI.
+        Stream a processed stem from LALAL.AI to disk.
+        
+        Writes to a temporary name and renames on completion, so an
+        interrupted download never leaves a truncated stem behind.
         
         Returns:
             True if successful, False otherwise
         """
+        partial_path = prepare_output(output_path.with_name(f".{output_path.name}.part"))
         try:
-            response = requests.get(url, stream=True, timeout=120)
-            if response.status_code == 200:
-                output_path.parent.mkdir(parents=True, exist_ok=True)
-                with open(output_path, 'wb') as f:
-                    for chunk in response.iter_content(chunk_size=8192):
+            with self._get_session().get(url, stream=True, timeout=120) as response:
+                if response.status_code != 200:
+                    logger.error(f"Download failed: {response.status_code}")
+                    return False
+                with open(partial_path, 'wb') as f:
+                    for chunk in response.iter_content(chunk_size=DOWNLOAD_CHUNK_BYTES):
                         f.write(chunk)
-                logger.debug(f"Downloaded stem to: {output_path}")
-                return True
-            else:
-                logger.error(f"Download failed: {response.status_code}")
+            os.replace(partial_path, output_path)
+            logger.debug(f"Downloaded stem to: {output_path}")
+            return True
         except requests.RequestException as e:
             logger.error(f"Download request failed: {type(e).__name__}")
         except IOError as e:
             logger.error(f"Failed to write file: {type(e).__name__}")
+        finally:
+            partial_path.unlink(missing_ok=True)
         
         return False
     
+    def _download_stems(self, result: dict, output_dir: Path) -> dict[str, Path]:
+        """Download every stem of a finished job concurrently."""
+        _, download_pool = self._get_pools()
+        downloads: dict[str, tuple[Path, Future]] = {}
+        
+        for stem_name, lalal_name in self.STEM_TYPES.items():
+            url = result.get(lalal_name)
+            if url:
+                output_path = output_dir / f"{stem_name}.wav"
+                downloads[stem_name] = (
+                    output_path,
+                    download_pool.submit(self._download_stem, url, output_path)
+                )
+        
+        return {
+            stem_name: output_path
+            for stem_name, (output_path, future) in downloads.items()
+            if future.result()
+        }
+    
     def _wait_for_completion(self, job_id: str, timeout: int = 600) -> dict:
         """
-        Poll for job completion.
+        Poll for job completion with adaptive backoff.
         
         Args:
             job_id: The job ID to check
             timeout: Maximum seconds to wait
-            
+        
         Returns:
             Final status dictionary
         """
         start_time = time.time()
-        poll_interval = 5  # seconds
+        interval = self.POLL_INITIAL_SECONDS
         
-        while time.time() - start_time < timeout:
+        while True:
             status = self._check_status(job_id)
             
             if status.get("status") in ("done", "error"):
                 return status
-                
-            time.sleep(poll_interval)
-        
-        return {"status": "timeout"}
-    
-    def separate(self, input_path: Path, output_dir: Path) -> SeparationResult:
-        """
-        Separate audio into stems using LALAL.AI cloud API.
-        
-        Note: LALAL.AI processes one stem type at a time, so this
-        makes multiple API calls (one per stem type).
-        
-        Args:
-            input_path: Path to input audio file
-            output_dir: Directory to save output stems
             
-        Returns:
-            SeparationResult with paths to generated stems
-        """
+            elapsed = time.time() - start_time
+            if elapsed >= timeout:
+                return {"status": "timeout"}
+            
+            interval = self._next_poll_interval(interval, status, elapsed)
+            # Jitter keeps concurrent jobs from polling in lockstep
+            time.sleep(min(interval * random.uniform(0.8, 1.2), timeout - elapsed))
+    
+    def _run_job(self, input_path: Path, output_dir: Path) -> SeparationResult:
+        """Job pool entry point; keeps the in-flight counters."""
+        with self._lock:
+            self.jobs_running += 1
+        try:
+            return self._separate_job(input_path, output_dir)
+        finally:
+            with self._lock:
+                self.jobs_running -= 1
+                self.jobs_submitted -= 1
+    
+    def _separate_job(self, input_path: Path, output_dir: Path) -> SeparationResult:
+        """Run one cloud job end to end (on a job pool thread)."""
         start_time = time.time()
         stem_paths = {}
         
@@ -273,12 +396,7 @@ class LalalEngine(StemEngine):
             
             # Download available stems
             if "result" in result:
-                for stem_name, lalal_name in self.STEM_TYPES.items():
-                    url = result["result"].get(lalal_name)
-                    if url:
-                        output_path = output_dir / f"{stem_name}.wav"
-                        if self._download_stem(url, output_path):
-                            stem_paths[stem_name] = output_path
+                stem_paths = self._download_stems(result["result"], output_dir)
             
             processing_time = time.time() - start_time
             
@@ -292,7 +410,7 @@ class LalalEngine(StemEngine):
                 engine_name=self.name,
                 error_message=None if success else "Not all stems were retrieved"
             )
-            
+        
         except Exception as e:
             processing_time = time.time() - start_time
             return SeparationResult(
@@ -302,3 +420,70 @@ class LalalEngine(StemEngine):
                 engine_name=self.name,
                 error_message=str(e)
             )
+
+    def submit(self, input_path: Path, output_dir: Path) -> Future:
+        """
+        Queue a cloud separation and return immediately.
+        
+        At most `max_in_flight` jobs run at once; the rest wait their turn.
+        
+        Args:
+            input_path: Path to input audio file
+            output_dir: Directory to save output stems
+        
+        Returns:
+            Future resolving to the SeparationResult (never raises)
+        """
+        job_pool, _ = self._get_pools()
+        future = job_pool.submit(self._run_job, Path(input_path), Path(output_dir))
+        with self._lock:
+            self.jobs_submitted += 1
+        # Jobs cancelled before they start never reach _run_job
+        future.add_done_callback(self._on_cancelled)
+        return future
+    
+    def _on_cancelled(self, future: Future) -> None:
+        if future.cancelled():
+            with self._lock:
+                self.jobs_submitted -= 1
+    
+    def separate_many(self, jobs: list[tuple[Path, Path]]) -> list[SeparationResult]:
+        """
+        Separate several files with up to `max_in_flight` cloud jobs at once.
+        
+        Args:
+            jobs: List of (input_path, output_dir) pairs
+        
+        Returns:
+            SeparationResult for each job, in the same order
+        """
+        futures = [self.submit(input_path, output_dir) for input_path, output_dir in jobs]
+        return [future.result() for future in futures]
+    
+    def separate(self, input_path: Path, output_dir: Path) -> SeparationResult:
+        """
+        Separate audio into stems using LALAL.AI cloud API.
+        
+        Note: LALAL.AI processes one stem type at a time, so this
+        makes multiple API calls (one per stem type).
+        
+        Args:
+            input_path: Path to input audio file
+            output_dir: Directory to save output stems
+        
+        Returns:
+            SeparationResult with paths to generated stems
+        """
+        return self.submit(input_path, output_dir).result()
+    
+    def close(self) -> None:
+        """Wait for in-flight jobs, then release the pools and session."""
+        with self._lock:
+            job_pool, download_pool, session = self._job_pool, self._download_pool, self._session
+            self._job_pool = self._download_pool = self._session = None
+        
+        if job_pool is not None:
+            job_pool.shutdown(wait=True)
+            download_pool.shutdown(wait=True)
+        if session is not None:
+            session.close()
@@ -0,0 +1,124 @@
+/*
+ * Stem Generator native engine ABI
+ *
+ * A separation backend (UVR/MDX, ONNX Runtime, TensorRT, ...) built as a
+ * shared library that exports the functions below can be loaded by
+ * stem_generator.core.engines.native_engine.NativeEngine and selected in
+ * StemPipeline with engine="native" (or "uvr").
+ *
+ * The host decodes and resamples the source, cuts it into fixed-length
+ * overlapping segments and cross-fades the results; the engine only maps
+ * segments of audio to segments of stems, buffer in / buffer out. No
+ * files cross the boundary.
+ *
+ * Rules:
+ *   - Plain C, no C++ types or exceptions across the boundary.
+ *   - All buffers are owned by the host and are float32, planar and
+ *     contiguous.
+ *   - Output of stem_engine_process is time-aligned with its input; an
+ *     engine with internal delay compensates for it inside the segment.
+ *   - Unless STEM_ENGINE_CAP_THREAD_SAFE is reported, the host never
+ *     calls into one instance from two threads at once.
+ *   - The ABI version is bumped on any incompatible change. StemEngineInfo
+ *     may grow at the end; the host passes its struct_size.
+ */
+
+#ifndef STEM_ENGINE_H
+#define STEM_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define STEM_ENGINE_ABI_VERSION 1
+
+#if defined(_WIN32)
+#  define STEM_ENGINE_EXPORT __declspec(dllexport)
+#else
+#  define STEM_ENGINE_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Status codes */
+#define STEM_ENGINE_OK                 0
+#define STEM_ENGINE_ERROR             -1  /* details in stem_engine_last_error */
+#define STEM_ENGINE_INVALID_ARGUMENT  -2
+#define STEM_ENGINE_OUT_OF_MEMORY     -3
+#define STEM_ENGINE_UNAVAILABLE       -4  /* e.g. required device missing */
+
+/* Capability flags */
+#define STEM_ENGINE_CAP_THREAD_SAFE  (1u << 0)  /* concurrent process() calls allowed */
+#define STEM_ENGINE_CAP_GPU          (1u << 1)  /* runs on an accelerator */
+#define STEM_ENGINE_CAP_STATEFUL     (1u << 2)  /* depends on previous segments; reset per track */
+#define STEM_ENGINE_CAP_ANY_LENGTH   (1u << 3)  /* accepts any segment length */
+
+#define STEM_ENGINE_MAX_STEMS    8
+#define STEM_ENGINE_NAME_LENGTH  32
+
+typedef struct StemEngineInfo {
+    uint32_t struct_size;       /* set by the host to sizeof(StemEngineInfo) */
+    uint32_t abi_version;       /* STEM_ENGINE_ABI_VERSION the engine was built with */
+    char     name[STEM_ENGINE_NAME_LENGTH];   /* short identifier, e.g. "mdx_onnx" */
+
+    uint32_t sample_rate;       /* rate input segments are delivered at */
+    uint32_t channels;          /* 1 or 2 */
+
+    uint32_t num_stems;
+    char     stem_names[STEM_ENGINE_MAX_STEMS][STEM_ENGINE_NAME_LENGTH];  /* output order */
+
+    uint32_t segment_frames;    /* preferred segment length */
+    uint32_t overlap_frames;    /* recommended overlap between segments */
+    uint32_t latency_frames;    /* delay a real-time host incurs (reporting only) */
+    uint32_t max_batch;         /* most segments per process() call (>= 1) */
+    uint32_t capabilities;      /* STEM_ENGINE_CAP_* */
+} StemEngineInfo;
+
+typedef struct StemEngineHandle StemEngineHandle;
+
+/* ABI version of the library; checked before anything else is called. */
+STEM_ENGINE_EXPORT uint32_t stem_engine_abi_version(void);
+
+/*
+ * Create an engine instance.
+ *
+ * config is an engine-specific, NUL-terminated (typically JSON) string,
+ * or NULL. On failure returns NULL and writes a message to error.
+ */
+STEM_ENGINE_EXPORT StemEngineHandle* stem_engine_create(
+    const char* config, char* error, size_t error_length);
+
+/* Fill info (the host sets info->struct_size first). */
+STEM_ENGINE_EXPORT int stem_engine_get_info(
+    StemEngineHandle* engine, StemEngineInfo* info);
+
+/*
+ * Separate a batch of segments.
+ *
+ * input:  [batch][channels][frames]
+ * output: [batch][num_stems][channels][frames], allocated by the host
+ *
+ * frames equals segment_frames unless STEM_ENGINE_CAP_ANY_LENGTH is set;
+ * batch is at most max_batch.
+ */
+STEM_ENGINE_EXPORT int stem_engine_process(
+    StemEngineHandle* engine,
+    const float* input,
+    uint32_t batch,
+    uint32_t frames,
+    float* output);
+
+/* Clear state between tracks (required for STEM_ENGINE_CAP_STATEFUL). */
+STEM_ENGINE_EXPORT void stem_engine_reset(StemEngineHandle* engine);
+
+/* Message for the last failed call on this instance (never NULL). */
+STEM_ENGINE_EXPORT const char* stem_engine_last_error(StemEngineHandle* engine);
+
+STEM_ENGINE_EXPORT void stem_engine_destroy(StemEngineHandle* engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STEM_ENGINE_H */
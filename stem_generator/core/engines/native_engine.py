@@ -0,0 +1,392 @@
+"""
+Native Stem Separation Engine
+
+Hosts separation backends compiled against the C ABI in
+native/stem_engine.h (UVR/MDX, ONNX Runtime, TensorRT, ...) through
+ctypes. Configure with STEM_NATIVE_ENGINE (path to the shared library)
+and optionally STEM_NATIVE_CONFIG (engine-specific config string).
+"""
+
+import ctypes
+import logging
+import os
+import threading
+import time
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Optional
+
+import numpy as np
+
+from .base_engine import StemEngine, SeparationResult
+from .segment_stream import OverlapAddWriter, SegmentReader
+from ...optimization.profiler import profile_stage
+from ...utils.audio_io import get_stem_format
+
+
+logger = logging.getLogger(__name__)
+
+# Must match STEM_ENGINE_ABI_VERSION in native/stem_engine.h
+ABI_VERSION = 1
+
+MAX_STEMS = 8
+NAME_LENGTH = 32
+
+# Capability flags (STEM_ENGINE_CAP_*)
+CAP_THREAD_SAFE = 1 << 0
+CAP_GPU = 1 << 1
+CAP_STATEFUL = 1 << 2
+CAP_ANY_LENGTH = 1 << 3
+
+STATUS_OK = 0
+
+
+class _StemEngineInfo(ctypes.Structure):
+    """ctypes mirror of StemEngineInfo."""
+    _fields_ = [
+        ("struct_size", ctypes.c_uint32),
+        ("abi_version", ctypes.c_uint32),
+        ("name", ctypes.c_char * NAME_LENGTH),
+        ("sample_rate", ctypes.c_uint32),
+        ("channels", ctypes.c_uint32),
+        ("num_stems", ctypes.c_uint32),
+        ("stem_names", (ctypes.c_char * NAME_LENGTH) * MAX_STEMS),
+        ("segment_frames", ctypes.c_uint32),
+        ("overlap_frames", ctypes.c_uint32),
+        ("latency_frames", ctypes.c_uint32),
+        ("max_batch", ctypes.c_uint32),
+        ("capabilities", ctypes.c_uint32),
+    ]
+
+
+@dataclass(frozen=True)
+class NativeEngineInfo:
+    """Capabilities and latency a native engine reports."""
+    name: str
+    sample_rate: int
+    channels: int
+    stem_names: tuple[str, ...]
+    segment_frames: int
+    overlap_frames: int
+    latency_frames: int
+    max_batch: int
+    capabilities: int
+    
+    @property
+    def latency_seconds(self) -> float:
+        """Delay a real-time host would incur."""
+        return self.latency_frames / self.sample_rate
+    
+    def has(self, capability: int) -> bool:
+        """Check a CAP_* flag."""
+        return bool(self.capabilities & capability)
+
+
+class NativeEngine(StemEngine):
+    """
+    Stem separation through a native engine library.
+    
+    The engine only sees audio buffers: this class decodes and resamples
+    the source with SegmentReader, hands the library up to max_batch
+    fixed-length segments per call, and cross-fades and writes the stems
+    with OverlapAddWriter, exactly like DemucsEngine's streaming mode.
+    Memory stays at a few segments regardless of track length.
+    
+    ctypes releases the GIL for the duration of each call, so a
+    thread-safe native engine can be driven from several pipeline
+    threads at once; other engines are serialized on a lock.
+    
+    Requires: STEM_NATIVE_ENGINE (or library_path) naming a library that
+    exports the native/stem_engine.h functions
+    """
+    
+    # Used when the engine leaves segment_frames/overlap_frames at 0
+    DEFAULT_SEGMENT_SECONDS = 10.0
+    DEFAULT_OVERLAP_SECONDS = 0.5
+    
+    def __init__(
+        self,
+        library_path: Optional[str] = None,
+        config: Optional[str] = None,
+        stem_format: Optional[str] = None
+    ):
+        """
+        Initialize the native engine.
+        
+        Args:
+            library_path: Shared library to load (default: STEM_NATIVE_ENGINE)
+            config: Engine config string passed to stem_engine_create
+                (default: STEM_NATIVE_CONFIG)
+            stem_format: Stem storage format ('wav', 'wav24', 'flac')
+        """
+        self.library_path = library_path or os.getenv("STEM_NATIVE_ENGINE")
+        self.config = config if config is not None else os.getenv("STEM_NATIVE_CONFIG")
+        self.stem_format = get_stem_format(stem_format)
+        
+        self._lib = None
+        self._handle = None
+        self._info: Optional[NativeEngineInfo] = None
+        self.load_error: Optional[str] = None
+        self._load_lock = threading.Lock()
+        self._call_lock = threading.Lock()
+    
+    @property
+    def name(self) -> str:
+        if self._info is not None:
+            return f"native_{self._info.name}"
+        return "native"
+    
+    def is_available(self) -> bool:
+        """Check that the library loads and speaks this ABI version."""
+        if not self.library_path:
+            return False
+        try:
+            self._load()
+            return True
+        except (OSError, RuntimeError, AttributeError) as e:
+            logger.debug(f"Native engine unavailable: {e}")
+            return False
+    
+    @property
+    def info(self) -> NativeEngineInfo:
+        """Get the engine's capabilities (loads the library)."""
+        self._load()
+        return self._info
+    
+    def _load(self) -> None:
+        """Load the library and create the engine instance (once)."""
+        if self._handle is not None:
+            return
+        if self.load_error is not None:
+            raise RuntimeError(self.load_error)
+        
+        with self._load_lock:
+            if self._handle is not None:
+                return
+            try:
+                self._handle = self._create()
+            except (OSError, RuntimeError, AttributeError) as e:
+                # AttributeError: the library lacks one of the ABI's symbols
+                self.load_error = f"{self.library_path}: {e}"
+                raise RuntimeError(self.load_error) from e
+    
+    def _create(self):
+        """Bind the ABI, create an instance and read its info."""
+        if not self.library_path:
+            raise RuntimeError("No native engine configured (set STEM_NATIVE_ENGINE)")
+        
+        lib = ctypes.CDLL(str(Path(self.library_path).expanduser()))
+        
+        lib.stem_engine_abi_version.restype = ctypes.c_uint32
+        lib.stem_engine_abi_version.argtypes = []
+        version = lib.stem_engine_abi_version()
+        if version != ABI_VERSION:
+            raise RuntimeError(f"ABI version {version}, expected {ABI_VERSION}")
+        
+        lib.stem_engine_create.restype = ctypes.c_void_p
+        lib.stem_engine_create.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_size_t]
+        lib.stem_engine_get_info.restype = ctypes.c_int
+        lib.stem_engine_get_info.argtypes = [ctypes.c_void_p, ctypes.POINTER(_StemEngineInfo)]
+        lib.stem_engine_process.restype = ctypes.c_int
+        lib.stem_engine_process.argtypes = [
+            ctypes.c_void_p,
+            ctypes.POINTER(ctypes.c_float),
+            ctypes.c_uint32,
+            ctypes.c_uint32,
+            ctypes.POINTER(ctypes.c_float),
+        ]
+        lib.stem_engine_reset.restype = None
+        lib.stem_engine_reset.argtypes = [ctypes.c_void_p]
+        lib.stem_engine_last_error.restype = ctypes.c_char_p
+        lib.stem_engine_last_error.argtypes = [ctypes.c_void_p]
+        lib.stem_engine_destroy.restype = None
+        lib.stem_engine_destroy.argtypes = [ctypes.c_void_p]
+        
+        error = ctypes.create_string_buffer(512)
+        config = self.config.encode() if self.config else None
+        handle = lib.stem_engine_create(config, error, len(error))
+        if not handle:
+            raise RuntimeError(error.value.decode(errors="replace") or "stem_engine_create failed")
+        
+        raw = _StemEngineInfo(struct_size=ctypes.sizeof(_StemEngineInfo))
+        if lib.stem_engine_get_info(handle, ctypes.byref(raw)) != STATUS_OK:
+            message = lib.stem_engine_last_error(handle)
+            lib.stem_engine_destroy(handle)
+            raise RuntimeError(f"stem_engine_get_info failed: {message}")
+        
+        info = NativeEngineInfo(
+            name=raw.name.decode(errors="replace") or "engine",
+            sample_rate=raw.sample_rate,
+            channels=raw.channels,
+            stem_names=tuple(
+                raw.stem_names[i].value.decode(errors="replace")
+                for i in range(min(raw.num_stems, MAX_STEMS))
+            ),
+            segment_frames=raw.segment_frames or int(self.DEFAULT_SEGMENT_SECONDS * raw.sample_rate),
+            overlap_frames=raw.overlap_frames or int(self.DEFAULT_OVERLAP_SECONDS * raw.sample_rate),
+            latency_frames=raw.latency_frames,
+            max_batch=max(1, raw.max_batch),
+            capabilities=raw.capabilities,
+        )
+        
+        if info.sample_rate <= 0 or info.channels not in (1, 2) or not info.stem_names:
+            lib.stem_engine_destroy(handle)
+            raise RuntimeError(
+                f"Invalid engine info: {info.sample_rate} Hz, {info.channels} channels, "
+                f"{len(info.stem_names)} stems"
+            )
+        if info.overlap_frames >= info.segment_frames:
+            lib.stem_engine_destroy(handle)
+            raise RuntimeError("Engine overlap_frames must be shorter than segment_frames")
+        
+        self._lib = lib
+        self._info = info
+        logger.info(
+            f"Loaded native engine {info.name}: {info.sample_rate} Hz, "
+            f"stems {', '.join(info.stem_names)}, latency {info.latency_seconds * 1000:.0f} ms"
+        )
+        return handle
+    
+    def process_segments(self, segments: np.ndarray) -> np.ndarray:
+        """
+        Separate a batch of segments in memory.
+        
+        Args:
+            segments: (batch, channels, frames) float32 at info.sample_rate;
+                batch may exceed max_batch (split into several calls)
+        
+        Returns:
+            (batch, stems, channels, frames) float32
+        """
+        self._load()
+        if self._info.has(CAP_THREAD_SAFE):
+            return self._process(segments)
+        with self._call_lock:
+            return self._process(segments)
+    
+    def _process(self, segments: np.ndarray) -> np.ndarray:
+        """process_segments without locking."""
+        info = self._info
+        
+        segments = np.ascontiguousarray(segments, dtype=np.float32)
+        batch, channels, frames = segments.shape
+        if channels != info.channels:
+            raise ValueError(f"Engine expects {info.channels} channels, got {channels}")
+        if frames != info.segment_frames and not info.has(CAP_ANY_LENGTH):
+            raise ValueError(f"Engine expects {info.segment_frames}-frame segments, got {frames}")
+        
+        output = np.empty((batch, len(info.stem_names), channels, frames), dtype=np.float32)
+        float_p = ctypes.POINTER(ctypes.c_float)
+        
+        for start in range(0, batch, info.max_batch):
+            chunk_in = segments[start:start + info.max_batch]
+            chunk_out = output[start:start + info.max_batch]
+            with profile_stage("inference"):
+                status = self._lib.stem_engine_process(
+                    self._handle, chunk_in.ctypes.data_as(float_p),
+                    len(chunk_in), frames, chunk_out.ctypes.data_as(float_p)
+                )
+            if status != STATUS_OK:
+                message = self._lib.stem_engine_last_error(self._handle) or b""
+                raise RuntimeError(
+                    f"stem_engine_process failed ({status}): {message.decode(errors='replace')}"
+                )
+        
+        return output
+    
+    def separate(self, input_path: Path, output_dir: Path) -> SeparationResult:
+        """
+        Separate audio into stems with the native engine.
+        
+        Args:
+            input_path: Path to input audio file
+            output_dir: Directory to save output stems
+        
+        Returns:
+            SeparationResult with paths to generated stems
+        """
+        start_time = time.time()
+        stem_paths = {}
+        
+        try:
+            self._load()
+            info = self._info
+            
+            output_dir = Path(output_dir)
+            output_dir.mkdir(parents=True, exist_ok=True)
+            
+            stem_indices = {name: idx for idx, name in enumerate(info.stem_names)}
+            stem_paths = {
+                name: output_dir / f"{name}{self.stem_format.extension}"
+                for name in stem_indices
+            }
+            
+            reader = SegmentReader(
+                input_path, info.sample_rate, info.segment_frames, info.overlap_frames
+            )
+            writer = OverlapAddWriter(
+                stem_paths, stem_indices, info.sample_rate, info.overlap_frames,
+                channels=info.channels, stem_format=self.stem_format
+            )
+            
+            # Stateful engines carry context between calls, so they run
+            # one whole track at a time
+            stateful = info.has(CAP_STATEFUL)
+            if stateful:
+                self._call_lock.acquire()
+            try:
+                if stateful:
+                    self._lib.stem_engine_reset(self._handle)
+                
+                with writer:
+                    pending = []
+                    for segment in reader:
+                        pending.append(segment)
+                        if len(pending) == info.max_batch or segment.is_last:
+                            batch = np.stack([seg.audio for seg in pending])
+                            if info.channels == 1:
+                                batch = batch.mean(axis=1, keepdims=True)
+                            
+                            output = self._process(batch) if stateful else self.process_segments(batch)
+                            
+                            for seg, sources in zip(pending, output):
+                                writer.push(sources[:, :, :seg.valid_frames], seg.is_last)
+                            pending = []
+            finally:
+                if stateful:
+                    self._call_lock.release()
+            
+            return SeparationResult(
+                success=True,
+                stem_paths=stem_paths,
+                processing_time_seconds=time.time() - start_time,
+                engine_name=self.name
+            )
+        
+        except Exception as e:
+            return SeparationResult(
+                success=False,
+                stem_paths=stem_paths,
+                processing_time_seconds=time.time() - start_time,
+                engine_name=self.name,
+                error_message=str(e)
+            )
+    
+    def get_recommended_batch_size(self) -> int:
+        """Tracks worth running at once (thread-safe engines only)."""
+        if self.is_available() and self._info.has(CAP_THREAD_SAFE):
+            return self._info.max_batch
+        return 1
+    
+    def close(self) -> None:
+        """Destroy the engine instance."""
+        with self._load_lock:
+            if self._handle is not None:
+                self._lib.stem_engine_destroy(self._handle)
+                self._handle = None
+    
+    def __del__(self):
+        try:
+            self.close()
+        except Exception:
+            pass
@@ -0,0 +1,499 @@
+"""
+Segment Streaming for Stem Separation
+
+Bounded-memory decode, segmentation and overlap-add helpers for engines
+that run inference on fixed-length windows instead of whole tracks.
+"""
+
+import json
+import logging
+import math
+import os
+import shutil
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Iterator, Optional
+
+import numpy as np
+
+from ...optimization.profiler import profile_iter, profile_stage
+from ...utils.audio_io import StemFormat, get_stem_format, open_stem_writer, prepare_samples
+
+
+logger = logging.getLogger(__name__)
+
+
+@dataclass
+class AudioSegment:
+    """A fixed-length window of decoded audio at the engine sample rate."""
+    index: int
+    audio: np.ndarray   # (channels, segment_frames) float32, zero-padded
+    valid_frames: int   # Number of real (non-padding) frames in audio
+    is_last: bool
+
+
+class SegmentReader:
+    """
+    Decodes an audio file into overlapping, fixed-length stereo segments.
+    
+    The file is read in blocks with soundfile, resampled block-by-block to
+    the target rate (with enough context on both sides that block edges
+    match a whole-file resample) and cut into segments of
+    `segment_frames` that overlap by `overlap_frames`. Peak memory is a
+    few segments regardless of track length.
+    
+    Formats libsndfile cannot open (e.g. M4A) fall back to a full decode
+    with librosa, which is still segmented but not constant-memory.
+    """
+    
+    # Source frames read per soundfile call
+    DEFAULT_BLOCK_FRAMES = 65536
+    
+    # Minimum resampler context kept on each side of a block (source frames)
+    MIN_RESAMPLE_CONTEXT = 64
+    
+    def __init__(
+        self,
+        input_path: Path,
+        target_rate: int,
+        segment_frames: int,
+        overlap_frames: int,
+        block_frames: int = DEFAULT_BLOCK_FRAMES
+    ):
+        """
+        Initialize the segment reader.
+        
+        Args:
+            input_path: Path to the source audio file
+            target_rate: Sample rate the segments are produced at
+            segment_frames: Length of each segment in target-rate frames
+            overlap_frames: Overlap between consecutive segments
+            block_frames: Source frames decoded per read
+        """
+        if not 0 <= overlap_frames < segment_frames:
+            raise ValueError("overlap_frames must be in [0, segment_frames)")
+        
+        self.input_path = Path(input_path)
+        self.target_rate = target_rate
+        self.segment_frames = segment_frames
+        self.overlap_frames = overlap_frames
+        self.block_frames = block_frames
+        self.source_rate: Optional[int] = None
+    
+    @property
+    def stride_frames(self) -> int:
+        """Distance between the starts of consecutive segments."""
+        return self.segment_frames - self.overlap_frames
+    
+    @staticmethod
+    def _to_stereo(block: np.ndarray) -> np.ndarray:
+        """Convert a (channels, frames) block to stereo float32."""
+        if block.shape[0] == 1:
+            block = np.repeat(block, 2, axis=0)
+        elif block.shape[0] > 2:
+            block = block[:2]
+        return np.ascontiguousarray(block, dtype=np.float32)
+    
+    def _open_source(self) -> tuple[int, Iterator[np.ndarray]]:
+        """
+        Open the source file for block decoding.
+        
+        Returns:
+            Tuple of (source_sample_rate, iterator of (2, frames) blocks)
+        """
+        import soundfile as sf
+        
+        try:
+            snd = sf.SoundFile(str(self.input_path))
+        except RuntimeError:
+            logger.warning(
+                f"soundfile cannot stream {self.input_path.suffix}, "
+                f"decoding {self.input_path.name} in full"
+            )
+            return self._open_fallback()
+        
+        def blocks() -> Iterator[np.ndarray]:
+            with snd:
+                blocks = snd.blocks(
+                    blocksize=self.block_frames, dtype='float32', always_2d=True
+                )
+                for block in profile_iter(blocks, "decode"):
+                    yield self._to_stereo(block.T)
+        
+        return snd.samplerate, blocks()
+    
+    def _open_fallback(self) -> tuple[int, Iterator[np.ndarray]]:
+        """Decode the whole file with librosa and slice it into blocks."""
+        import librosa
+        
+        with profile_stage("decode"):
+            audio, sample_rate = librosa.load(str(self.input_path), sr=None, mono=False)
+        if audio.ndim == 1:
+            audio = audio[np.newaxis, :]
+        audio = self._to_stereo(audio)
+        
+        def blocks() -> Iterator[np.ndarray]:
+            for start in range(0, audio.shape[1], self.block_frames):
+                yield audio[:, start:start + self.block_frames]
+        
+        return sample_rate, blocks()
+    
+    def _iter_target_blocks(self) -> Iterator[np.ndarray]:
+        """Yield decoded blocks at the target sample rate."""
+        self.source_rate, source_blocks = self._open_source()
+        
+        if self.source_rate == self.target_rate:
+            yield from source_blocks
+            return
+        
+        from scipy.signal import resample_poly
+        
+        g = math.gcd(self.source_rate, self.target_rate)
+        up, down = self.target_rate // g, self.source_rate // g
+        
+        # Block lengths and context must be multiples of `down` so every
+        # block maps to a whole number of target frames.
+        context = down * math.ceil(
+            max(self.MIN_RESAMPLE_CONTEXT, 16 * max(up, down) / up) / down
+        )
+        
+        # Re-chunk the source into `down`-aligned blocks with one block of
+        # lookahead so the right-hand context is always available.
+        aligned = max(down, (self.block_frames // down) * down)
+        pending = np.zeros((2, 0), dtype=np.float32)
+        prev_tail = np.zeros((2, 0), dtype=np.float32)
+        current: Optional[np.ndarray] = None
+        
+        def resample_with_context(left, block, right) -> np.ndarray:
+            padded = np.concatenate([left, block, right], axis=1)
+            with profile_stage("resample"):
+                out = resample_poly(padded, up, down, axis=1).astype(np.float32)
+            start = left.shape[1] * up // down
+            frames = math.ceil(block.shape[1] * up / down)
+            return out[:, start:start + frames]
+        
+        for block in source_blocks:
+            pending = np.concatenate([pending, block], axis=1)
+            while pending.shape[1] >= aligned:
+                nxt, pending = pending[:, :aligned], pending[:, aligned:]
+                if current is not None:
+                    yield resample_with_context(prev_tail, current, nxt[:, :context])
+                    prev_tail = current[:, -context:]
+                current = nxt
+        
+        tail_blocks = [b for b in (current, pending) if b is not None and b.shape[1]]
+        for i, block in enumerate(tail_blocks):
+            right = tail_blocks[i + 1][:, :context] if i + 1 < len(tail_blocks) else (
+                np.zeros((2, 0), dtype=np.float32)
+            )
+            yield resample_with_context(prev_tail, block, right)
+            prev_tail = block[:, -context:]
+    
+    def __iter__(self) -> Iterator[AudioSegment]:
+        """Yield overlapping segments in order."""
+        buffer = np.zeros((2, 0), dtype=np.float32)
+        index = 0
+        
+        for block in self._iter_target_blocks():
+            buffer = np.concatenate([buffer, block], axis=1)
+            # Only emit once we know at least one more frame follows, so
+            # the final segment is always flagged is_last
+            while buffer.shape[1] > self.segment_frames:
+                yield AudioSegment(
+                    index=index,
+                    audio=buffer[:, :self.segment_frames].copy(),
+                    valid_frames=self.segment_frames,
+                    is_last=False
+                )
+                buffer = buffer[:, self.stride_frames:]
+                index += 1
+        
+        if buffer.shape[1] or index == 0:
+            valid = buffer.shape[1]
+            audio = np.zeros((2, self.segment_frames), dtype=np.float32)
+            audio[:, :valid] = buffer
+            yield AudioSegment(index=index, audio=audio, valid_frames=valid, is_last=True)
+
+
+class OverlapAddWriter:
+    """
+    Cross-fades overlapping segment outputs and writes stems incrementally.
+    
+    Each pushed segment is blended with the held-back tail of the previous
+    one using complementary linear ramps; everything before the new tail
+    is final and is written straight to the stem files.
+    """
+    
+    def __init__(
+        self,
+        stem_paths: dict[str, Path],
+        stem_indices: dict[str, int],
+        sample_rate: int,
+        overlap_frames: int,
+        channels: int = 2,
+        stem_format: Optional[StemFormat] = None
+    ):
+        """
+        Initialize the writer.
+        
+        Args:
+            stem_paths: stem_name -> output file path
+            stem_indices: stem_name -> index in the engine's source axis
+            sample_rate: Output sample rate
+            overlap_frames: Overlap between consecutive segments
+            channels: Output channel count
+            stem_format: Stem storage format (None for the default)
+        """
+        self.stem_paths = stem_paths
+        self.stem_indices = stem_indices
+        self.sample_rate = sample_rate
+        self.overlap_frames = overlap_frames
+        self.channels = channels
+        self.stem_format = stem_format or get_stem_format()
+        
+        self._fade_in = np.linspace(0.0, 1.0, overlap_frames, dtype=np.float32)
+        self._fade_out = 1.0 - self._fade_in
+        self._tail: Optional[np.ndarray] = None
+        self._files: dict = {}
+        self.frames_written = 0
+    
+    def __enter__(self) -> "OverlapAddWriter":
+        self.open()
+        return self
+    
+    def __exit__(self, exc_type, exc, tb) -> None:
+        if exc_type is not None:
+            self.abort()
+        else:
+            self.close()
+    
+    def open(self) -> None:
+        """Open all stem files for writing."""
+        for stem_name, path in self.stem_paths.items():
+            self._files[stem_name] = open_stem_writer(
+                path, self.sample_rate, self.channels, self.stem_format
+            )
+    
+    def close(self) -> None:
+        """Close all stem files."""
+        for f in self._files.values():
+            f.close()
+        self._files = {}
+    
+    def abort(self) -> None:
+        """Close and delete partially written stems."""
+        self.close()
+        # Don't leave truncated stems that would pass stems_exist()
+        for path in self.stem_paths.values():
+            path.unlink(missing_ok=True)
+    
+    def push(self, sources: np.ndarray, is_last: bool) -> None:
+        """
+        Add one segment of separated output.
+        
+        Args:
+            sources: (num_sources, channels, valid_frames) segment output
+            is_last: Whether this is the final segment of the track
+        """
+        out = np.array(sources, dtype=np.float32, copy=True)
+        
+        if self._tail is not None:
+            o = self._tail.shape[-1]
+            out[..., :o] = out[..., :o] * self._fade_in[:o] + self._tail
+        
+        if is_last or self.overlap_frames == 0:
+            commit, self._tail = out, None
+        else:
+            split = out.shape[-1] - self.overlap_frames
+            commit = out[..., :split]
+            self._tail = out[..., split:] * self._fade_out
+        
+        for stem_name, idx in self.stem_indices.items():
+            # soundfile expects (frames, channels)
+            self._write(stem_name, commit[idx].T)
+        self.frames_written += commit.shape[-1]
+    
+    def _write(self, stem_name: str, frames: np.ndarray) -> None:
+        """Append finished (frames, channels) samples to a stem."""
+        with profile_stage("write"):
+            self._files[stem_name].write(prepare_samples(frames, self.stem_format))
+
+
+class SegmentCheckpointWriter(OverlapAddWriter):
+    """
+    OverlapAddWriter that can resume a track after a crash.
+    
+    Finished frames are spooled as raw float32 to `checkpoint_dir` rather
+    than encoded straight into the stems, because an encoder killed
+    mid-file leaves a header that can't be appended to. checkpoint()
+    fsyncs the spools and records how many segments they cover (plus the
+    held-back overlap tail), so a restart skips straight to the next
+    segment. The stems are encoded from the spools once the last segment
+    arrives, and the checkpoint directory is then removed.
+    
+    A checkpoint is only reused when `identity` (source file fingerprint
+    and separation settings) matches the one it was written with.
+    """
+    
+    STATE_FILE = "checkpoint.json"
+    
+    # Spooled frames encoded per write when finishing
+    ENCODE_BLOCK_FRAMES = 262144
+    
+    def __init__(
+        self,
+        stem_paths: dict[str, Path],
+        stem_indices: dict[str, int],
+        sample_rate: int,
+        overlap_frames: int,
+        checkpoint_dir: Path,
+        identity: dict,
+        channels: int = 2,
+        stem_format: Optional[StemFormat] = None
+    ):
+        """
+        Initialize the writer.
+        
+        Args:
+            stem_paths: stem_name -> output file path
+            stem_indices: stem_name -> index in the engine's source axis
+            sample_rate: Output sample rate
+            overlap_frames: Overlap between consecutive segments
+            checkpoint_dir: Directory for spools and checkpoint state
+            identity: JSON-serializable description of the source and
+                settings; a checkpoint written under another identity is
+                discarded
+            channels: Output channel count
+            stem_format: Stem storage format (None for the default)
+        """
+        super().__init__(
+            stem_paths, stem_indices, sample_rate, overlap_frames,
+            channels=channels, stem_format=stem_format
+        )
+        self.checkpoint_dir = Path(checkpoint_dir)
+        self.identity = identity
+        self.resume_segment = 0   # First segment that still needs inference
+        self._finished = False
+    
+    def _spool_path(self, stem_name: str) -> Path:
+        return self.checkpoint_dir / f"{stem_name}.f32"
+    
+    def _load_checkpoint(self) -> Optional[dict]:
+        """Read the saved state if it belongs to this source and settings."""
+        try:
+            state = json.loads((self.checkpoint_dir / self.STATE_FILE).read_text())
+        except (OSError, ValueError):
+            return None
+        if state.get("identity") != self.identity:
+            return None
+        
+        frame_bytes = self.channels * 4
+        for stem_name in self.stem_indices:
+            try:
+                if self._spool_path(stem_name).stat().st_size < state["frames"] * frame_bytes:
+                    return None
+            except OSError:
+                return None
+        return state
+    
+    def open(self) -> None:
+        """Open the spools, resuming from a matching checkpoint if there is one."""
+        self.checkpoint_dir.mkdir(parents=True, exist_ok=True)
+        state = self._load_checkpoint()
+        
+        if state is not None:
+            self.frames_written = state["frames"]
+            self.resume_segment = state["segment"] + 1
+            if state.get("tail"):
+                self._tail = np.load(self.checkpoint_dir / state["tail"])
+            logger.info(
+                f"Resuming from checkpoint at segment {self.resume_segment} "
+                f"({self.frames_written / self.sample_rate:.0f}s done)"
+            )
+        else:
+            (self.checkpoint_dir / self.STATE_FILE).unlink(missing_ok=True)
+        
+        for stem_name in self.stem_indices:
+            f = open(self._spool_path(stem_name), 'r+b' if state else 'wb')
+            # Drop anything written after the checkpoint
+            f.truncate(self.frames_written * self.channels * 4)
+            f.seek(0, os.SEEK_END)
+            self._files[stem_name] = f
+    
+    def _write(self, stem_name: str, frames: np.ndarray) -> None:
+        with profile_stage("write"):
+            self._files[stem_name].write(np.ascontiguousarray(frames, dtype='<f4').tobytes())
+    
+    def push(self, sources: np.ndarray, is_last: bool) -> None:
+        super().push(sources, is_last)
+        self._finished = is_last
+    
+    def checkpoint(self, segment_index: int) -> None:
+        """
+        Make everything pushed so far durable.
+        
+        Args:
+            segment_index: Index of the last segment pushed
+        """
+        for f in self._files.values():
+            f.flush()
+            os.fsync(f.fileno())
+        
+        # The tail is named per segment so the previous checkpoint stays
+        # consistent until the new state file replaces it
+        tail_name = None
+        if self._tail is not None:
+            tail_name = f"tail-{segment_index}.npy"
+            np.save(self.checkpoint_dir / tail_name, self._tail)
+        
+        state = {
+            "identity": self.identity,
+            "segment": segment_index,
+            "frames": self.frames_written,
+            "tail": tail_name,
+        }
+        tmp = self.checkpoint_dir / f"{self.STATE_FILE}.tmp"
+        tmp.write_text(json.dumps(state))
+        os.replace(tmp, self.checkpoint_dir / self.STATE_FILE)
+        
+        for old in self.checkpoint_dir.glob("tail-*.npy"):
+            if old.name != tail_name:
+                old.unlink(missing_ok=True)
+    
+    def close(self) -> None:
+        """Close the spools; once finished, encode the stems and clean up."""
+        for f in self._files.values():
+            f.close()
+        self._files = {}
+        
+        if not self._finished:
+            return  # Keep the spools for a resume
+        
+        for stem_name, path in self.stem_paths.items():
+            if self.frames_written == 0:
+                # np.memmap can't map an empty file; the stem is just empty
+                spool = np.zeros((0, self.channels), dtype='<f4')
+            else:
+                spool = np.memmap(self._spool_path(stem_name), dtype='<f4', mode='r')
+                spool = spool[:self.frames_written * self.channels].reshape(-1, self.channels)
+            with profile_stage("write"), \
+                    open_stem_writer(path, self.sample_rate, self.channels, self.stem_format) as out:
+                for start in range(0, spool.shape[0], self.ENCODE_BLOCK_FRAMES):
+                    out.write(prepare_samples(
+                        np.asarray(spool[start:start + self.ENCODE_BLOCK_FRAMES]),
+                        self.stem_format
+                    ))
+            del spool
+        
+        shutil.rmtree(self.checkpoint_dir, ignore_errors=True)
+    
+    def abort(self) -> None:
+        """Close the spools, keeping the last checkpoint for a resume."""
+        self._finished = False
+        for f in self._files.values():
+            f.close()
+        self._files = {}
+        # Stems are only written on completion, but don't leave a
+        # half-encoded one if finishing itself failed
+        for path in self.stem_paths.values():
+            path.unlink(missing_ok=True)
@@ -6,10 +6,83 @@ for quality assessment of separated stems.
 """
 
 from pathlib import Path
-from typing import Optional
+from typing import Callable, Optional
 
 import numpy as np
 
+from ..utils.audio_io import find_stem_file
+
+
+class _SiSdrAccumulator:
+    """
+    Running sums for SI-SDR of several estimates against one reference.
+    
+    SI-SDR only depends on the means, energies and cross term of the two
+    signals, so blocks can be folded in one at a time:
+        
+        <r', e'> = sum(r*e) - N * mean(r) * mean(e)
+        alpha    = <r', e'> / ||r'||^2
+        target   = alpha^2 * ||r'||^2
+        noise    = ||e'||^2 - alpha * <r', e'>
+    
+    where r', e' are the mean-removed signals. The per-block work is one
+    matrix-vector product and a row-wise energy reduction over all
+    estimates at once, both of which numpy dispatches to SIMD BLAS
+    kernels.
+    """
+    
+    def __init__(self, num_estimates: int):
+        self.frames = 0
+        self.sum_ref = 0.0
+        self.sum_ref_sq = 0.0
+        self.sum_est = np.zeros(num_estimates)
+        self.sum_est_sq = np.zeros(num_estimates)
+        self.sum_cross = np.zeros(num_estimates)
+    
+    def update(self, reference: np.ndarray, estimates: np.ndarray) -> None:
+        """
+        Fold in one block.
+        
+        Args:
+            reference: (frames,) reference block
+            estimates: (num_estimates, frames) estimate blocks
+        """
+        # float64 accumulation: a 15 minute track is ~40M frames
+        ref = reference.astype(np.float64, copy=False)
+        est = estimates.astype(np.float64, copy=False)
+        
+        self.frames += ref.shape[0]
+        self.sum_ref += ref.sum()
+        self.sum_ref_sq += ref @ ref
+        self.sum_est += est.sum(axis=1)
+        self.sum_est_sq += np.einsum('ij,ij->i', est, est)
+        self.sum_cross += est @ ref
+    
+    def si_sdr(self) -> list[float]:
+        """SI-SDR in dB for each estimate."""
+        n = max(self.frames, 1)
+        mean_ref = self.sum_ref / n
+        mean_est = self.sum_est / n
+        
+        ref_energy = self.sum_ref_sq - n * mean_ref ** 2
+        if ref_energy < 1e-10:
+            return [float('-inf')] * len(self.sum_est)
+        
+        cross = self.sum_cross - n * mean_ref * mean_est
+        est_energy = self.sum_est_sq - n * mean_est ** 2
+        
+        scale = cross / ref_energy
+        target_energy = scale ** 2 * ref_energy
+        noise_energy = est_energy - scale * cross
+        
+        values = []
+        for target, noise in zip(target_energy, noise_energy):
+            if noise < 1e-10:
+                values.append(float('inf'))
+            else:
+                values.append(float(10 * np.log10(target / noise)))
+        return values
+
 
 class StemQualityAnalyzer:
     """
@@ -36,6 +109,9 @@ class StemQualityAnalyzer:
     # Minimum acceptable SI-SDR for vocals before fallback
     VOCAL_QUALITY_THRESHOLD = 7.0
     
+    # Frames per stem read when streaming stems in analyze_stems()
+    ANALYSIS_BLOCK_FRAMES = 262144
+    
     def __init__(self):
         """Initialize the quality analyzer."""
         self._librosa = None
@@ -157,6 +233,209 @@ class StemQualityAnalyzer:
         # Calculate SI-SDR
         return self.calculate_si_sdr(original_audio, stem_audio)
     
+    def _analyze_blocks(
+        self,
+        original_path: Path,
+        stem_sr: int,
+        stem_readers: dict[str, tuple[Callable[[int], np.ndarray], int]]
+    ) -> dict[str, float]:
+        """
+        Accumulate SI-SDR for several stems against one mixture decode.
+        
+        Args:
+            original_path: Path to the original mixture
+            stem_sr: Sample rate shared by all stems
+            stem_readers: stem_name -> (read(frames) -> (frames, channels)
+                next block, total frames)
+        
+        Returns:
+            Dictionary mapping stem names to SI-SDR values
+        """
+        original_data = self._load_audio(original_path)
+        if original_data is None:
+            return {}
+        original_audio, original_sr = original_data
+        
+        # All stems from one engine share a rate; resample the mixture
+        # once rather than every stem
+        if original_sr != stem_sr:
+            original_audio = self._librosa.resample(
+                original_audio, orig_sr=original_sr, target_sr=stem_sr
+            )
+        
+        names = list(stem_readers)
+        total = min([len(original_audio)] + [stem_readers[n][1] for n in names])
+        accumulator = _SiSdrAccumulator(len(names))
+        
+        for start in range(0, total, self.ANALYSIS_BLOCK_FRAMES):
+            frames = min(self.ANALYSIS_BLOCK_FRAMES, total - start)
+            estimates = np.zeros((len(names), frames), dtype=np.float32)
+            
+            got = frames
+            for i, name in enumerate(names):
+                block = stem_readers[name][0](frames)
+                got = min(got, block.shape[0])
+                # Downmix to mono the same way librosa.load(mono=True) does
+                estimates[i, :block.shape[0]] = block.mean(axis=1)
+            
+            accumulator.update(
+                original_audio[start:start + got], estimates[:, :got]
+            )
+            if got < frames:
+                break
+        
+        return dict(zip(names, accumulator.si_sdr()))
+    
+    def analyze_stems(
+        self,
+        stem_paths: dict[str, Path],
+        original_path: Path
+    ) -> dict[str, float]:
+        """
+        Analyze several stems against the mixture in a single pass.
+        
+        The mixture is decoded once (and resampled to the stem rate if
+        needed); the stems are then streamed in lockstep blocks and SI-SDR
+        for all of them is accumulated together, so the cost is one
+        mixture decode plus one read of each stem.
+        
+        Args:
+            stem_paths: Dictionary mapping stem names to stem files
+            original_path: Path to the original mixture
+        
+        Returns:
+            Dictionary mapping stem names to SI-SDR values
+        """
+        if not self._lazy_import():
+            return {}
+        
+        sf = self._soundfile
+        files = {}
+        
+        try:
+            for stem_name, stem_path in stem_paths.items():
+                try:
+                    files[stem_name] = sf.SoundFile(str(stem_path))
+                except RuntimeError:
+                    continue
+            
+            if not files:
+                return {}
+            
+            readers = {
+                name: (
+                    lambda frames, f=f: f.read(frames, dtype='float32', always_2d=True),
+                    f.frames
+                )
+                for name, f in files.items()
+            }
+            stem_sr = next(iter(files.values())).samplerate
+            return self._analyze_blocks(original_path, stem_sr, readers)
+            
+        except Exception:
+            return {}
+        finally:
+            for f in files.values():
+                f.close()
+    
+    def analyze_stem_audio(
+        self,
+        stem_audio: dict[str, np.ndarray],
+        sample_rate: int,
+        original_path: Path
+    ) -> dict[str, float]:
+        """
+        Analyze in-memory stems handed over by an engine.
+        
+        Same single-pass analysis as analyze_stems(), but blocks are
+        sliced straight out of the engine's buffers so nothing is read
+        back from disk.
+        
+        Args:
+            stem_audio: stem_name -> (frames, channels) audio
+            sample_rate: Sample rate of the stems
+            original_path: Path to the original mixture
+        
+        Returns:
+            Dictionary mapping stem names to SI-SDR values
+        """
+        if not self._lazy_import() or not stem_audio:
+            return {}
+        
+        def array_reader(audio: np.ndarray):
+            position = 0
+            
+            def read(frames: int) -> np.ndarray:
+                nonlocal position
+                block = audio[position:position + frames]
+                position += block.shape[0]
+                return block if block.ndim == 2 else block[:, np.newaxis]
+            
+            return read
+        
+        readers = {
+            name: (array_reader(audio), audio.shape[0])
+            for name, audio in stem_audio.items()
+        }
+        
+        try:
+            return self._analyze_blocks(original_path, sample_rate, readers)
+        except Exception:
+            return {}
+    
+    def compare_stems(
+        self,
+        reference_paths: dict[str, Path],
+        estimate_paths: dict[str, Path]
+    ) -> dict[str, float]:
+        """
+        Score stems against reference stems of the same track.
+        
+        Unlike analyze_stems(), which scores against the mixture, this
+        treats the reference stems as ground truth (e.g. fp32 output when
+        validating a reduced-precision mode). Both sides are streamed in
+        blocks; stems must share a sample rate.
+        
+        Args:
+            reference_paths: stem_name -> reference stem file
+            estimate_paths: stem_name -> stem file to score
+        
+        Returns:
+            Dictionary mapping stem names (present on both sides) to SI-SDR
+        """
+        if not self._lazy_import():
+            return {}
+        
+        sf = self._soundfile
+        scores = {}
+        
+        for stem_name in reference_paths.keys() & estimate_paths.keys():
+            try:
+                with sf.SoundFile(str(reference_paths[stem_name])) as ref, \
+                        sf.SoundFile(str(estimate_paths[stem_name])) as est:
+                    if ref.samplerate != est.samplerate:
+                        continue
+                    
+                    accumulator = _SiSdrAccumulator(1)
+                    while True:
+                        ref_block = ref.read(self.ANALYSIS_BLOCK_FRAMES, dtype='float32', always_2d=True)
+                        est_block = est.read(self.ANALYSIS_BLOCK_FRAMES, dtype='float32', always_2d=True)
+                        frames = min(ref_block.shape[0], est_block.shape[0])
+                        if frames == 0:
+                            break
+                        accumulator.update(
+                            ref_block[:frames].mean(axis=1),
+                            est_block[:frames].mean(axis=1)[np.newaxis, :]
+                        )
+                        if frames < self.ANALYSIS_BLOCK_FRAMES:
+                            break
+                    
+                    scores[stem_name] = accumulator.si_sdr()[0]
+            except RuntimeError:
+                continue
+        
+        return scores
+    
     def analyze_all_stems(self, stem_dir: Path, original_path: Path) -> dict[str, float]:
         """
         Analyze quality of all stems in a directory.
@@ -168,17 +447,15 @@ class StemQualityAnalyzer:
         Returns:
             Dictionary mapping stem names to SI-SDR values
         """
-        results = {}
         stem_names = ["vocals", "drums", "bass", "other"]
         
-        for stem in stem_names:
-            stem_path = stem_dir / f"{stem}.wav"
-            if stem_path.exists():
-                si_sdr = self.analyze_stem(stem_path, original_path)
-                if si_sdr is not None:
-                    results[stem] = si_sdr
+        stem_paths = {
+            stem: path
+            for stem in stem_names
+            if (path := find_stem_file(stem_dir, stem)) is not None
+        }
         
-        return results
+        return self.analyze_stems(stem_paths, original_path)
     
     def get_quality_label(self, si_sdr: float) -> str:
         """
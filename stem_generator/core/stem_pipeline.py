@@ -8,33 +8,65 @@ selecting the appropriate engine and handling quality fallbacks.
 import json
 import logging
 import os
+import shutil
 import time
-from dataclasses import asdict
+from concurrent.futures import Future, ThreadPoolExecutor
+from dataclasses import asdict, dataclass
 from pathlib import Path
 from typing import Optional, Literal
 
-from .engines.base_engine import SeparationResult
+from .engines.base_engine import StemEngine, SeparationResult
 from .engines.demucs_engine import DemucsEngine
-from .engines.lalal_engine import LalalEngine
+from .engines.lalal_engine import MAX_FILE_SIZE_BYTES, LalalEngine
+from .engines.native_engine import NativeEngine
+from .engine_router import EngineRouter, Route
 from .quality_analyzer import StemQualityAnalyzer
+from ..utils.content_hash import ContentHasher
 from ..utils.file_manager import StemFileManager
 from ..utils.database import StemDatabase, JobStatus
+from ..optimization.precision_validator import REPORT_FILE, PrecisionValidator
+from ..optimization.profiler import profile_stage
 
 
 logger = logging.getLogger(__name__)
 
-EngineChoice = Literal["auto", "demucs", "lalal", "uvr"]
+EngineChoice = Literal["auto", "demucs", "lalal", "native", "uvr"]
+
+# Engine choices served by the native engine library (UVR/MDX builds
+# and other backends are loaded through the native ABI)
+NATIVE_CHOICES = ("native", "uvr")
+
+
+@dataclass
+class _PreparedJob:
+    """A file with its track/job records created and an engine selected."""
+    file_path: Path
+    output_dir: Path
+    track_id: int
+    engine: StemEngine
+    job_id: int
+    file_size: int = 0
+    genre: Optional[str] = None
+    # EngineRouter backlog ticket for the run
+    ticket: Optional[int] = None
+    # Cloud fallback started alongside the local run (see EngineRouter)
+    speculative: Optional[Future] = None
+    speculative_ticket: Optional[int] = None
 
 
 class StemPipeline:
     """
     Main orchestrator for stem separation.
     
-    Routing Logic:
-        1. Check file size and GPU availability
-        2. Default to Demucs for files < 50MB or standard batch processing
-        3. Fall back to LALAL.AI for high-priority vocal extraction
-           or if local quality check fails
+    Routing Logic (auto):
+        1. Candidates are every available engine: a native engine
+           (STEM_NATIVE_ENGINE), Demucs (files < 50MB unless streaming, or
+           when the cloud is unavailable) and LALAL.AI
+        2. EngineRouter picks the one that finishes the track soonest,
+           given queued work, measured throughput and the chance of a
+           quality retry; cloud time is weighted by its cost
+        3. Tracks likely to fail the local quality gate start their cloud
+           fallback speculatively, in parallel with the local run
         
     Quality Assurance:
         - Calculates SI-SDR for each stem after separation
@@ -47,7 +79,13 @@ class StemPipeline:
     def __init__(
         self,
         base_dir: str = "data/stems",
-        db_path: Optional[str] = None
+        db_path: Optional[str] = None,
+        streaming: bool = False,
+        in_memory: bool = False,
+        device: Optional[str] = None,
+        stem_format: Optional[str] = None,
+        precision: str = DemucsEngine.DEFAULT_PRECISION,
+        checkpoint_segments: int = DemucsEngine.DEFAULT_CHECKPOINT_SEGMENTS
     ):
         """
         Initialize the stem pipeline.
@@ -55,22 +93,80 @@ class StemPipeline:
         Args:
             base_dir: Base directory for stem output
             db_path: Path to SQLite database (defaults to base_dir/stem_generator.db)
+            streaming: Use segment-streaming separation for Demucs
+                (constant memory on long tracks)
+            in_memory: Hand Demucs stems to QA as in-memory buffers and
+                write them to disk in the background
+            device: PyTorch device for Demucs ('cuda:1', 'cpu', or None
+                for auto)
+            stem_format: Stem storage format ('wav', 'wav24', 'flac')
+            precision: Demucs inference precision ('fp32', 'fp16', 'bf16',
+                'int8'). A mode that failed validation for this model and
+                device in base_dir/precision_report.json runs as fp32.
+            checkpoint_segments: In streaming mode, checkpoint Demucs
+                progress every this many segments so an interrupted job
+                resumes mid-track (0 disables; worth it for batch runs)
         """
-        self.file_manager = StemFileManager(base_dir)
         self.db = StemDatabase(db_path or f"{base_dir}/stem_generator.db")
+        self.hasher = ContentHasher(db=self.db)
+        self.file_manager = StemFileManager(
+            base_dir, hasher=self.hasher, stem_format=stem_format
+        )
         self.quality_analyzer = StemQualityAnalyzer()
+        self.streaming = streaming
+        self.in_memory = in_memory
+        self.device = device
+        self.precision = precision
+        self.checkpoint_segments = checkpoint_segments
+        
+        self.router = EngineRouter(self.db)
         
         # Initialize engines (lazy loaded)
         self._demucs_engine: Optional[DemucsEngine] = None
         self._lalal_engine: Optional[LalalEngine] = None
+        self._native_engine: Optional[NativeEngine] = None
     
     @property
     def demucs(self) -> DemucsEngine:
         """Get the Demucs engine (lazy initialization)."""
         if self._demucs_engine is None:
-            self._demucs_engine = DemucsEngine()
+            self._demucs_engine = self._create_demucs(self._checked_precision())
         return self._demucs_engine
     
+    def _create_demucs(self, precision: str) -> DemucsEngine:
+        return DemucsEngine(
+            device=self.device,
+            streaming=self.streaming,
+            keep_in_memory=self.in_memory,
+            stem_format=self.file_manager.stem_format.name,
+            checkpoint_segments=self.checkpoint_segments,
+            precision=precision
+        )
+    
+    def _checked_precision(self) -> str:
+        """The configured precision, unless validation rejected it here."""
+        if self.precision == DemucsEngine.DEFAULT_PRECISION:
+            return self.precision
+        
+        probe = self._create_demucs(self.precision)
+        report = PrecisionValidator.load_report(self.file_manager.base_dir / REPORT_FILE)
+        approved = PrecisionValidator.is_approved(
+            report, probe.model_name, probe.device, self.precision
+        )
+        
+        if approved is False:
+            logger.warning(
+                f"{self.precision} failed validation for {probe.model_name} on "
+                f"{probe.device}; using fp32"
+            )
+            return DemucsEngine.DEFAULT_PRECISION
+        if approved is None:
+            logger.warning(
+                f"{self.precision} has not been validated for {probe.model_name} on "
+                f"{probe.device} (run `stem-gen validate-precision`)"
+            )
+        return self.precision
+    
     @property
     def lalal(self) -> LalalEngine:
         """Get the LALAL.AI engine (lazy initialization)."""
@@ -78,9 +174,18 @@ class StemPipeline:
             self._lalal_engine = LalalEngine()
         return self._lalal_engine
     
+    @property
+    def native(self) -> NativeEngine:
+        """Get the native engine library (lazy initialization)."""
+        if self._native_engine is None:
+            self._native_engine = NativeEngine(
+                stem_format=self.file_manager.stem_format.name
+            )
+        return self._native_engine
+    
     def _select_engine(self, file_path: Path, preference: EngineChoice = "auto"):
         """
-        Select the appropriate engine based on file and availability.
+        Select the appropriate engine based on file, load and availability.
         
         Args:
             file_path: Path to the audio file
@@ -89,34 +194,79 @@ class StemPipeline:
         Returns:
             The selected engine instance
         """
+        return self._route(file_path, preference).engine
+    
+    def _route(
+        self,
+        file_path: Path,
+        preference: EngineChoice = "auto",
+        genre: Optional[str] = None
+    ) -> Route:
+        """
+        Route a file to an engine.
+        
+        Explicit preferences are honoured as-is (no speculation); "auto"
+        goes through the EngineRouter.
+        
+        Args:
+            file_path: Path to the audio file
+            preference: User preference for engine selection
+            genre: Track genre, for the quality-retry prediction
+        
+        Returns:
+            The routing decision
+        """
         # Explicit engine selection
         if preference == "demucs":
             if not self.demucs.is_available():
                 raise RuntimeError("Demucs is not available (missing dependencies)")
-            return self.demucs
+            return Route(self.demucs, 0.0, 0.0)
             
         if preference == "lalal":
             if not self.lalal.is_available():
                 raise RuntimeError("LALAL.AI is not available (missing API key)")
-            return self.lalal
+            return Route(self.lalal, 0.0, 0.0)
+        
+        if preference in NATIVE_CHOICES:
+            if not self.native.is_available():
+                raise RuntimeError(
+                    f"Native engine is not available "
+                    f"({self.native.load_error or 'set STEM_NATIVE_ENGINE'})"
+                )
+            return Route(self.native, 0.0, 0.0)
         
-        # Auto-selection logic
+        # Auto-selection: every engine that can take the file
         file_size = file_path.stat().st_size
+        cloud = self.lalal.is_available() and file_size <= MAX_FILE_SIZE_BYTES
         
-        # Prefer local Demucs for smaller files or if cloud not available
-        if self.demucs.is_available():
-            if file_size < self.LOCAL_SIZE_THRESHOLD or not self.lalal.is_available():
-                return self.demucs
+        candidates = []
+        if self.native.is_available():
+            candidates.append(self.native)
+        # Whole-file Demucs on long files is left to the cloud (streaming
+        # mode separates them in constant memory)
+        if self.demucs.is_available() and (
+            file_size < self.LOCAL_SIZE_THRESHOLD or self.streaming or not cloud
+        ):
+            candidates.append(self.demucs)
+        if cloud:
+            candidates.append(self.lalal)
         
-        # Fall back to LALAL.AI
-        if self.lalal.is_available():
-            return self.lalal
-            
-        # No engines available
-        raise RuntimeError("No stem separation engines available")
+        if not candidates:
+            # No engines available
+            raise RuntimeError("No stem separation engines available")
+        
+        return self.router.route(
+            file_size,
+            genre,
+            [(engine, self._get_fallback_engine(engine)) for engine in candidates]
+        )
     
     def _get_fallback_engine(self, current_engine):
         """Get the fallback engine if the current one produces poor results."""
+        if current_engine.name.startswith("native"):
+            if self.demucs.is_available():
+                return self.demucs
+            return self.lalal if self.lalal.is_available() else None
         if current_engine.name.startswith("demucs") and self.lalal.is_available():
             return self.lalal
         if current_engine.name == "lalal_cloud" and self.demucs.is_available():
@@ -128,11 +278,20 @@ class StemPipeline:
         file_path: Path,
         output_dir: Path,
         result: SeparationResult,
-        quality_scores: dict[str, float]
+        quality_scores: dict[str, float],
+        track_id: Optional[int] = None
     ) -> None:
-        """Save processing metadata to JSON file."""
+        """
+        Save processing metadata to JSON file.
+        
+        The source's tag BPM/key are included so production tools
+        (see production.analysis_cache) can skip detecting them.
+        """
+        track = self.db.get_track(track_id) if track_id is not None else None
         metadata = {
             "source_file": str(file_path),
+            "bpm": track.bpm if track else None,
+            "key": track.key if track else None,
             "engine": result.engine_name,
             "processing_time_seconds": result.processing_time_seconds,
             "success": result.success,
@@ -146,27 +305,17 @@ class StemPipeline:
         with open(metadata_path, 'w') as f:
             json.dump(metadata, f, indent=2)
     
-    def separate(
+    def _check_existing(
         self,
-        file_path: str | Path,
-        engine: EngineChoice = "auto",
-        skip_if_exists: bool = True,
-        quality_fallback: bool = True
-    ) -> SeparationResult:
+        file_path: Path,
+        skip_if_exists: bool
+    ) -> Optional[SeparationResult]:
         """
-        Separate an audio file into stems.
+        Short-circuit files that are missing or already separated.
         
-        Args:
-            file_path: Path to the audio file
-            engine: Engine selection ('auto', 'demucs', 'lalal')
-            skip_if_exists: Skip if stems already exist
-            quality_fallback: Retry with fallback engine if quality is poor
-            
         Returns:
-            SeparationResult with stem paths and metadata
+            A final SeparationResult, or None if the file needs processing
         """
-        file_path = Path(file_path)
-        
         if not file_path.exists():
             return SeparationResult(
                 success=False,
@@ -178,7 +327,6 @@ class StemPipeline:
         
         # Check if already processed
         if skip_if_exists and self.file_manager.stems_exist(file_path):
-            output_dir = self.file_manager.get_output_dir(file_path)
             return SeparationResult(
                 success=True,
                 stem_paths=self.file_manager.get_all_stem_paths(file_path),
@@ -186,38 +334,182 @@ class StemPipeline:
                 engine_name="cached"
             )
         
-        # Get output directory
-        output_dir = self.file_manager.get_output_dir(file_path)
+        return None
+    
+    def register_track(self, file_path: str | Path) -> int:
+        """
+        Get the track record for a file, creating it if needed.
         
-        # Extract metadata and create database record
+        Returns:
+            The track ID
+        """
+        file_path = Path(file_path)
         metadata = self.file_manager.extract_metadata(file_path)
         
-        # Check if track exists in DB, create if not
         track_record = self.db.get_track_by_hash(metadata.file_hash)
-        if track_record is None:
-            track_id = self.db.add_track(
-                file_path=str(file_path),
-                file_hash=metadata.file_hash,
-                artist=metadata.artist,
-                title=metadata.title,
-                bpm=metadata.bpm,
-                key=metadata.key,
-                genre=metadata.genre
-            )
+        if track_record is not None:
+            return track_record.id
+        
+        # Store the fingerprint and full content hash so later runs
+        # (and StemCache) can skip re-hashing this file. Hashing happens
+        # before the insert so no write lock is held while reading.
+        fingerprint = self.hasher.fingerprint(file_path)
+        return self.db.add_track(
+            file_path=fingerprint.path,
+            file_hash=metadata.file_hash,
+            artist=metadata.artist,
+            title=metadata.title,
+            bpm=metadata.bpm,
+            key=metadata.key,
+            genre=metadata.genre,
+            file_size=fingerprint.size,
+            file_mtime_ns=fingerprint.mtime_ns,
+            content_hash=self.hasher.content_hash(file_path)
+        )
+    
+    def _prepare_job(
+        self,
+        file_path: Path,
+        engine: EngineChoice,
+        job_id: Optional[int] = None
+    ) -> _PreparedJob:
+        """
+        Create the track/job records and pick an engine for a file.
+        
+        Args:
+            file_path: Audio file
+            engine: Engine preference
+            job_id: Queued job to run (see JobQueue) instead of creating one
+        """
+        # Get output directory
+        output_dir = self.file_manager.get_output_dir(file_path)
+        
+        if job_id is not None:
+            track_id = self.db.get_job(job_id).track_id
+        else:
+            track_id = self.register_track(file_path)
+        track = self.db.get_track(track_id)
+        genre = track.genre if track else None
+        
+        # Select engine
+        route = self._route(file_path, engine, genre)
+        selected_engine = route.engine
+        
+        if job_id is not None:
+            self.db.start_job(job_id, selected_engine.name)
         else:
-            track_id = track_record.id
+            # Create job record
+            with self.db.batch():
+                job_id = self.db.create_job(track_id, selected_engine.name)
+                self.db.update_job_status(job_id, JobStatus.PROCESSING)
         
-        # Select engine and run separation
-        selected_engine = self._select_engine(file_path, engine)
+        file_size = file_path.stat().st_size
+        job = _PreparedJob(
+            file_path=file_path,
+            output_dir=output_dir,
+            track_id=track_id,
+            engine=selected_engine,
+            job_id=job_id,
+            file_size=file_size,
+            genre=genre,
+            ticket=self.router.start(selected_engine, file_size)
+        )
         
-        # Create job record
-        job_id = self.db.create_job(track_id, selected_engine.name)
-        self.db.update_job_status(job_id, JobStatus.PROCESSING)
+        if route.speculate:
+            logger.info(
+                f"Starting cloud fallback for {file_path.name} speculatively "
+                f"(retry probability {route.fallback_probability:.0%})"
+            )
+            job.speculative_ticket = self.router.start(self.lalal, file_size)
+            job.speculative = self.lalal.submit(file_path, self._speculative_dir(output_dir))
         
-        # Run separation
-        result = selected_engine.separate(file_path, output_dir)
+        return job
+    
+    def _abandon(self, job_ids: list[int], error: BaseException) -> None:
+        """
+        Fail jobs still running outside the queue when a run is cut short.
+        
+        Queued jobs are skipped: their lease is released by the queue or
+        runs out, and the job is retried.
+        """
+        for job_id in job_ids:
+            try:
+                self.db.abandon_unleased_job(job_id, f"Interrupted: {error!r}")
+            except Exception as e:
+                logger.warning(f"Could not record interrupted job {job_id}: {e}")
+    
+    @staticmethod
+    def _speculative_dir(output_dir: Path) -> Path:
+        """Where a speculative cloud run writes until it is adopted."""
+        return output_dir / ".speculative"
+    
+    def _adopt_speculative(self, job: _PreparedJob) -> SeparationResult:
+        """Wait for a speculative cloud run and move its stems into place."""
+        result = job.speculative.result()
+        result.wait_for_flush()
+        self.router.finish(
+            job.speculative_ticket, job.file_size,
+            result.processing_time_seconds if result.success else None
+        )
+        
+        if result.success:
+            stem_paths = {}
+            for stem_name, path in result.stem_paths.items():
+                target = job.output_dir / Path(path).name
+                os.replace(path, target)
+                stem_paths[stem_name] = target
+            result.stem_paths = stem_paths
+        
+        shutil.rmtree(self._speculative_dir(job.output_dir), ignore_errors=True)
+        return result
+    
+    def _discard_speculative(self, job: _PreparedJob) -> None:
+        """Cancel (or let finish and delete) an unneeded speculative run."""
+        speculative_dir = self._speculative_dir(job.output_dir)
+        
+        def cleanup(future: Future) -> None:
+            seconds = None
+            if not future.cancelled() and future.exception() is None:
+                seconds = future.result().processing_time_seconds
+            self.router.finish(job.speculative_ticket, job.file_size, seconds)
+            shutil.rmtree(speculative_dir, ignore_errors=True)
+        
+        # Only not-yet-started jobs can be cancelled; a running one is
+        # cleaned up when it completes
+        job.speculative.cancel()
+        job.speculative.add_done_callback(cleanup)
+    
+    def _analyze_result(
+        self,
+        result: SeparationResult,
+        output_dir: Path,
+        file_path: Path
+    ) -> dict[str, float]:
+        """Score stems, using the engine's in-memory buffers when present."""
+        with profile_stage("qa"):
+            if result.stem_audio:
+                return self.quality_analyzer.analyze_stem_audio(
+                    result.stem_audio, result.sample_rate, file_path
+                )
+            return self.quality_analyzer.analyze_all_stems(output_dir, file_path)
+    
+    def _finalize_job(
+        self,
+        job: _PreparedJob,
+        result: SeparationResult,
+        quality_fallback: bool
+    ) -> SeparationResult:
+        """Score a finished separation, run any fallback and record the outcome."""
+        file_path, output_dir, job_id = job.file_path, job.output_dir, job.job_id
+        
+        self.router.finish(
+            job.ticket, job.file_size,
+            result.processing_time_seconds if result.success else None
+        )
         
         if not result.success:
+            if job.speculative is not None:
+                self._discard_speculative(job)
             self.db.update_job_status(
                 job_id, 
                 JobStatus.FAILED, 
@@ -226,46 +518,65 @@ class StemPipeline:
             )
             return result
         
-        # Analyze quality
-        quality_scores = self.quality_analyzer.analyze_all_stems(output_dir, file_path)
-        
-        # Store quality scores
-        for stem_name, si_sdr in quality_scores.items():
-            self.db.add_quality_score(job_id, stem_name, si_sdr)
+        # Analyze quality (overlaps with any background stem flush);
+        # scores are stored with the final status in one transaction
+        quality_scores = self._analyze_result(result, output_dir, file_path)
+        job_scores = quality_scores
         
         # Check if we need to fallback
-        needs_fallback = False
-        if quality_fallback:
-            for stem_name, si_sdr in quality_scores.items():
-                if self.quality_analyzer.needs_reprocessing(stem_name, si_sdr):
-                    needs_fallback = True
-                    break
+        failed_gate = any(
+            self.quality_analyzer.needs_reprocessing(stem_name, si_sdr)
+            for stem_name, si_sdr in quality_scores.items()
+        )
+        if quality_scores:
+            # Counted the way the router's history counts scored jobs
+            self.router.record_quality(job.engine.name, job.genre, failed_gate)
+        needs_fallback = quality_fallback and failed_gate
+        
+        fallback_engine = self._get_fallback_engine(job.engine) if needs_fallback else None
+        if job.speculative is not None and fallback_engine is not self.lalal:
+            self._discard_speculative(job)
+            job.speculative = None
         
         if needs_fallback:
-            fallback_engine = self._get_fallback_engine(selected_engine)
             if fallback_engine:
                 print(f"Quality check failed, retrying with {fallback_engine.name}")
                 
                 # Create new job for fallback
-                fallback_job_id = self.db.create_job(track_id, fallback_engine.name)
-                self.db.update_job_status(fallback_job_id, JobStatus.PROCESSING)
+                with self.db.batch():
+                    fallback_job_id = self.db.create_job(job.track_id, fallback_engine.name)
+                    self.db.update_job_status(fallback_job_id, JobStatus.PROCESSING)
                 
-                # Run fallback separation
-                fallback_result = fallback_engine.separate(file_path, output_dir)
+                try:
+                    # The fallback writes to the same stem paths
+                    result.wait_for_flush()
+                    
+                    # Run fallback separation (or collect the speculative run)
+                    if job.speculative is not None:
+                        fallback_result = self._adopt_speculative(job)
+                    else:
+                        ticket = self.router.start(fallback_engine, job.file_size)
+                        fallback_result = fallback_engine.separate(file_path, output_dir)
+                        self.router.finish(
+                            ticket, job.file_size,
+                            fallback_result.processing_time_seconds if fallback_result.success else None
+                        )
+                except BaseException as e:
+                    self._abandon([fallback_job_id], e)
+                    raise
                 
                 if fallback_result.success:
                     # Re-analyze quality
-                    quality_scores = self.quality_analyzer.analyze_all_stems(
-                        output_dir, file_path
-                    )
-                    for stem_name, si_sdr in quality_scores.items():
-                        self.db.add_quality_score(fallback_job_id, stem_name, si_sdr)
-                    
-                    self.db.update_job_status(
-                        fallback_job_id,
-                        JobStatus.COMPLETED,
-                        fallback_result.processing_time_seconds
+                    quality_scores = self._analyze_result(
+                        fallback_result, output_dir, file_path
                     )
+                    with self.db.batch():
+                        self.db.add_quality_scores(fallback_job_id, quality_scores)
+                        self.db.update_job_status(
+                            fallback_job_id,
+                            JobStatus.COMPLETED,
+                            fallback_result.processing_time_seconds
+                        )
                     result = fallback_result
                 else:
                     self.db.update_job_status(
@@ -276,17 +587,182 @@ class StemPipeline:
                     )
         
         # Save metadata
-        self._save_metadata(file_path, output_dir, result, quality_scores)
+        self._save_metadata(file_path, output_dir, result, quality_scores, job.track_id)
         
-        # Update original job status
-        self.db.update_job_status(
-            job_id,
-            JobStatus.COMPLETED,
-            result.processing_time_seconds
-        )
+        # Only report completion once the stems are actually on disk
+        result.wait_for_flush()
+        
+        # Record the original job's scores and status
+        with self.db.batch():
+            self.db.add_quality_scores(job_id, job_scores)
+            self.db.update_job_status(
+                job_id,
+                JobStatus.COMPLETED,
+                result.processing_time_seconds
+            )
         
         return result
     
+    def separate(
+        self,
+        file_path: str | Path,
+        engine: EngineChoice = "auto",
+        skip_if_exists: bool = True,
+        quality_fallback: bool = True,
+        job_id: Optional[int] = None
+    ) -> SeparationResult:
+        """
+        Separate an audio file into stems.
+        
+        Args:
+            file_path: Path to the audio file
+            engine: Engine selection ('auto', 'demucs', 'lalal', 'native'/'uvr')
+            skip_if_exists: Skip if stems already exist
+            quality_fallback: Retry with fallback engine if quality is poor
+            job_id: Queued job (claimed via JobQueue) to record this run
+                under; a new job is created when None
+        
+        Returns:
+            SeparationResult with stem paths and metadata
+        """
+        file_path = Path(file_path)
+        
+        existing = self._check_existing(file_path, skip_if_exists)
+        if existing is not None:
+            return existing
+        
+        job = self._prepare_job(file_path, engine, job_id)
+        
+        try:
+            # Run separation
+            result = job.engine.separate(file_path, job.output_dir)
+            
+            return self._finalize_job(job, result, quality_fallback)
+        except BaseException as e:
+            self._abandon([job.job_id], e)
+            raise
+    
+    def separate_batch(
+        self,
+        file_paths: list[str | Path],
+        engine: EngineChoice = "auto",
+        skip_if_exists: bool = True,
+        quality_fallback: bool = True,
+        batch_size: Optional[int] = None,
+        job_ids: Optional[list[Optional[int]]] = None
+    ) -> list[SeparationResult]:
+        """
+        Separate several files, batching Demucs inference across tracks.
+        
+        Files routed to Demucs are separated together with
+        DemucsEngine.separate_batch() while files routed to LALAL.AI run
+        as concurrent cloud jobs alongside it; any other engine runs per
+        file.
+        Quality checks and fallbacks then run per file as in separate().
+        Unlike separate(), per-file setup errors are returned as failed
+        results rather than raised, so one bad file can't sink a batch.
+        
+        Args:
+            file_paths: Audio files to separate
+            engine: Engine selection ('auto', 'demucs', 'lalal', 'native'/'uvr')
+            skip_if_exists: Skip files whose stems already exist
+            quality_fallback: Retry with fallback engine if quality is poor
+            batch_size: Segments per Demucs inference call
+            job_ids: Queued job for each file (or None entries) to record
+                runs under, as in separate()
+        
+        Returns:
+            SeparationResult for each file, in the same order
+        """
+        results: list[Optional[SeparationResult]] = [None] * len(file_paths)
+        demucs_jobs: list[tuple[int, _PreparedJob]] = []
+        cloud_jobs: list[tuple[int, _PreparedJob, Future]] = []
+        
+        prepared: list[int] = []
+        try:
+            for i, file_path in enumerate(file_paths):
+                file_path = Path(file_path)
+                
+                existing = self._check_existing(file_path, skip_if_exists)
+                if existing is not None:
+                    results[i] = existing
+                    continue
+                
+                try:
+                    job = self._prepare_job(file_path, engine, job_ids[i] if job_ids else None)
+                except Exception as e:
+                    results[i] = SeparationResult(
+                        success=False,
+                        stem_paths={},
+                        processing_time_seconds=0,
+                        engine_name="none",
+                        error_message=str(e)
+                    )
+                    continue
+                prepared.append(job.job_id)
+                
+                if job.engine is self.demucs:
+                    demucs_jobs.append((i, job))
+                elif job.engine is self.lalal:
+                    # Cloud jobs run in the background while Demucs works
+                    cloud_jobs.append((i, job, self.lalal.submit(file_path, job.output_dir)))
+                else:
+                    result = job.engine.separate(file_path, job.output_dir)
+                    results[i] = self._finalize_job(job, result, quality_fallback)
+            
+            if demucs_jobs:
+                batch_results = self.demucs.separate_batch(
+                    [(job.file_path, job.output_dir) for _, job in demucs_jobs],
+                    batch_size=batch_size
+                )
+                
+                # Finalize on several threads so cloud fallbacks for tracks that
+                # fail the quality gate stay in flight together
+                workers = self.lalal.max_in_flight if self.lalal.is_available() else 1
+                with ThreadPoolExecutor(max_workers=workers) as executor:
+                    finalized = [
+                        (i, executor.submit(self._finalize_job, job, result, quality_fallback))
+                        for (i, job), result in zip(demucs_jobs, batch_results)
+                    ]
+                    # Cloud results (whose fallback is the local model) are
+                    # finalized here, one at a time
+                    for i, job, future in cloud_jobs:
+                        results[i] = self._finalize_job(job, future.result(), quality_fallback)
+                    for i, future in finalized:
+                        results[i] = future.result()
+            else:
+                for i, job, future in cloud_jobs:
+                    results[i] = self._finalize_job(job, future.result(), quality_fallback)
+        except BaseException as e:
+            # Don't leave jobs started outside the queue running forever
+            self._abandon(prepared, e)
+            raise
+        
+        return results
+    
+    def replicate(self, device: Optional[str]) -> "StemPipeline":
+        """
+        Create a pipeline with the same settings bound to another device.
+        
+        Replicas share the output directory and database, so stems and
+        job records from every device land in one library.
+        """
+        return StemPipeline(
+            base_dir=str(self.file_manager.base_dir),
+            db_path=str(self.db.db_path),
+            streaming=self.streaming,
+            in_memory=self.in_memory,
+            device=device,
+            stem_format=self.file_manager.stem_format.name,
+            precision=self.precision,
+            checkpoint_segments=self.checkpoint_segments
+        )
+    
+    def warm_up(self) -> None:
+        """Load the Demucs model onto its device ahead of the first job."""
+        if self.demucs.is_available():
+            self.demucs._load_model()
+    
     def get_stats(self) -> dict:
         """
         Get pipeline statistics.
@@ -299,4 +775,5 @@ class StemPipeline:
             "base_dir": str(self.file_manager.base_dir),
             "demucs_available": self.demucs.is_available(),
             "lalal_available": self.lalal.is_available(),
+            "native_available": self.native.is_available(),
         }
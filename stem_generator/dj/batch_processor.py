@@ -5,15 +5,24 @@ Threaded batch processing of DJ libraries with resume support.
 """
 
 import json
+import threading
 import time
-from concurrent.futures import ThreadPoolExecutor, as_completed
+from concurrent.futures import Future, ThreadPoolExecutor
+from contextlib import ExitStack
 from dataclasses import dataclass
 from pathlib import Path
-from typing import Callable, Optional
+from typing import TYPE_CHECKING, Callable, Optional
 
-from .library_scanner import DJLibraryScanner, ScannedTrack, ScanResult
+from .job_queue import JobQueue
+from .library_scanner import DJLibraryScanner, Priority, ScannedTrack, ScanResult
 from ..core.stem_pipeline import StemPipeline
 from ..core.engines.base_engine import SeparationResult
+from ..optimization.gpu_scheduler import MultiGPUScheduler
+from ..optimization.profiler import profiling
+
+if TYPE_CHECKING:
+    from ..optimization.metrics import PipelineMetrics
+    from ..server.client import SeparationClient
 
 
 @dataclass
@@ -52,33 +61,67 @@ class DJBatchProcessor:
     Threaded batch processor for stem separation.
     
     Features:
-        - ThreadPoolExecutor for parallel processing
-        - Resume support (skips already processed files)
+        - Batched GPU inference across tracks (segments from several
+          tracks share one apply_model call)
+        - Durable job queue: every track is a leased job, so a crashed
+          run resumes from the unfinished jobs (and, in streaming mode,
+          from the last checkpointed segment of a track)
         - Progress callbacks for UI integration
         - Respects GPU batch size recommendations
+        - Can submit to a warm separation server instead of loading
+          models in-process
+        - Multi-GPU mode with a model replica per device
+        - Optional live metrics (PipelineMetrics) for a Prometheus scrape
     """
     
+    # Tracks handed to the pipeline per batched call; larger groups keep
+    # the GPU fed across track boundaries, smaller ones report progress
+    # (and run QA) sooner
+    TRACKS_PER_GROUP = 8
+    
     def __init__(
         self,
         pipeline: Optional[StemPipeline] = None,
         scanner: Optional[DJLibraryScanner] = None,
-        max_workers: Optional[int] = None
+        max_workers: Optional[int] = None,
+        batched: bool = False,
+        client: Optional["SeparationClient"] = None,
+        multi_gpu: bool = False,
+        metrics: Optional["PipelineMetrics"] = None
     ):
         """
         Initialize the batch processor.
         
         Args:
             pipeline: StemPipeline instance (created if not provided)
-            scanner: DJLibraryScanner instance (created if not provided)
-            max_workers: Maximum parallel workers (auto-determined from engine)
+            scanner: DJLibraryScanner instance (created with the pipeline's
+                database for incremental scans if not provided)
+            max_workers: Inference batch size (auto-determined from engine)
+            batched: Pack segments from several tracks into each
+                inference call instead of processing tracks one by one
+            client: SeparationClient for a running server; when set,
+                tracks are separated by the server (the local pipeline is
+                only used for bookkeeping and never loads a model)
+            multi_gpu: Run one pipeline replica per CUDA device and spread
+                tracks across them
+            metrics: Metric set to update while processing (stage
+                timings, track outcomes, queue and cloud-job gauges)
         """
+        self.client = client
         self.pipeline = pipeline or StemPipeline()
-        self.scanner = scanner or DJLibraryScanner()
+        # Share the pipeline's database so rescans are incremental
+        self.scanner = scanner or DJLibraryScanner(db=self.pipeline.db)
         self._max_workers = max_workers
+        self.batched = batched
+        self.multi_gpu = multi_gpu
+        self.queue = JobQueue(self.pipeline.db)
+        self.metrics = metrics
+        if metrics is not None:
+            metrics.watch_pipeline(self.pipeline)
     
     @property
     def max_workers(self) -> int:
-        """Get the maximum number of parallel workers."""
+        """Get the inference batch size (tracks sharing a GPU call)."""
         if self._max_workers:
             return self._max_workers
         
@@ -91,16 +134,129 @@ class DJBatchProcessor:
     def _process_track(
         self,
         track: ScannedTrack,
-        skip_existing: bool = True
+        skip_existing: bool = True,
+        job_id: Optional[int] = None
     ) -> SeparationResult:
         """Process a single track."""
+        if self.client is not None:
+            return self.client.separate(
+                track.path,
+                engine="auto",
+                skip_if_exists=skip_existing,
+                quality_fallback=True
+            )
         return self.pipeline.separate(
             track.path,
             engine="auto",
             skip_if_exists=skip_existing,
-            quality_fallback=True
+            quality_fallback=True,
+            job_id=job_id
+        )
+    
+    def _enqueue(self, tracks: list[ScannedTrack]) -> list[Optional[int]]:
+        """
+        Register tracks and queue a job for each.
+        
+        Returns:
+            Job ID per track (None if the track could not be registered;
+            it is then processed without a queued job)
+        """
+        job_ids: list[Optional[int]] = []
+        for track in tracks:
+            try:
+                job_ids.append(self.queue.enqueue(self.pipeline.register_track(track.path)))
+            except Exception:
+                job_ids.append(None)
+        return job_ids
+    
+    def _claim(self, job_id: Optional[int]) -> bool:
+        """
+        Take the lease on a track's job right before it is processed.
+        
+        Each claim counts as an attempt, so jobs are claimed one at a time
+        as work reaches them, never a whole batch up front: a run that is
+        killed leaves the tracks it never reached untouched.
+        
+        Returns:
+            False if another worker holds the job (or it already finished)
+        """
+        return job_id is None or self.queue.claim(job_id)
+    
+    def _when_claimed(
+        self,
+        job_id: Optional[int],
+        fn: Callable[..., SeparationResult],
+        *args,
+        **kwargs
+    ) -> Optional[SeparationResult]:
+        """Run fn on a worker once the job is claimed (None if it wasn't)."""
+        if not self._claim(job_id):
+            return None
+        return fn(*args, **kwargs)
+    
+    def _record_result(
+        self,
+        track: ScannedTrack,
+        result: SeparationResult,
+        progress: BatchProgress,
+        results: list[tuple[ScannedTrack, SeparationResult]],
+        errors: list[tuple[ScannedTrack, str]],
+        job_id: Optional[int] = None
+    ) -> None:
+        """Fold one track's result into the batch totals."""
+        if job_id is not None:
+            self.queue.finish(job_id, result)
+        
+        if self.metrics is not None:
+            self.metrics.observe_result(result)
+        
+        # Results are kept for the whole batch; don't keep stems in RAM too
+        result.release_audio()
+        results.append((track, result))
+        
+        if result.success:
+            if result.engine_name == "cached":
+                progress.skipped += 1
+            else:
+                progress.completed += 1
+        else:
+            progress.failed += 1
+            if result.error_message:
+                errors.append((track, result.error_message))
+    
+    @staticmethod
+    def _error_result(message: str) -> SeparationResult:
+        return SeparationResult(
+            success=False,
+            stem_paths={},
+            processing_time_seconds=0,
+            engine_name="none",
+            error_message=message
         )
     
+    def _collect(
+        self,
+        futures: list[tuple[ScannedTrack, Optional[int], Future]],
+        progress: BatchProgress,
+        results: list[tuple[ScannedTrack, SeparationResult]],
+        errors: list[tuple[ScannedTrack, str]],
+        progress_callback: Optional[ProgressCallback]
+    ) -> None:
+        """Fold concurrently running tracks into the totals in submission order."""
+        for track, job_id, future in futures:
+            try:
+                result = future.result()
+            except Exception as e:
+                result = self._error_result(str(e))
+            if result is None:
+                # Another worker holds the job
+                progress.skipped += 1
+                continue
+            self._record_result(track, result, progress, results, errors, job_id)
+            
+            if progress_callback:
+                progress_callback(progress, track)
+    
     def process_directory(
         self,
         directory: str | Path,
@@ -129,43 +285,11 @@ class DJBatchProcessor:
         if limit:
             tracks = tracks[:limit]
         
-        progress = BatchProgress(total=len(tracks))
-        results: list[tuple[ScannedTrack, SeparationResult]] = []
-        errors: list[tuple[ScannedTrack, str]] = []
+        result = self.process_tracks(tracks, progress_callback, skip_existing)
         
-        # Sequential processing for GPU-bound work
-        # (GPU can't truly parallelize, so we process one at a time)
-        for track in tracks:
-            try:
-                result = self._process_track(track, skip_existing)
-                results.append((track, result))
-                
-                if result.success:
-                    if result.engine_name == "cached":
-                        progress.skipped += 1
-                    else:
-                        progress.completed += 1
-                else:
-                    progress.failed += 1
-                    if result.error_message:
-                        errors.append((track, result.error_message))
-                        
-            except Exception as e:
-                progress.failed += 1
-                errors.append((track, str(e)))
-            
-            # Call progress callback
-            if progress_callback:
-                progress_callback(progress, track)
-        
-        processing_time = time.time() - start_time
-        
-        return BatchResult(
-            progress=progress,
-            results=results,
-            errors=errors,
-            processing_time_seconds=processing_time
-        )
+        # Include scan time in the reported total
+        result.processing_time_seconds = time.time() - start_time
+        return result
     
     def process_tracks(
         self,
@@ -176,6 +300,9 @@ class DJBatchProcessor:
         """
         Process a list of pre-scanned tracks.
         
+        Every track is queued as a job first, so an interrupted run can be
+        picked up with resume_processing().
+        
         Args:
             tracks: List of ScannedTrack instances to process
             progress_callback: Called after each track is processed
@@ -184,33 +311,115 @@ class DJBatchProcessor:
         Returns:
             BatchResult with processing statistics
         """
+        return self._run_jobs(tracks, self._enqueue(tracks), progress_callback, skip_existing)
+    
+    def _run_jobs(
+        self,
+        tracks: list[ScannedTrack],
+        job_ids: list[Optional[int]],
+        progress_callback: Optional[ProgressCallback],
+        skip_existing: bool
+    ) -> BatchResult:
+        """Claim and process queued tracks."""
         start_time = time.time()
         
         progress = BatchProgress(total=len(tracks))
         results: list[tuple[ScannedTrack, SeparationResult]] = []
         errors: list[tuple[ScannedTrack, str]] = []
         
-        for track in tracks:
-            try:
-                result = self._process_track(track, skip_existing)
-                results.append((track, result))
-                
-                if result.success:
-                    if result.engine_name == "cached":
+        queued = list(zip(tracks, job_ids))
+        
+        cleanup = ExitStack()
+        if self.metrics is not None:
+            # Stage timings feed the metrics while this batch runs
+            cleanup.enter_context(profiling(self.metrics.profiler))
+        
+        try:
+            if self.client is not None:
+                # Keep every server worker busy with one spare job queued
+                # behind it; results are folded in on this thread as they finish
+                workers = self.client.status().get("workers", 1) + 1
+                with ThreadPoolExecutor(max_workers=workers) as executor:
+                    futures = [
+                        (track, job_id, executor.submit(
+                            self._when_claimed, job_id,
+                            self._process_track, track, skip_existing
+                        ))
+                        for track, job_id in queued
+                    ]
+                    self._collect(futures, progress, results, errors, progress_callback)
+            elif self.multi_gpu:
+                # One replica per GPU; the scheduler balances by free VRAM and
+                # lets idle cards steal queued tracks
+                scheduler = MultiGPUScheduler(
+                    self.pipeline.replicate, warm_up=StemPipeline.warm_up
+                )
+                if self.metrics is not None:
+                    self.metrics.watch_scheduler(scheduler)
+                    cleanup.callback(self.metrics.unwatch_scheduler, scheduler)
+                with scheduler:
+                    futures = [
+                        (track, job_id, scheduler.submit(
+                            lambda replica, path, job_id: self._when_claimed(
+                                job_id, replica.separate, path,
+                                engine="auto",
+                                skip_if_exists=skip_existing,
+                                quality_fallback=True,
+                                job_id=job_id
+                            ),
+                            track.path,
+                            job_id
+                        ))
+                        for track, job_id in queued
+                    ]
+                    self._collect(futures, progress, results, errors, progress_callback)
+            elif self.batched:
+                # Each group shares GPU batches; decode and stem writes are
+                # pipelined on worker threads inside the engine
+                for start in range(0, len(queued), self.TRACKS_PER_GROUP):
+                    group = []
+                    for track, job_id in queued[start:start + self.TRACKS_PER_GROUP]:
+                        if self._claim(job_id):
+                            group.append((track, job_id))
+                        else:
+                            progress.skipped += 1
+                    if not group:
+                        continue
+                    try:
+                        group_results = self.pipeline.separate_batch(
+                            [track.path for track, _ in group],
+                            engine="auto",
+                            skip_if_exists=skip_existing,
+                            quality_fallback=True,
+                            batch_size=self.max_workers,
+                            job_ids=[job_id for _, job_id in group]
+                        )
+                    except Exception as e:
+                        group_results = [self._error_result(str(e)) for _ in group]
+                    
+                    for (track, job_id), result in zip(group, group_results):
+                        self._record_result(track, result, progress, results, errors, job_id)
+                        if progress_callback:
+                            progress_callback(progress, track)
+            else:
+                # One track at a time; each inference call sees a single track
+                for track, job_id in queued:
+                    if not self._claim(job_id):
                         progress.skipped += 1
-                    else:
-                        progress.completed += 1
-                else:
-                    progress.failed += 1
-                    if result.error_message:
-                        errors.append((track, result.error_message))
-                        
-            except Exception as e:
-                progress.failed += 1
-                errors.append((track, str(e)))
-            
-            if progress_callback:
-                progress_callback(progress, track)
+                        continue
+                    try:
+                        result = self._process_track(track, skip_existing, job_id)
+                    except Exception as e:
+                        result = self._error_result(str(e))
+                    self._record_result(track, result, progress, results, errors, job_id)
+                    
+                    if progress_callback:
+                        progress_callback(progress, track)
+        finally:
+            # Jobs cut off mid-track (e.g. Ctrl-C) go straight back to
+            # the queue instead of waiting out their lease
+            self.queue.close()
+            cleanup.close()
         
         processing_time = time.time() - start_time
         
@@ -221,16 +430,45 @@ class DJBatchProcessor:
             processing_time_seconds=processing_time
         )
     
+    def watch_directory(
+        self,
+        directory: str | Path,
+        progress_callback: Optional[ProgressCallback] = None,
+        interval: float = 5.0,
+        stop: Optional[threading.Event] = None
+    ) -> None:
+        """
+        Process tracks as they are added to or modified in a directory.
+        
+        Blocks until `stop` is set. Only changed files are re-read and
+        separated; tracks that already have stems are skipped.
+        
+        Args:
+            directory: Directory to watch
+            progress_callback: Called after each track is processed
+            interval: Seconds between filesystem polls
+            stop: Event that ends the watch when set
+        """
+        def on_change(changed: list[ScannedTrack], removed: list[Path]) -> None:
+            if changed:
+                self.process_tracks(changed, progress_callback, skip_existing=True)
+        
+        self.scanner.watch(directory, on_change, interval=interval, stop=stop)
+    
     def resume_processing(
         self,
         directory: str | Path,
         progress_callback: Optional[ProgressCallback] = None
     ) -> BatchResult:
         """
-        Resume processing a directory, skipping already completed files.
+        Resume an interrupted run from the job queue.
         
-        This is equivalent to process_directory with skip_existing=True,
-        but provides clearer intent for resuming interrupted jobs.
+        Only jobs still pending (or whose worker stopped heartbeating)
+        under the directory are processed; nothing is rescanned or
+        re-hashed, so the cost is proportional to what is left. Tracks cut
+        off mid-separation in streaming mode continue from their last
+        segment checkpoint. If nothing is queued, this falls back to a
+        full pass that skips tracks with existing stems.
         
         Args:
             directory: Directory to process
@@ -239,10 +477,28 @@ class DJBatchProcessor:
         Returns:
             BatchResult with processing statistics
         """
-        return self.process_directory(
-            directory,
-            progress_callback=progress_callback,
-            skip_existing=True
+        queued = self.queue.pending(str(Path(directory).resolve()))
+        if not queued:
+            return self.process_directory(
+                directory,
+                progress_callback=progress_callback,
+                skip_existing=True
+            )
+        
+        tracks = [
+            ScannedTrack(
+                path=Path(row['file_path']),
+                artist=row['artist'] or "Unknown Artist",
+                title=row['title'] or Path(row['file_path']).stem,
+                bpm=row['bpm'],
+                key=row['key'],
+                genre=row['genre'],
+                priority=Priority(row['priority']) if row['priority'] else Priority.NORMAL
+            )
+            for row in queued
+        ]
+        return self._run_jobs(
+            tracks, [row['job_id'] for row in queued], progress_callback, skip_existing=True
         )
     
     def get_pending_tracks(self, directory: str | Path) -> list[ScannedTrack]:
@@ -0,0 +1,134 @@
+"""
+Durable Job Queue
+
+Lease-based work queue on top of the jobs table, so an interrupted batch
+resumes from exactly the tracks that never finished.
+"""
+
+import logging
+import os
+import socket
+import threading
+import uuid
+from typing import Optional
+
+from ..core.engines.base_engine import SeparationResult
+from ..utils.database import JobStatus, StemDatabase
+
+
+logger = logging.getLogger(__name__)
+
+
+class JobQueue:
+    """
+    Claims, heartbeats and finishes queued separation jobs.
+    
+    Every job a worker is running holds a lease in the jobs table. One
+    background thread renews all of this queue's leases with a single
+    UPDATE every lease_seconds / 3, so a live worker never loses a job
+    however long a track takes, while a crashed worker's jobs become
+    claimable again once their lease runs out.
+    """
+    
+    # A worker that misses heartbeats for this long loses its jobs
+    DEFAULT_LEASE_SECONDS = 120.0
+    
+    # Claims allowed before a job that keeps killing its worker is failed
+    MAX_ATTEMPTS = 3
+    
+    def __init__(
+        self,
+        db: StemDatabase,
+        owner: Optional[str] = None,
+        lease_seconds: float = DEFAULT_LEASE_SECONDS
+    ):
+        """
+        Initialize the queue.
+        
+        Args:
+            db: Database holding the jobs table
+            owner: Worker identity for leases (unique per process by default)
+            lease_seconds: Lease length
+        """
+        self.db = db
+        self.owner = owner or f"{socket.gethostname()}:{os.getpid()}:{uuid.uuid4().hex[:8]}"
+        self.lease_seconds = lease_seconds
+        
+        self._held: set[int] = set()
+        self._lock = threading.Lock()
+        self._heartbeat: Optional[threading.Thread] = None
+        self._stop = threading.Event()
+    
+    def enqueue(self, track_id: int, engine: str = "auto") -> int:
+        """Queue a job for a track (returns its existing job if it has one)."""
+        return self.db.enqueue_job(track_id, engine)
+    
+    def claim(self, job_id: int) -> bool:
+        """
+        Take the lease on a queued job.
+        
+        Returns:
+            False if another live worker holds it, or it already finished
+        """
+        if not self.db.claim_job(job_id, self.owner, self.lease_seconds, self.MAX_ATTEMPTS):
+            return False
+        
+        with self._lock:
+            self._held.add(job_id)
+            if self._heartbeat is None or self._stop.is_set():
+                self._stop = threading.Event()
+                self._heartbeat = threading.Thread(
+                    target=self._renew_loop, args=(self._stop,),
+                    name="job-heartbeat", daemon=True
+                )
+                self._heartbeat.start()
+        return True
+    
+    def finish(self, job_id: int, result: SeparationResult) -> None:
+        """
+        Record a job's outcome and drop its lease.
+        
+        Jobs the pipeline already finished are left as recorded; this only
+        covers outcomes it never saw (cached stems, server-side runs,
+        failures before the job started).
+        """
+        self.db.finish_leased_job(
+            job_id, self.owner,
+            JobStatus.COMPLETED if result.success else JobStatus.FAILED,
+            result.processing_time_seconds,
+            result.error_message
+        )
+        self._drop(job_id)
+    
+    def release(self, job_id: int) -> None:
+        """Put a claimed job back in the queue unfinished."""
+        self.db.release_job(job_id, self.owner)
+        self._drop(job_id)
+    
+    def pending(self, root: Optional[str] = None) -> list:
+        """Get claimable jobs (see StemDatabase.get_queued_jobs)."""
+        return self.db.get_queued_jobs(root)
+    
+    def close(self) -> None:
+        """Release every job still held and stop the heartbeat."""
+        with self._lock:
+            held = list(self._held)
+        for job_id in held:
+            self.release(job_id)
+        self._stop.set()
+    
+    def _drop(self, job_id: int) -> None:
+        with self._lock:
+            self._held.discard(job_id)
+    
+    def _renew_loop(self, stop: threading.Event) -> None:
+        """Renew this owner's leases until none are held or stop is set."""
+        while not stop.wait(self.lease_seconds / 3):
+            with self._lock:
+                if not self._held:
+                    stop.set()
+                    return
+            try:
+                self.db.renew_leases(self.owner, self.lease_seconds)
+            except Exception as e:
+                logger.warning(f"Lease heartbeat failed: {e}")
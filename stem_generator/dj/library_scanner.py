@@ -5,13 +5,18 @@ Scans DJ libraries and prioritizes tracks for stem processing.
 """
 
 import os
+import threading
+from concurrent.futures import ThreadPoolExecutor
 from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Optional, Iterator
+from typing import TYPE_CHECKING, Callable, Optional, Iterator
 from enum import IntEnum
 
 import music_tag
 
+if TYPE_CHECKING:
+    from ..utils.database import StemDatabase
+
 
 class Priority(IntEnum):
     """Priority levels for track processing."""
@@ -45,9 +50,18 @@ class ScanResult:
     tracks: list[ScannedTrack] = field(default_factory=list)
     total_files: int = 0
     audio_files: int = 0
+    unchanged_files: int = 0  # Served from the library index, tags not re-read
     errors: list[str] = field(default_factory=list)
 
 
+@dataclass
+class _IndexEntry:
+    """What a library file looked like when its tags were last read."""
+    size: int
+    mtime_ns: int
+    track: ScannedTrack
+
+
 class DJLibraryScanner:
     """
     Scans DJ libraries and prioritizes tracks for stem processing.
@@ -59,6 +73,10 @@ class DJLibraryScanner:
         4. Tracks with detected vocals (approximated by genre/checks)
     
     Supported formats: MP3, WAV, FLAC, AIFF, M4A, OGG
+    
+    Scans are incremental when a StemDatabase is attached: the
+    (path, size, mtime) of every file is persisted with its tags, and
+    only new or modified files are re-read, on a thread pool.
     """
     
     AUDIO_EXTENSIONS = {'.mp3', '.wav', '.flac', '.aiff', '.aif', '.m4a', '.ogg'}
@@ -70,14 +88,27 @@ class DJLibraryScanner:
     # Genres that typically have vocals
     VOCAL_GENRES = {'pop', 'r&b', 'rnb', 'soul', 'hip-hop', 'hip hop', 'vocal'}
     
-    def __init__(self, priority_crates: Optional[list[str]] = None):
+    # Concurrent tag reads
+    DEFAULT_WORKERS = 8
+    
+    def __init__(
+        self,
+        priority_crates: Optional[list[str]] = None,
+        db: Optional["StemDatabase"] = None,
+        max_workers: int = DEFAULT_WORKERS
+    ):
         """
         Initialize the library scanner.
         
         Args:
             priority_crates: List of crate/folder names to prioritize
+            db: StemDatabase holding the library index (None scans from
+                scratch every time)
+            max_workers: Threads used to read tags
         """
         self.priority_crates = set(c.lower() for c in (priority_crates or []))
+        self.db = db
+        self.max_workers = max_workers
     
     def _is_audio_file(self, path: Path) -> bool:
         """Check if a file is a supported audio format."""
@@ -151,6 +182,129 @@ class DJLibraryScanner:
         
         return Priority.LOW
     
+    def _walk(self, root: Path, recursive: bool) -> Iterator[tuple[str, int, int]]:
+        """
+        Yield (path, size, mtime_ns) for every file under root.
+        
+        Uses os.scandir so each file costs one stat and no tag reads.
+        Directory symlinks are not followed (they can form cycles).
+        """
+        stack = [str(root)]
+        while stack:
+            current = stack.pop()
+            try:
+                with os.scandir(current) as it:
+                    for entry in it:
+                        try:
+                            if entry.is_dir(follow_symlinks=False):
+                                if recursive:
+                                    stack.append(entry.path)
+                            elif entry.is_file():
+                                st = entry.stat()
+                                yield entry.path, st.st_size, st.st_mtime_ns
+                        except OSError:
+                            continue
+            except OSError:
+                continue
+    
+    def _load_index(self, root: Path) -> dict[str, _IndexEntry]:
+        """Load the persisted index for a directory (empty without a database)."""
+        if self.db is None:
+            return {}
+        
+        index = {}
+        for path, row in self.db.get_library_index(str(root)).items():
+            track = ScannedTrack(
+                path=Path(path),
+                artist=row['artist'] or "Unknown Artist",
+                title=row['title'] or Path(path).stem,
+                bpm=row['bpm'],
+                key=row['key'],
+                genre=row['genre']
+            )
+            index[path] = _IndexEntry(row['file_size'], row['file_mtime_ns'], track)
+        return index
+    
+    def _refresh(
+        self,
+        root: Path,
+        recursive: bool,
+        index: dict[str, _IndexEntry]
+    ) -> tuple[ScanResult, list[ScannedTrack], list[str]]:
+        """
+        Bring an index up to date with the filesystem.
+        
+        Only files whose (size, mtime) changed since they were indexed have
+        their tags read, on the thread pool. The index and (if attached)
+        the database are updated in place.
+        
+        Returns:
+            Tuple of (full scan result, changed/new tracks, removed paths)
+        """
+        result = ScanResult()
+        seen = set()
+        to_read: list[tuple[str, int, int]] = []
+        
+        for path, size, mtime_ns in self._walk(root, recursive):
+            result.total_files += 1
+            if not self._is_audio_file(Path(path)):
+                continue
+            result.audio_files += 1
+            seen.add(path)
+            
+            entry = index.get(path)
+            if entry is not None and entry.size == size and entry.mtime_ns == mtime_ns:
+                result.unchanged_files += 1
+            else:
+                to_read.append((path, size, mtime_ns))
+        
+        # Tag parsing is mostly waiting on file reads (slow on USB and
+        # network drives), so a thread pool overlaps them well
+        changed = []
+        if to_read:
+            with ThreadPoolExecutor(max_workers=self.max_workers) as executor:
+                tracks = executor.map(
+                    lambda item: self._extract_metadata(Path(item[0])), to_read
+                )
+                for (path, size, mtime_ns), track in zip(to_read, tracks):
+                    index[path] = _IndexEntry(size, mtime_ns, track)
+                    changed.append(track)
+        
+        # Files under root that have disappeared (only direct children
+        # are ours to judge on a non-recursive scan)
+        removed = [
+            path for path in index
+            if path not in seen
+            and (recursive or Path(path).parent == root)
+            and Path(path).is_relative_to(root)
+        ]
+        for path in removed:
+            del index[path]
+        
+        for path in seen:
+            track = index[path].track
+            track.priority = self._calculate_priority(track)
+            result.tracks.append(track)
+        
+        if self.db is not None:
+            try:
+                self.db.upsert_library_entries([
+                    (
+                        str(track.path), index[str(track.path)].size,
+                        index[str(track.path)].mtime_ns, track.artist, track.title,
+                        track.bpm, track.key, track.genre, int(track.priority)
+                    )
+                    for track in changed
+                ])
+                self.db.remove_library_entries(removed)
+            except Exception as e:
+                result.errors.append(f"Could not update library index: {e}")
+        
+        # Sort by priority
+        result.tracks.sort(key=lambda t: (t.priority, t.display_name))
+        
+        return result, changed, removed
+    
     def scan_directory(
         self,
         directory: str | Path,
@@ -159,6 +313,9 @@ class DJLibraryScanner:
         """
         Scan a directory for audio files.
         
+        With a database attached, files unchanged since the last scan are
+        served from the library index without reading their tags.
+        
         Args:
             directory: Path to the directory to scan
             recursive: Whether to scan subdirectories
@@ -167,32 +324,52 @@ class DJLibraryScanner:
             ScanResult with found tracks sorted by priority
         """
         directory = Path(directory)
-        result = ScanResult()
         
         if not directory.exists():
+            result = ScanResult()
             result.errors.append(f"Directory not found: {directory}")
             return result
         
-        # Find all files
-        pattern = "**/*" if recursive else "*"
-        for path in directory.glob(pattern):
-            if path.is_file():
-                result.total_files += 1
-                
-                if self._is_audio_file(path):
-                    result.audio_files += 1
-                    
-                    try:
-                        track = self._extract_metadata(path)
-                        track.priority = self._calculate_priority(track)
-                        result.tracks.append(track)
-                    except Exception as e:
-                        result.errors.append(f"Error scanning {path}: {e}")
+        root = directory.absolute()
+        result, _, _ = self._refresh(root, recursive, self._load_index(root))
+        return result
+    
+    def watch(
+        self,
+        directory: str | Path,
+        on_change: Callable[[list[ScannedTrack], list[Path]], None],
+        interval: float = 5.0,
+        recursive: bool = True,
+        stop: Optional[threading.Event] = None
+    ) -> None:
+        """
+        Watch a directory and report new, modified and removed tracks.
         
-        # Sort by priority
-        result.tracks.sort(key=lambda t: (t.priority, t.display_name))
+        Polls with the same stat-only walk as scan_directory, so each
+        pass costs one stat per file and tags are only read for files
+        that changed. The initial state is the persisted index, so tracks
+        added while the watcher was not running are reported on the
+        first pass.
         
-        return result
+        Args:
+            directory: Directory to watch
+            on_change: Called with (changed_tracks, removed_paths) after
+                each pass that found differences
+            interval: Seconds between passes
+            recursive: Whether to watch subdirectories
+            stop: Event that ends the watch when set
+        """
+        root = Path(directory).absolute()
+        stop = stop or threading.Event()
+        index = self._load_index(root)
+        
+        while not stop.is_set():
+            if root.exists():
+                _, changed, removed = self._refresh(root, recursive, index)
+                if changed or removed:
+                    changed.sort(key=lambda t: (t.priority, t.display_name))
+                    on_change(changed, [Path(p) for p in removed])
+            stop.wait(interval)
     
     def scan_multiple(
         self,
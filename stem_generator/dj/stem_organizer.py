@@ -4,17 +4,72 @@ Stem Organizer for DJ Software
 Organizes separated stems for Serato, Rekordbox, and other DJ software.
 """
 
-import shutil
-from dataclasses import dataclass
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Optional, Literal
+from typing import Callable, Optional, Literal
 
+from ..core.engines.base_engine import SeparationResult
+from ..utils.audio_io import find_stem_file, write_stem
+from ..utils.file_linker import link_or_copy, same_filesystem
 from ..utils.file_manager import StemFileManager
 
 
 OutputFormat = Literal["flat", "subdirectory", "mirror"]
 
 
+@dataclass
+class OrganizeProgress:
+    """Running totals of a directory export."""
+    tracks_total: int
+    bytes_total: int
+    tracks_done: int = 0
+    bytes_done: int = 0
+    # Files per placement method ("hardlink", "reflink", "copy", ...)
+    methods: dict[str, int] = field(default_factory=dict)
+    
+    @property
+    def fraction(self) -> float:
+        """Completed share of the export, by bytes."""
+        return self.bytes_done / self.bytes_total if self.bytes_total else 1.0
+
+
+ProgressCallback = Callable[[OrganizeProgress], None]
+
+
+class _ProgressTracker:
+    """Thread-safe OrganizeProgress updates for parallel exports."""
+    
+    def __init__(self, progress: OrganizeProgress, callback: Optional[ProgressCallback]):
+        self.progress = progress
+        self.callback = callback
+        self._lock = threading.Lock()
+    
+    def _notify(self) -> None:
+        # Called with the lock held, so callbacks see consistent totals
+        if self.callback is not None:
+            self.callback(self.progress)
+    
+    def add_bytes(self, n: int) -> None:
+        with self._lock:
+            self.progress.bytes_done += n
+            self._notify()
+    
+    def add_file(self, method: str, size: int, copied: bool) -> None:
+        with self._lock:
+            self.progress.methods[method] = self.progress.methods.get(method, 0) + 1
+            if not copied:
+                # Copies already reported their bytes while running
+                self.progress.bytes_done += size
+            self._notify()
+    
+    def add_track(self) -> None:
+        with self._lock:
+            self.progress.tracks_done += 1
+            self._notify()
+
+
 @dataclass
 class OrganizeResult:
     """Result of a stem organization operation."""
@@ -32,7 +87,15 @@ class StemOrganizer:
         - "subdirectory": Each track gets its own subdirectory
         - "mirror": Mirrors the source library structure
         
-    Naming Convention: {TrackName}_{StemType}.wav
+    Naming Convention: {TrackName}_{StemType}.wav (or .flac, matching
+    the library's stem format)
+    
+    Organized stems are hardlinked (or reflinked) to the files in the
+    stem library rather than copied, so an export costs no extra space.
+    Exports to another filesystem (e.g. a USB stick for a gig) are copied
+    track-parallel with large buffers, skipping files an earlier export
+    already copied, and can be read back from the device for
+    verification.
     """
     
     STEM_COLORS = {
@@ -42,10 +105,17 @@ class StemOrganizer:
         "other": "Orange"
     }
     
+    # Parallel tracks when linking (bound by metadata reads) and when
+    # copying to another device (a few streams keep a USB stick busy
+    # without thrashing it)
+    LINK_WORKERS = 8
+    COPY_WORKERS = 4
+    
     def __init__(
         self,
         file_manager: Optional[StemFileManager] = None,
-        output_format: OutputFormat = "subdirectory"
+        output_format: OutputFormat = "subdirectory",
+        allow_hardlinks: bool = True
     ):
         """
         Initialize the stem organizer.
@@ -53,9 +123,13 @@ class StemOrganizer:
         Args:
             file_manager: StemFileManager instance
             output_format: How to organize output files
+            allow_hardlinks: Hardlink exported stems to the library; set
+                False if the DJ software writes tags into files in place
+                (exports then use reflinks or copies)
         """
         self.file_manager = file_manager or StemFileManager()
         self.output_format = output_format
+        self.allow_hardlinks = allow_hardlinks
     
     def _sanitize_name(self, name: str) -> str:
         """Sanitize a name for use in filenames."""
@@ -78,7 +152,10 @@ class StemOrganizer:
         self,
         source_path: Path,
         output_dir: Path,
-        format_override: Optional[OutputFormat] = None
+        format_override: Optional[OutputFormat] = None,
+        result: Optional[SeparationResult] = None,
+        verify: bool = False,
+        tracker: Optional[_ProgressTracker] = None
     ) -> OrganizeResult:
         """
         Organize stems for a single track.
@@ -87,15 +164,21 @@ class StemOrganizer:
             source_path: Path to the original audio file
             output_dir: Target directory for organized stems
             format_override: Override the default output format
+            result: Fresh SeparationResult; its stem files are linked once
+                flushed, and in-memory stems are written directly when no
+                file is available
+            verify: Read copied stems back and compare with the library
+            tracker: Progress of the directory export this is part of
             
         Returns:
             OrganizeResult with organized stem paths
         """
         output_format = format_override or self.output_format
         stem_dir = self.file_manager.get_output_dir(source_path)
+        stem_audio = result.stem_audio if result is not None else None
         
         # Check if stems exist
-        if not self.file_manager.stems_exist(source_path):
+        if not stem_audio and not self.file_manager.stems_exist(source_path):
             return OrganizeResult(
                 success=False,
                 output_paths={},
@@ -111,35 +194,57 @@ class StemOrganizer:
             if output_format == "subdirectory":
                 # Create subdirectory for this track
                 track_dir = output_dir / track_name
-                track_dir.mkdir(parents=True, exist_ok=True)
+                targets = {
+                    stem_name: track_dir / stem_name
+                    for stem_name in self.file_manager.STEM_NAMES
+                }
                 
-                for stem_name in self.file_manager.STEM_NAMES:
-                    src = stem_dir / f"{stem_name}.wav"
-                    dst = track_dir / f"{stem_name}.wav"
-                    shutil.copy2(src, dst)
-                    output_paths[stem_name] = dst
-                    
             elif output_format == "flat":
                 # All stems in one directory with prefix
-                output_dir.mkdir(parents=True, exist_ok=True)
+                targets = {
+                    stem_name: output_dir / f"{track_name}_{stem_name}"
+                    for stem_name in self.file_manager.STEM_NAMES
+                }
                 
-                for stem_name in self.file_manager.STEM_NAMES:
-                    src = stem_dir / f"{stem_name}.wav"
-                    dst = output_dir / f"{track_name}_{stem_name}.wav"
-                    shutil.copy2(src, dst)
-                    output_paths[stem_name] = dst
-                    
             elif output_format == "mirror":
                 # Mirror source structure (use source's parent folder name)
                 parent_name = source_path.parent.name
                 mirrored_dir = output_dir / parent_name / track_name
-                mirrored_dir.mkdir(parents=True, exist_ok=True)
+                targets = {
+                    stem_name: mirrored_dir / stem_name
+                    for stem_name in self.file_manager.STEM_NAMES
+                }
+            
+            else:
+                targets = {}
+            
+            if result is not None:
+                # Linking the flushed file beats writing a second copy
+                result.wait_for_flush()
+            
+            # Targets are extension-less; exports keep each stem's format
+            for stem_name, dst in targets.items():
+                src = find_stem_file(stem_dir, stem_name)
+                if result is not None and stem_name in result.stem_paths:
+                    src = Path(result.stem_paths[stem_name])
                 
-                for stem_name in self.file_manager.STEM_NAMES:
-                    src = stem_dir / f"{stem_name}.wav"
-                    dst = mirrored_dir / f"{stem_name}.wav"
-                    shutil.copy2(src, dst)
-                    output_paths[stem_name] = dst
+                if src is not None and src.exists():
+                    dst = dst.with_name(dst.name + src.suffix)
+                    method = link_or_copy(
+                        src, dst,
+                        allow_hardlink=self.allow_hardlinks,
+                        verify=verify,
+                        progress=tracker.add_bytes if tracker else None
+                    )
+                    if tracker is not None:
+                        tracker.add_file(method, src.stat().st_size, copied=method == "copy")
+                elif stem_audio and stem_name in stem_audio:
+                    fmt = self.file_manager.stem_format
+                    dst = dst.with_name(dst.name + fmt.extension)
+                    write_stem(dst, stem_audio[stem_name], result.sample_rate, fmt)
+                else:
+                    raise FileNotFoundError(f"Missing {stem_name} stem in {stem_dir}")
+                output_paths[stem_name] = dst
             
             return OrganizeResult(
                 success=True,
@@ -154,41 +259,87 @@ class StemOrganizer:
                 message=f"Error organizing stems: {e}"
             )
     
+    def _stem_bytes(self, source_path: Path) -> int:
+        """Total size of a track's stem files in the library."""
+        stem_dir = self.file_manager.get_output_dir(source_path)
+        total = 0
+        for stem_name in self.file_manager.STEM_NAMES:
+            src = find_stem_file(stem_dir, stem_name)
+            if src is not None:
+                total += src.stat().st_size
+        return total
+    
     def organize_directory(
         self,
         source_dir: Path,
         output_dir: Path,
-        format_override: Optional[OutputFormat] = None
+        format_override: Optional[OutputFormat] = None,
+        max_workers: Optional[int] = None,
+        verify: Optional[bool] = None,
+        progress_callback: Optional[ProgressCallback] = None
     ) -> list[OrganizeResult]:
         """
         Organize all processed stems in a directory.
         
+        Tracks are organized in parallel. When output_dir is on another
+        filesystem than the stem library, stems are copied (see class
+        docstring) and verified by default.
+        
         Args:
             source_dir: Directory containing original audio files
             output_dir: Target directory for organized stems
             format_override: Override the default output format
+            max_workers: Parallel tracks (default: LINK_WORKERS, or
+                COPY_WORKERS across filesystems)
+            verify: Read copied stems back from the target (default: on
+                for another filesystem); linked stems need no check
+            progress_callback: Called from worker threads with the
+                OrganizeProgress after every file and copied chunk
             
         Returns:
             List of OrganizeResult for each track
         """
-        results = []
         source_dir = Path(source_dir)
+        output_dir = Path(output_dir)
         
         # Find all audio files that have been processed
         audio_extensions = {'.mp3', '.wav', '.flac', '.aiff', '.aif', '.m4a', '.ogg'}
         
-        for path in source_dir.rglob("*"):
-            if path.is_file() and path.suffix.lower() in audio_extensions:
-                if self.file_manager.stems_exist(path):
-                    result = self.organize_stems(path, output_dir, format_override)
-                    results.append(result)
+        tracks = [
+            path for path in sorted(source_dir.rglob("*"))
+            if path.is_file() and path.suffix.lower() in audio_extensions
+            and self.file_manager.stems_exist(path)
+        ]
         
-        return results
+        cross_device = not same_filesystem(self.file_manager.base_dir, output_dir)
+        if verify is None:
+            verify = cross_device
+        if max_workers is None:
+            max_workers = self.COPY_WORKERS if cross_device else self.LINK_WORKERS
+        
+        tracker = _ProgressTracker(
+            OrganizeProgress(
+                tracks_total=len(tracks),
+                bytes_total=sum(self._stem_bytes(path) for path in tracks)
+            ),
+            progress_callback
+        )
+        
+        def organize(path: Path) -> OrganizeResult:
+            result = self.organize_stems(
+                path, output_dir, format_override, verify=verify, tracker=tracker
+            )
+            tracker.add_track()
+            return result
+        
+        with ThreadPoolExecutor(max_workers=max(1, max_workers)) as pool:
+            return list(pool.map(organize, tracks))
     
     def create_rekordbox_structure(
         self,
         source_dir: Path,
-        output_dir: Path
+        output_dir: Path,
+        **kwargs
     ) -> list[OrganizeResult]:
         """
         Create Rekordbox-friendly stem organization.
@@ -199,16 +350,19 @@ class StemOrganizer:
         Args:
             source_dir: Directory with original audio
             output_dir: Target directory
+            **kwargs: Passed to organize_directory (max_workers, verify,
+                progress_callback)
             
         Returns:
             List of organization results
         """
-        return self.organize_directory(source_dir, output_dir, "flat")
+        return self.organize_directory(source_dir, output_dir, "flat", **kwargs)
     
     def create_serato_structure(
         self,
         source_dir: Path,
-        output_dir: Path
+        output_dir: Path,
+        **kwargs
     ) -> list[OrganizeResult]:
         """
         Create Serato-friendly stem organization.
@@ -218,8 +372,10 @@ class StemOrganizer:
         Args:
             source_dir: Directory with original audio
             output_dir: Target directory
+            **kwargs: Passed to organize_directory (max_workers, verify,
+                progress_callback)
             
         Returns:
             List of organization results
         """
-        return self.organize_directory(source_dir, output_dir, "subdirectory")
+        return self.organize_directory(source_dir, output_dir, "subdirectory", **kwargs)
@@ -0,0 +1,389 @@
+"""
+Pipeline Benchmark
+
+Runs a fixed corpus through StemPipeline and reports per-stage timings,
+real-time factor, peak memory and throughput per device as JSON that can
+be diffed between releases.
+"""
+
+import json
+import logging
+import os
+import platform
+import sys
+import tempfile
+import time
+from dataclasses import asdict, dataclass, field
+from datetime import datetime, timezone
+from pathlib import Path
+from typing import Optional
+
+from .gpu_manager import GPUManager
+from .profiler import STAGES, StageProfiler, profiling
+
+
+logger = logging.getLogger(__name__)
+
+# Bumped when the report layout changes incompatibly
+REPORT_VERSION = 1
+
+AUDIO_EXTENSIONS = {'.mp3', '.wav', '.flac', '.aiff', '.aif', '.m4a', '.ogg'}
+
+
+@dataclass
+class TrackTiming:
+    """One track of one benchmark run."""
+    file: str
+    audio_seconds: float
+    seconds: float
+    success: bool
+    engine: str
+    error: Optional[str] = None
+    
+    @property
+    def real_time_factor(self) -> Optional[float]:
+        """Processing seconds per second of audio (lower is faster)."""
+        return self.seconds / self.audio_seconds if self.audio_seconds else None
+
+
+@dataclass
+class DeviceRun:
+    """The corpus processed on one device."""
+    device: str
+    engine: str
+    model_load_seconds: float
+    wall_seconds: float = 0.0
+    audio_seconds: float = 0.0
+    peak_rss_mb: Optional[float] = None
+    peak_vram_mb: Optional[float] = None
+    # stage -> {"calls", "seconds", "share"} (share of wall time; stages
+    # on background threads can overlap, so shares may sum past 1)
+    stages: dict[str, dict] = field(default_factory=dict)
+    tracks: list[TrackTiming] = field(default_factory=list)
+    
+    @property
+    def real_time_factor(self) -> Optional[float]:
+        """Wall seconds per second of audio over the whole corpus."""
+        return self.wall_seconds / self.audio_seconds if self.audio_seconds else None
+    
+    @property
+    def tracks_per_hour(self) -> Optional[float]:
+        """Successful tracks per hour of wall time."""
+        done = sum(1 for t in self.tracks if t.success)
+        return done * 3600 / self.wall_seconds if self.wall_seconds else None
+    
+    def to_dict(self) -> dict:
+        data = asdict(self)
+        data["real_time_factor"] = self.real_time_factor
+        data["tracks_per_hour"] = self.tracks_per_hour
+        for track, entry in zip(self.tracks, data["tracks"]):
+            entry["real_time_factor"] = track.real_time_factor
+        return data
+
+
+def _reset_peak_rss() -> bool:
+    """Restart the kernel's peak-RSS counter (Linux only)."""
+    try:
+        with open("/proc/self/clear_refs", "w") as f:
+            f.write("5")
+        return True
+    except OSError:
+        return False
+
+
+def _peak_rss_mb() -> Optional[float]:
+    """Peak resident memory of this process in MB (None if unknown)."""
+    try:
+        with open("/proc/self/status") as f:
+            for line in f:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1]) / 1024
+    except OSError:
+        pass
+    try:
+        import resource
+    except ImportError:
+        return None  # Windows
+    # ru_maxrss is KB on Linux and bytes on macOS (and never resets)
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return peak / (1024 * 1024) if sys.platform == "darwin" else peak / 1024
+
+
+def audio_duration(path: Path) -> float:
+    """Duration of an audio file in seconds (0.0 if it can't be read)."""
+    try:
+        import soundfile as sf
+        return sf.info(str(path)).duration
+    except Exception:
+        pass
+    try:
+        import librosa
+        return librosa.get_duration(path=str(path))
+    except Exception:
+        return 0.0
+
+
+def load_corpus(path: Path, limit: Optional[int] = None) -> list[Path]:
+    """
+    Collect benchmark tracks in a stable order.
+    
+    Args:
+        path: Audio file, or directory searched recursively
+        limit: Maximum number of tracks
+    
+    Returns:
+        Sorted list of audio files
+    """
+    path = Path(path)
+    if path.is_file():
+        return [path]
+    files = sorted(
+        p for p in path.rglob("*")
+        if p.is_file() and p.suffix.lower() in AUDIO_EXTENSIONS
+    )
+    return files[:limit] if limit else files
+
+
+class PipelineBenchmark:
+    """
+    Benchmarks StemPipeline on a fixed corpus.
+    
+    Each device gets a fresh pipeline writing to a temporary library, so
+    runs never hit existing stems. Model loading is timed separately and
+    excluded; quality fallbacks are disabled so the cloud never enters
+    local numbers. Stage timings come from StageProfiler hooks in the
+    engines, hasher, quality analyzer and database.
+    
+    Example:
+        bench = PipelineBenchmark(load_corpus(Path("bench")), devices=["cuda:0"])
+        report = bench.run()
+        PipelineBenchmark.save_report(report, Path("bench.json"))
+    """
+    
+    def __init__(
+        self,
+        corpus: list[Path],
+        engine: str = "demucs",
+        devices: Optional[list[Optional[str]]] = None,
+        streaming: bool = False,
+        in_memory: bool = False,
+        precision: str = "fp32",
+        stem_format: Optional[str] = None,
+        batched: bool = False,
+        repeat: int = 1
+    ):
+        """
+        Initialize the benchmark.
+        
+        Args:
+            corpus: Tracks to process (see load_corpus)
+            engine: Engine choice passed to the pipeline
+            devices: Devices to benchmark one after another (None for auto)
+            streaming: Use segment-streaming Demucs
+            in_memory: Score stems from memory, write in the background
+            precision: Demucs inference precision
+            stem_format: Stem storage format
+            batched: Use StemPipeline.separate_batch instead of per-file
+            repeat: Passes over the corpus per device
+        """
+        if not corpus:
+            raise ValueError("Benchmark corpus is empty")
+        self.corpus = [Path(p) for p in corpus]
+        self.engine = engine
+        self.devices = devices or [None]
+        self.streaming = streaming
+        self.in_memory = in_memory
+        self.precision = precision
+        self.stem_format = stem_format
+        self.batched = batched
+        self.repeat = max(1, repeat)
+        self.gpu = GPUManager()
+        self._durations = {p: audio_duration(p) for p in self.corpus}
+    
+    def _settings(self) -> dict:
+        return {
+            "engine": self.engine,
+            "streaming": self.streaming,
+            "in_memory": self.in_memory,
+            "precision": self.precision,
+            "stem_format": self.stem_format,
+            "batched": self.batched,
+            "repeat": self.repeat,
+        }
+    
+    def _host(self) -> dict:
+        from .. import __version__
+        
+        host = {
+            "version": __version__,
+            "python": platform.python_version(),
+            "platform": platform.platform(),
+            "cpu_count": os.cpu_count(),
+            "gpus": [],
+        }
+        for i in range(self.gpu.device_count):
+            info = self.gpu.get_gpu_info(i)
+            if info:
+                host["gpus"].append({
+                    "name": info.name,
+                    "vram_gb": round(info.vram_gb, 1),
+                    "cuda": info.cuda_version,
+                })
+        return host
+    
+    def _separate_all(self, pipeline, run: DeviceRun) -> None:
+        """One pass over the corpus."""
+        if self.batched:
+            results = pipeline.separate_batch(
+                self.corpus, engine=self.engine,
+                skip_if_exists=False, quality_fallback=False
+            )
+            for path, result in zip(self.corpus, results):
+                result.wait_for_flush()
+                run.tracks.append(TrackTiming(
+                    path.name, self._durations[path], result.processing_time_seconds,
+                    result.success, result.engine_name, result.error_message
+                ))
+            return
+        
+        for path in self.corpus:
+            start = time.perf_counter()
+            try:
+                result = pipeline.separate(
+                    path, engine=self.engine,
+                    skip_if_exists=False, quality_fallback=False
+                )
+                result.wait_for_flush()
+                success, engine, error = result.success, result.engine_name, result.error_message
+            except Exception as e:
+                success, engine, error = False, self.engine, str(e)
+            run.tracks.append(TrackTiming(
+                path.name, self._durations[path], time.perf_counter() - start,
+                success, engine, error
+            ))
+    
+    def _run_device(self, device: Optional[str]) -> DeviceRun:
+        """Benchmark the corpus on one device."""
+        from ..core.stem_pipeline import StemPipeline
+        
+        with tempfile.TemporaryDirectory(prefix="stem-bench-") as tmp:
+            pipeline = StemPipeline(
+                base_dir=tmp,
+                streaming=self.streaming,
+                in_memory=self.in_memory,
+                device=device,
+                stem_format=self.stem_format,
+                precision=self.precision
+            )
+            
+            start = time.perf_counter()
+            pipeline.warm_up()
+            load_seconds = time.perf_counter() - start
+            
+            resolved = pipeline.demucs.device if pipeline.demucs.is_available() else (device or "cpu")
+            run = DeviceRun(device=resolved, engine=self.engine, model_load_seconds=load_seconds)
+            
+            gpu_index = None
+            if resolved.startswith("cuda"):
+                gpu_index = int(resolved.split(":")[1]) if ":" in resolved else 0
+                self.gpu.reset_peak_memory(gpu_index)
+            if not _reset_peak_rss():
+                logger.info("Peak RSS can't be reset here; reporting the process peak")
+            
+            profiler = StageProfiler()
+            with profiling(profiler):
+                start = time.perf_counter()
+                for _ in range(self.repeat):
+                    self._separate_all(pipeline, run)
+                run.wall_seconds = time.perf_counter() - start
+            
+            pipeline.db.close()
+        
+        run.audio_seconds = sum(self._durations.values()) * self.repeat
+        run.peak_rss_mb = _peak_rss_mb()
+        if gpu_index is not None:
+            run.peak_vram_mb = self.gpu.get_peak_memory(gpu_index) * 1024
+        
+        for stage, timing in profiler.snapshot().items():
+            run.stages[stage] = {
+                "calls": timing.calls,
+                "seconds": timing.seconds,
+                "share": timing.seconds / run.wall_seconds if run.wall_seconds else None,
+            }
+        return run
+    
+    def run(self) -> dict:
+        """
+        Run the benchmark on every device.
+        
+        Returns:
+            Report dict (see save_report)
+        """
+        runs = []
+        for device in self.devices:
+            logger.info(f"Benchmarking {len(self.corpus)} tracks on {device or 'auto'}")
+            runs.append(self._run_device(device))
+        
+        return {
+            "report_version": REPORT_VERSION,
+            "created_at": datetime.now(timezone.utc).isoformat(timespec="seconds"),
+            "host": self._host(),
+            "settings": self._settings(),
+            "corpus": [
+                {
+                    "file": p.name,
+                    "bytes": p.stat().st_size,
+                    "audio_seconds": self._durations[p],
+                }
+                for p in self.corpus
+            ],
+            "runs": [run.to_dict() for run in runs],
+        }
+    
+    @staticmethod
+    def save_report(report: dict, path: Path) -> None:
+        """Write a report as JSON."""
+        path = Path(path)
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(json.dumps(report, indent=2))
+    
+    @staticmethod
+    def load_report(path: Path) -> dict:
+        """Read a report written by save_report."""
+        return json.loads(Path(path).read_text())
+    
+    @staticmethod
+    def compare(report: dict, baseline: dict) -> list[tuple[str, float, float]]:
+        """
+        Pair up headline numbers of two reports, per device.
+        
+        Args:
+            report: Current report
+            baseline: Earlier report (e.g. the previous release)
+        
+        Returns:
+            (metric, baseline value, current value) for every metric
+            present in both; lower is better for all of them
+        """
+        def metrics(run: dict) -> dict[str, float]:
+            values = {
+                "wall_seconds": run.get("wall_seconds"),
+                "real_time_factor": run.get("real_time_factor"),
+                "peak_rss_mb": run.get("peak_rss_mb"),
+                "peak_vram_mb": run.get("peak_vram_mb"),
+            }
+            for stage in STAGES:
+                if stage in run.get("stages", {}):
+                    values[f"{stage}_seconds"] = run["stages"][stage]["seconds"]
+            return {k: v for k, v in values.items() if v is not None}
+        
+        before = {run["device"]: metrics(run) for run in baseline.get("runs", [])}
+        rows = []
+        for run in report.get("runs", []):
+            old = before.get(run["device"])
+            if old is None:
+                continue
+            for name, value in metrics(run).items():
+                if name in old:
+                    rows.append((f"{run['device']} {name}", old[name], value))
+        return rows
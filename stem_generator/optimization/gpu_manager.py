@@ -164,19 +164,67 @@ class GPUManager:
             device_id: CUDA device index
             
         Returns:
-            Dictionary with allocated, reserved, and total memory in GB
+            Dictionary with allocated, reserved, free, and total memory in GB.
+            `allocated`/`reserved` are this process's allocator; `free` is
+            device-wide, so it also reflects other processes on the GPU.
         """
         if not self.is_cuda_available:
-            return {"allocated": 0, "reserved": 0, "total": 0}
+            return {"allocated": 0, "reserved": 0, "free": 0, "total": 0}
         
         try:
+            free, total = self._torch.cuda.mem_get_info(device_id)
             return {
                 "allocated": self._torch.cuda.memory_allocated(device_id) / (1024 ** 3),
                 "reserved": self._torch.cuda.memory_reserved(device_id) / (1024 ** 3),
-                "total": self._torch.cuda.get_device_properties(device_id).total_memory / (1024 ** 3)
+                "free": free / (1024 ** 3),
+                "total": total / (1024 ** 3)
             }
         except Exception:
-            return {"allocated": 0, "reserved": 0, "total": 0}
+            return {"allocated": 0, "reserved": 0, "free": 0, "total": 0}
+    
+    def get_free_memory(self, device_id: int = 0) -> float:
+        """
+        Get free VRAM on a device in GB.
+        
+        Memory cached by this process's allocator counts as free, since
+        our own jobs can reuse it without another cudaMalloc.
+        """
+        usage = self.get_memory_usage(device_id)
+        return usage["free"] + usage["reserved"] - usage["allocated"]
+    
+    def reset_peak_memory(self, device_id: int = 0) -> None:
+        """Start a new peak-memory measurement window on a device."""
+        if self.is_cuda_available:
+            self._torch.cuda.reset_peak_memory_stats(device_id)
+    
+    def get_peak_memory(self, device_id: int = 0) -> float:
+        """
+        Get this process's peak allocated VRAM in GB since the last reset.
+        
+        Args:
+            device_id: CUDA device index
+        """
+        if not self.is_cuda_available:
+            return 0.0
+        return self._torch.cuda.max_memory_allocated(device_id) / (1024 ** 3)
+    
+    def get_utilization(self, device_id: int = 0) -> Optional[float]:
+        """
+        Get how busy a GPU is (0.0-1.0) over the last sample period.
+        
+        Device-wide, so it includes other processes. Needs NVML (pynvml);
+        returns None where that isn't available.
+        """
+        if not self.is_cuda_available:
+            return None
+        try:
+            return self._torch.cuda.utilization(device_id) / 100.0
+        except Exception:
+            return None
+    
+    def list_devices(self) -> list[str]:
+        """Get torch device strings for every CUDA device ('cuda:0', ...)."""
+        return [f"cuda:{i}" for i in range(self.device_count)]
     
     def clear_cache(self) -> None:
         """Clear CUDA memory cache."""
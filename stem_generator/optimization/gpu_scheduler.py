@@ -0,0 +1,242 @@
+"""
+Multi-GPU Scheduler
+
+Spreads separation jobs across one model replica per GPU, placing work
+by free VRAM and letting idle devices steal queued jobs.
+"""
+
+import logging
+import threading
+import time
+from collections import deque
+from concurrent.futures import Future
+from dataclasses import dataclass, field
+from typing import Any, Callable, Generic, Optional, TypeVar
+
+from .gpu_manager import GPUManager
+
+
+logger = logging.getLogger(__name__)
+
+R = TypeVar("R")  # Replica type (usually StemPipeline)
+
+
+@dataclass
+class _ScheduledJob:
+    """A queued unit of work and the future for its result."""
+    fn: Callable[..., Any]
+    args: tuple
+    kwargs: dict
+    future: Future = field(default_factory=Future)
+    submitted_at: float = field(default_factory=time.time)
+
+
+@dataclass
+class DeviceStats:
+    """Per-device scheduling counters."""
+    device: Optional[str]
+    active: int = 0
+    completed: int = 0
+    stolen: int = 0
+    busy_seconds: float = 0.0
+
+
+class MultiGPUScheduler(Generic[R]):
+    """
+    Device-aware job scheduler with one model replica per GPU.
+    
+    Each device owns a deque of jobs and a worker thread that runs them
+    on that device's replica:
+        - Placement: a new job goes to the device with the most free VRAM
+          (from GPUManager.get_free_memory) per job already waiting or
+          running there, so cards shared with other processes get less
+        - Work stealing: a worker whose deque is empty takes the newest
+          job from the longest other deque, so one long track never
+          leaves the rest of its queue stuck behind it
+    
+    Workers pop their own deque from the front (FIFO) and steal from the
+    back, which keeps submission order on each device while idle cards
+    pick up the work most recently placed elsewhere.
+    """
+    
+    # Free VRAM is sampled at most this often per device (seconds)
+    MEMORY_POLL_INTERVAL = 1.0
+    
+    def __init__(
+        self,
+        replica_factory: Callable[[Optional[str]], R],
+        devices: Optional[list[Optional[str]]] = None,
+        gpu_manager: Optional[GPUManager] = None,
+        warm_up: Optional[Callable[[R], None]] = None
+    ):
+        """
+        Initialize the scheduler.
+        
+        Args:
+            replica_factory: Builds the replica for a device string
+                ('cuda:0', ... or None for the default device)
+            devices: Devices to use (defaults to every CUDA device, or a
+                single default device when there is no GPU)
+            gpu_manager: GPUManager for VRAM queries
+            warm_up: Called on each replica in its worker thread before
+                the first job (e.g. to load the model)
+        """
+        self.gpu = gpu_manager or GPUManager()
+        self.devices = devices or self.gpu.list_devices() or [None]
+        self.replicas: list[R] = [replica_factory(device) for device in self.devices]
+        self._warm_up = warm_up
+        
+        self._queues: list[deque[_ScheduledJob]] = [deque() for _ in self.devices]
+        self._stats = [DeviceStats(device) for device in self.devices]
+        self._cond = threading.Condition()
+        self._workers: list[threading.Thread] = []
+        self._stopping = False
+        
+        self._free_gb: list[float] = [0.0] * len(self.devices)
+        self._free_sampled_at: list[float] = [0.0] * len(self.devices)
+    
+    @staticmethod
+    def _device_index(device: Optional[str]) -> Optional[int]:
+        """CUDA ordinal of a device string, or None for non-CUDA devices."""
+        if device is None or not device.startswith("cuda"):
+            return None
+        _, _, ordinal = device.partition(":")
+        return int(ordinal) if ordinal else 0
+    
+    def _free_memory(self, i: int) -> float:
+        """Free VRAM (GB) on device i, sampled at most once per interval."""
+        now = time.time()
+        if now - self._free_sampled_at[i] >= self.MEMORY_POLL_INTERVAL:
+            ordinal = self._device_index(self.devices[i])
+            self._free_gb[i] = self.gpu.get_free_memory(ordinal) if ordinal is not None else 0.0
+            self._free_sampled_at[i] = now
+        return self._free_gb[i]
+    
+    def _pick_device(self) -> int:
+        """Choose the device a new job is placed on (lock held)."""
+        def score(i: int) -> tuple[float, int]:
+            load = len(self._queues[i]) + self._stats[i].active
+            # Free VRAM per pending job; without VRAM figures (CPU) this
+            # degrades to shortest-queue-first
+            return (self._free_memory(i) / (1 + load), -load)
+        
+        return max(range(len(self.devices)), key=score)
+    
+    def submit(self, fn: Callable[..., Any], *args, **kwargs) -> Future:
+        """
+        Schedule fn(replica, *args, **kwargs) on some device.
+        
+        Returns:
+            Future resolving to fn's return value
+        """
+        job = _ScheduledJob(fn, args, kwargs)
+        with self._cond:
+            if self._stopping:
+                raise RuntimeError("Scheduler is shut down")
+            i = self._pick_device()
+            self._queues[i].append(job)
+            self._cond.notify_all()
+        return job.future
+    
+    def _next_job(self, i: int) -> Optional[_ScheduledJob]:
+        """Get the next job for worker i, stealing if its deque is empty (lock held)."""
+        if self._queues[i]:
+            return self._queues[i].popleft()
+        
+        victim = max(range(len(self._queues)), key=lambda j: len(self._queues[j]))
+        if self._queues[victim]:
+            self._stats[i].stolen += 1
+            return self._queues[victim].pop()
+        return None
+    
+    def _worker(self, i: int) -> None:
+        """Run jobs on replica i until shutdown."""
+        replica = self.replicas[i]
+        stats = self._stats[i]
+        
+        if self._warm_up is not None:
+            try:
+                self._warm_up(replica)
+            except Exception as e:
+                logger.warning(f"Warm-up failed on {self.devices[i] or 'default device'}: {e}")
+        
+        while True:
+            with self._cond:
+                job = self._next_job(i)
+                while job is None and not self._stopping:
+                    self._cond.wait()
+                    job = self._next_job(i)
+                if job is None:
+                    return
+                stats.active += 1
+            
+            start = time.time()
+            if job.future.set_running_or_notify_cancel():
+                try:
+                    job.future.set_result(job.fn(replica, *job.args, **job.kwargs))
+                except BaseException as e:
+                    job.future.set_exception(e)
+            
+            with self._cond:
+                stats.active -= 1
+                stats.completed += 1
+                stats.busy_seconds += time.time() - start
+    
+    def start(self) -> None:
+        """Start one worker thread per device."""
+        for i, device in enumerate(self.devices):
+            worker = threading.Thread(
+                target=self._worker, args=(i,),
+                name=f"gpu-worker-{device or 'default'}", daemon=True
+            )
+            worker.start()
+            self._workers.append(worker)
+    
+    def shutdown(self, wait: bool = True) -> None:
+        """
+        Stop the workers once every queued job has run.
+        
+        Args:
+            wait: Block until the workers have exited
+        """
+        with self._cond:
+            self._stopping = True
+            self._cond.notify_all()
+        if wait:
+            for worker in self._workers:
+                worker.join()
+    
+    def __enter__(self) -> "MultiGPUScheduler[R]":
+        self.start()
+        return self
+    
+    def __exit__(self, exc_type, exc, tb) -> None:
+        self.shutdown()
+    
+    @property
+    def queued(self) -> int:
+        """Number of jobs waiting on any device."""
+        with self._cond:
+            return sum(len(q) for q in self._queues)
+    
+    @property
+    def active(self) -> int:
+        """Number of jobs currently running."""
+        with self._cond:
+            return sum(s.active for s in self._stats)
+    
+    def get_stats(self) -> list[dict[str, Any]]:
+        """Get per-device counters."""
+        with self._cond:
+            return [
+                {
+                    "device": s.device or "default",
+                    "queued": len(self._queues[i]),
+                    "active": s.active,
+                    "completed": s.completed,
+                    "stolen": s.stolen,
+                    "busy_seconds": s.busy_seconds,
+                    "free_vram_gb": self._free_gb[i],
+                }
+                for i, s in enumerate(self._stats)
+            ]
@@ -0,0 +1,472 @@
+"""
+Live Metrics
+
+Counters, gauges and histograms for batch runs and the separation
+server, exported in the Prometheus text format over HTTP.
+"""
+
+import bisect
+import logging
+import threading
+from dataclasses import dataclass, field
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from typing import TYPE_CHECKING, Any, Callable, Optional
+
+from .gpu_manager import GPUManager
+from .profiler import StageProfiler
+
+if TYPE_CHECKING:
+    from ..core.engines.base_engine import SeparationResult
+    from ..core.stem_pipeline import StemPipeline
+    from .gpu_scheduler import MultiGPUScheduler
+    from .stem_cache import StemCache
+
+
+logger = logging.getLogger(__name__)
+
+# Default endpoint; scrape http://<host>:9477/metrics
+DEFAULT_METRICS_PORT = 9477
+
+# Prometheus text exposition format
+CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8"
+
+# Pipeline stages take milliseconds (DB, hash) to minutes (inference on CPU)
+STAGE_BUCKETS = (0.001, 0.005, 0.01, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0, 300.0)
+
+# Whole tracks, GPU seconds to cloud tens of minutes
+TRACK_BUCKETS = (1.0, 5.0, 10.0, 30.0, 60.0, 120.0, 300.0, 600.0, 1200.0, 3600.0)
+
+Labels = tuple[tuple[str, str], ...]
+
+
+def _escape(value: str) -> str:
+    return value.replace("\\", "\\\\").replace("\n", "\\n").replace('"', '\\"')
+
+
+def _format_labels(labels: Labels) -> str:
+    if not labels:
+        return ""
+    return "{" + ",".join(f'{k}="{_escape(v)}"' for k, v in labels) + "}"
+
+
+def _format_value(value: float) -> str:
+    if value == float("inf"):
+        return "+Inf"
+    return repr(float(value)) if not float(value).is_integer() else str(int(value))
+
+
+@dataclass
+class MetricFamily:
+    """One metric and its samples at scrape time."""
+    name: str
+    type: str  # "counter", "gauge" or "histogram"
+    help: str
+    # (sample name suffix, labels, value)
+    samples: list[tuple[str, Labels, float]] = field(default_factory=list)
+    
+    def add(self, value: float, suffix: str = "", **labels: str) -> "MetricFamily":
+        """Append a sample (labels are sorted for stable output)."""
+        self.samples.append((suffix, tuple(sorted((k, str(v)) for k, v in labels.items())), value))
+        return self
+    
+    def render(self) -> str:
+        lines = [f"# HELP {self.name} {self.help}", f"# TYPE {self.name} {self.type}"]
+        for suffix, labels, value in self.samples:
+            lines.append(f"{self.name}{suffix}{_format_labels(labels)} {_format_value(value)}")
+        return "\n".join(lines)
+
+
+class _Metric:
+    """Labelled values behind one lock."""
+    
+    type = ""
+    
+    def __init__(self, name: str, help: str):
+        self.name = name
+        self.help = help
+        self._lock = threading.Lock()
+    
+    @staticmethod
+    def _key(labels: dict[str, Any]) -> Labels:
+        return tuple(sorted((k, str(v)) for k, v in labels.items()))
+    
+    def collect(self) -> MetricFamily:
+        raise NotImplementedError
+
+
+class Counter(_Metric):
+    """Monotonically increasing count."""
+    
+    type = "counter"
+    
+    def __init__(self, name: str, help: str):
+        super().__init__(name, help)
+        self._values: dict[Labels, float] = {}
+    
+    def inc(self, amount: float = 1.0, **labels: Any) -> None:
+        """Add to the counter for a label set."""
+        key = self._key(labels)
+        with self._lock:
+            self._values[key] = self._values.get(key, 0.0) + amount
+    
+    def collect(self) -> MetricFamily:
+        with self._lock:
+            items = list(self._values.items())
+        family = MetricFamily(self.name, self.type, self.help)
+        family.samples = [("", key, value) for key, value in items]
+        return family
+
+
+class Gauge(_Metric):
+    """Value that goes up and down."""
+    
+    type = "gauge"
+    
+    def __init__(self, name: str, help: str):
+        super().__init__(name, help)
+        self._values: dict[Labels, float] = {}
+    
+    def set(self, value: float, **labels: Any) -> None:
+        """Set the gauge for a label set."""
+        with self._lock:
+            self._values[self._key(labels)] = value
+    
+    def collect(self) -> MetricFamily:
+        with self._lock:
+            items = list(self._values.items())
+        family = MetricFamily(self.name, self.type, self.help)
+        family.samples = [("", key, value) for key, value in items]
+        return family
+
+
+class Histogram(_Metric):
+    """Distribution of observations in fixed buckets."""
+    
+    type = "histogram"
+    
+    def __init__(self, name: str, help: str, buckets: tuple[float, ...]):
+        super().__init__(name, help)
+        self.buckets = tuple(sorted(buckets))
+        # labels -> (per-bucket counts incl. +Inf, sum)
+        self._values: dict[Labels, tuple[list[int], float]] = {}
+    
+    def observe(self, value: float, **labels: Any) -> None:
+        """Record one observation for a label set."""
+        key = self._key(labels)
+        index = bisect.bisect_left(self.buckets, value)
+        with self._lock:
+            counts, total = self._values.get(key) or ([0] * (len(self.buckets) + 1), 0.0)
+            counts[index] += 1
+            self._values[key] = (counts, total + value)
+    
+    def collect(self) -> MetricFamily:
+        with self._lock:
+            items = [(key, list(counts), total) for key, (counts, total) in self._values.items()]
+        family = MetricFamily(self.name, self.type, self.help)
+        for key, counts, total in items:
+            cumulative = 0
+            for bound, count in zip(self.buckets + (float("inf"),), counts):
+                cumulative += count
+                family.samples.append(("_bucket", key + (("le", _format_value(bound)),), cumulative))
+            family.samples.append(("_sum", key, total))
+            family.samples.append(("_count", key, cumulative))
+        return family
+
+
+Collector = Callable[[], list[MetricFamily]]
+
+
+class MetricsRegistry:
+    """
+    Metrics of one process.
+    
+    Holds directly updated metrics plus collectors, callbacks that read
+    live state (queue depth, GPU utilization, cache totals) only when
+    scraped so nothing polls between scrapes. A failing collector is
+    logged and skipped rather than breaking the scrape.
+    """
+    
+    def __init__(self):
+        """Initialize an empty registry."""
+        self._lock = threading.Lock()
+        self._metrics: dict[str, _Metric] = {}
+        self._collectors: list[Collector] = []
+    
+    def _get_or_create(self, cls, name: str, *args) -> Any:
+        with self._lock:
+            metric = self._metrics.get(name)
+            if metric is None:
+                metric = self._metrics[name] = cls(name, *args)
+            elif not isinstance(metric, cls):
+                raise ValueError(f"Metric {name} already registered as {metric.type}")
+            return metric
+    
+    def counter(self, name: str, help: str) -> Counter:
+        """Get or create a counter."""
+        return self._get_or_create(Counter, name, help)
+    
+    def gauge(self, name: str, help: str) -> Gauge:
+        """Get or create a gauge."""
+        return self._get_or_create(Gauge, name, help)
+    
+    def histogram(self, name: str, help: str, buckets: tuple[float, ...]) -> Histogram:
+        """Get or create a histogram."""
+        return self._get_or_create(Histogram, name, help, buckets)
+    
+    def add_collector(self, collector: Collector) -> None:
+        """Register a callback producing metric families at scrape time."""
+        with self._lock:
+            self._collectors.append(collector)
+    
+    def render(self) -> str:
+        """Render every metric in the Prometheus text format."""
+        with self._lock:
+            metrics = list(self._metrics.values())
+            collectors = list(self._collectors)
+        
+        families = [metric.collect() for metric in metrics]
+        for collector in collectors:
+            try:
+                families.extend(collector())
+            except Exception as e:
+                logger.warning(f"Metrics collector failed: {e}")
+        
+        return "\n".join(f.render() for f in families if f.samples) + "\n"
+
+
+class MetricsServer:
+    """Serves a registry at /metrics from a background thread."""
+    
+    def __init__(
+        self,
+        registry: MetricsRegistry,
+        host: str = "127.0.0.1",
+        port: int = DEFAULT_METRICS_PORT
+    ):
+        """
+        Initialize the server.
+        
+        Args:
+            registry: Metrics to export
+            host: Interface to bind ("0.0.0.0" for a remote Prometheus)
+            port: TCP port (0 picks a free one)
+        """
+        self.registry = registry
+        
+        class Handler(BaseHTTPRequestHandler):
+            def do_GET(handler):
+                if handler.path.split("?")[0] not in ("/metrics", "/"):
+                    handler.send_error(404)
+                    return
+                body = registry.render().encode()
+                handler.send_response(200)
+                handler.send_header("Content-Type", CONTENT_TYPE)
+                handler.send_header("Content-Length", str(len(body)))
+                handler.end_headers()
+                handler.wfile.write(body)
+            
+            def log_message(handler, format, *args):
+                logger.debug(format % args)
+        
+        self._httpd = ThreadingHTTPServer((host, port), Handler)
+        self._httpd.daemon_threads = True
+        self._thread: Optional[threading.Thread] = None
+    
+    @property
+    def address(self) -> tuple[str, int]:
+        """(host, port) actually bound."""
+        return self._httpd.server_address[:2]
+    
+    def start(self) -> "MetricsServer":
+        """Start serving in a daemon thread."""
+        self._thread = threading.Thread(
+            target=self._httpd.serve_forever, name="metrics-http", daemon=True
+        )
+        self._thread.start()
+        logger.info(f"Metrics at http://{self.address[0]}:{self.address[1]}/metrics")
+        return self
+    
+    def stop(self) -> None:
+        """Stop serving."""
+        self._httpd.shutdown()
+        self._httpd.server_close()
+
+
+class MetricsProfiler(StageProfiler):
+    """StageProfiler that also feeds every stage call into a histogram."""
+    
+    def __init__(self, histogram: Histogram):
+        super().__init__()
+        self.histogram = histogram
+    
+    def add(self, stage: str, seconds: float) -> None:
+        super().add(stage, seconds)
+        self.histogram.observe(seconds, stage=stage)
+
+
+class PipelineMetrics:
+    """
+    The standard metric set for stem generation.
+    
+    Exported series (all prefixed stem_):
+        - stage_duration_seconds{stage}: per-call stage latency (decode,
+          resample, inference, write, hash, qa, db), from profiler hooks
+        - tracks_total{engine,status} / track_duration_seconds{engine}
+        - jobs{status}: jobs table by status (batch runs)
+        - queue_depth{device} / active_jobs{device} / device_jobs_completed_total{device}
+          per scheduler device (server and multi-GPU runs)
+        - cloud_jobs_in_flight / cloud_jobs_queued: LALAL.AI jobs
+        - cache_hits_total / cache_misses_total / cache_hit_ratio: StemCache
+        - gpu_utilization_ratio{gpu} / gpu_memory_bytes{gpu,kind}
+    
+    Example:
+        metrics = PipelineMetrics()
+        metrics.watch_pipeline(pipeline)
+        metrics.serve(port=9477)
+        with profiling(metrics.profiler):
+            ...
+            metrics.observe_result(result)
+    """
+    
+    def __init__(self, registry: Optional[MetricsRegistry] = None, gpu: Optional[GPUManager] = None):
+        """
+        Initialize the metric set.
+        
+        Args:
+            registry: Registry to register into (a new one by default)
+            gpu: GPU manager for device metrics (created if not provided)
+        """
+        self.registry = registry or MetricsRegistry()
+        self.gpu = gpu or GPUManager()
+        
+        self.stage_seconds = self.registry.histogram(
+            "stem_stage_duration_seconds", "Time per pipeline stage call", STAGE_BUCKETS
+        )
+        self.tracks = self.registry.counter(
+            "stem_tracks_total", "Tracks finished, by engine and outcome"
+        )
+        self.track_seconds = self.registry.histogram(
+            "stem_track_duration_seconds", "Separation time per track", TRACK_BUCKETS
+        )
+        self.profiler = MetricsProfiler(self.stage_seconds)
+        
+        self._lock = threading.Lock()
+        self._pipelines: list["StemPipeline"] = []
+        self._schedulers: list["MultiGPUScheduler"] = []
+        self.registry.add_collector(self._collect_gpus)
+        self.registry.add_collector(self._collect_pipelines)
+        self.registry.add_collector(self._collect_schedulers)
+    
+    def observe_result(self, result: "SeparationResult") -> None:
+        """Count a finished track."""
+        if result.success and result.engine_name == "cached":
+            status = "skipped"
+        else:
+            status = "completed" if result.success else "failed"
+        self.tracks.inc(engine=result.engine_name, status=status)
+        if status == "completed" and result.processing_time_seconds > 0:
+            self.track_seconds.observe(result.processing_time_seconds, engine=result.engine_name)
+    
+    def watch_pipeline(self, pipeline: "StemPipeline") -> None:
+        """Export a pipeline's job table and cloud jobs."""
+        with self._lock:
+            if pipeline not in self._pipelines:
+                self._pipelines.append(pipeline)
+    
+    def unwatch_pipeline(self, pipeline: "StemPipeline") -> None:
+        """Stop exporting a pipeline."""
+        with self._lock:
+            if pipeline in self._pipelines:
+                self._pipelines.remove(pipeline)
+    
+    def watch_scheduler(self, scheduler: "MultiGPUScheduler") -> None:
+        """Export per-device queue depth and activity of a scheduler (and its replicas)."""
+        with self._lock:
+            self._schedulers.append(scheduler)
+        for replica in scheduler.replicas:
+            self.watch_pipeline(replica)
+    
+    def unwatch_scheduler(self, scheduler: "MultiGPUScheduler") -> None:
+        """Stop exporting a scheduler once it is shut down."""
+        with self._lock:
+            if scheduler in self._schedulers:
+                self._schedulers.remove(scheduler)
+        for replica in scheduler.replicas:
+            self.unwatch_pipeline(replica)
+    
+    def watch_cache(self, cache: "StemCache") -> None:
+        """Export a StemCache's lookup totals."""
+        def collect() -> list[MetricFamily]:
+            stats = cache.get_cache_stats()
+            return [
+                MetricFamily("stem_cache_hits_total", "counter", "Stem cache hits").add(stats["hits"]),
+                MetricFamily("stem_cache_misses_total", "counter", "Stem cache misses").add(stats["misses"]),
+                MetricFamily("stem_cache_hit_ratio", "gauge", "Stem cache hits per lookup").add(stats["hit_rate"]),
+            ]
+        
+        self.registry.add_collector(collect)
+    
+    def _collect_schedulers(self) -> list[MetricFamily]:
+        depth = MetricFamily("stem_queue_depth", "gauge", "Jobs waiting per device")
+        active = MetricFamily("stem_active_jobs", "gauge", "Jobs running per device")
+        done = MetricFamily(
+            "stem_device_jobs_completed_total", "counter", "Jobs finished per device"
+        )
+        busy = MetricFamily(
+            "stem_device_busy_seconds_total", "counter", "Time spent running jobs per device"
+        )
+        with self._lock:
+            schedulers = list(self._schedulers)
+        for scheduler in schedulers:
+            for stats in scheduler.get_stats():
+                device = stats["device"]
+                depth.add(stats["queued"], device=device)
+                active.add(stats["active"], device=device)
+                done.add(stats["completed"], device=device)
+                busy.add(stats["busy_seconds"], device=device)
+        return [depth, active, done, busy]
+    
+    def _collect_pipelines(self) -> list[MetricFamily]:
+        jobs = MetricFamily("stem_jobs", "gauge", "Jobs in the database by status")
+        in_flight = MetricFamily("stem_cloud_jobs_in_flight", "gauge", "LALAL.AI jobs running")
+        queued = MetricFamily("stem_cloud_jobs_queued", "gauge", "LALAL.AI jobs waiting for a slot")
+        
+        with self._lock:
+            pipelines = list(self._pipelines)
+        
+        running = waiting = 0
+        databases = set()
+        for pipeline in pipelines:
+            # Replicas share one database; count its jobs once
+            if pipeline.db.db_path not in databases:
+                databases.add(pipeline.db.db_path)
+                for status, count in pipeline.db.get_job_counts().items():
+                    jobs.add(count, status=status)
+            # Only engines already in use; don't create one for a scrape
+            lalal = pipeline._lalal_engine
+            if lalal is not None:
+                running += lalal.jobs_running
+                waiting += lalal.jobs_submitted - lalal.jobs_running
+        
+        if pipelines:
+            in_flight.add(running)
+            queued.add(waiting)
+        return [jobs, in_flight, queued]
+    
+    def _collect_gpus(self) -> list[MetricFamily]:
+        utilization = MetricFamily(
+            "stem_gpu_utilization_ratio", "gauge", "Device-wide GPU busy fraction (NVML)"
+        )
+        memory = MetricFamily("stem_gpu_memory_bytes", "gauge", "GPU memory by kind")
+        for i in range(self.gpu.device_count):
+            gpu = f"cuda:{i}"
+            busy = self.gpu.get_utilization(i)
+            if busy is not None:
+                utilization.add(busy, gpu=gpu)
+            for kind, gb in self.gpu.get_memory_usage(i).items():
+                memory.add(gb * 1024 ** 3, gpu=gpu, kind=kind)
+        return [utilization, memory]
+    
+    def serve(self, host: str = "127.0.0.1", port: int = DEFAULT_METRICS_PORT) -> MetricsServer:
+        """Start the /metrics endpoint."""
+        return MetricsServer(self.registry, host, port).start()
@@ -0,0 +1,225 @@
+"""
+Inference Precision Validator
+
+Checks reduced-precision Demucs modes (fp16/bf16 autocast, int8) against
+fp32 on a reference set and records which modes are safe to use.
+"""
+
+import json
+import logging
+import tempfile
+import time
+from dataclasses import asdict, dataclass, field
+from pathlib import Path
+from typing import Optional
+
+from ..core.engines.demucs_engine import DemucsEngine
+from ..core.quality_analyzer import StemQualityAnalyzer
+
+
+logger = logging.getLogger(__name__)
+
+REPORT_FILE = "precision_report.json"
+
+
+@dataclass
+class PrecisionCheck:
+    """Outcome of validating one precision mode against fp32."""
+    precision: str
+    passed: bool
+    # Worst SI-SDR against the fp32 stems, per stem, over the reference set
+    stem_si_sdr: dict[str, float] = field(default_factory=dict)
+    # fp32 separation time / this mode's separation time
+    speedup: Optional[float] = None
+    error: Optional[str] = None
+    
+    @property
+    def min_si_sdr(self) -> Optional[float]:
+        """Worst stem score, or None if nothing was scored."""
+        return min(self.stem_si_sdr.values()) if self.stem_si_sdr else None
+
+
+class PrecisionValidator:
+    """
+    Validates Demucs precision modes against fp32 output.
+    
+    Each reference track is separated once in fp32 and once per mode;
+    every stem of a mode is scored with StemQualityAnalyzer.compare_stems
+    using the fp32 stem as ground truth. A mode passes when every stem of
+    every reference track stays above `threshold_db`, i.e. the reduced
+    precision error is well below the separation error itself.
+    
+    Results are written to a report (precision_report.json in the stem
+    library by default) keyed by model and device type, which
+    StemPipeline consults before using a reduced-precision mode.
+    """
+    
+    # Minimum SI-SDR against fp32 for a mode to pass. Demucs' own
+    # separation quality is ~7-9 dB; agreement at 25 dB keeps the
+    # precision error ~20 dB below that.
+    DEFAULT_THRESHOLD_DB = 25.0
+    
+    def __init__(
+        self,
+        model_name: str = DemucsEngine.DEFAULT_MODEL,
+        device: Optional[str] = None,
+        threshold_db: float = DEFAULT_THRESHOLD_DB,
+        quality_analyzer: Optional[StemQualityAnalyzer] = None
+    ):
+        """
+        Initialize the validator.
+        
+        Args:
+            model_name: Demucs model to validate
+            device: PyTorch device (None for auto)
+            threshold_db: Minimum per-stem SI-SDR against fp32
+            quality_analyzer: Analyzer used for scoring
+        """
+        self.model_name = model_name
+        self.device = device
+        self.threshold_db = threshold_db
+        self.quality_analyzer = quality_analyzer or StemQualityAnalyzer()
+    
+    def _engine(self, precision: str) -> DemucsEngine:
+        return DemucsEngine(
+            model_name=self.model_name,
+            device=self.device,
+            precision=precision
+        )
+    
+    @staticmethod
+    def _separate_all(engine: DemucsEngine, files: list[Path], out_dir: Path) -> tuple[list[dict], float]:
+        """
+        Separate every reference file.
+        
+        Returns:
+            (stem paths per file, total separation seconds)
+        
+        Raises:
+            RuntimeError: If the mode can't run or a separation fails
+        """
+        # Model load (and quantization) is not part of the timing
+        engine._load_model()
+        
+        stems, elapsed = [], 0.0
+        for i, path in enumerate(files):
+            result = engine.separate(path, out_dir / str(i))
+            if not result.success:
+                raise RuntimeError(f"{path.name}: {result.error_message}")
+            result.wait_for_flush()
+            stems.append(result.stem_paths)
+            elapsed += result.processing_time_seconds
+        return stems, elapsed
+    
+    def validate(
+        self,
+        reference_files: list[Path],
+        precisions: tuple[str, ...] = ("fp16", "bf16", "int8"),
+        work_dir: Optional[Path] = None
+    ) -> dict[str, PrecisionCheck]:
+        """
+        Validate precision modes on a reference set.
+        
+        Modes the device can't run (fp16 on CPU, int8 on GPU) are
+        reported as failed with their error.
+        
+        Args:
+            reference_files: Short, representative tracks
+            precisions: Modes to check against fp32
+            work_dir: Where stems are written (temporary by default)
+        
+        Returns:
+            precision -> PrecisionCheck
+        """
+        reference_files = [Path(f) for f in reference_files]
+        if not reference_files:
+            raise ValueError("No reference files given")
+        
+        with tempfile.TemporaryDirectory(prefix="precision-") as tmp:
+            root = Path(work_dir) if work_dir else Path(tmp)
+            
+            reference_stems, reference_time = self._separate_all(
+                self._engine("fp32"), reference_files, root / "fp32"
+            )
+            
+            checks = {}
+            for precision in precisions:
+                if precision == "fp32":
+                    continue
+                start = time.time()
+                try:
+                    stems, elapsed = self._separate_all(
+                        self._engine(precision), reference_files, root / precision
+                    )
+                except Exception as e:
+                    checks[precision] = PrecisionCheck(precision, passed=False, error=str(e))
+                    logger.info(f"{precision}: cannot run ({e})")
+                    continue
+                
+                worst: dict[str, float] = {}
+                for reference, estimate in zip(reference_stems, stems):
+                    scores = self.quality_analyzer.compare_stems(reference, estimate)
+                    for stem_name, score in scores.items():
+                        worst[stem_name] = min(score, worst.get(stem_name, float('inf')))
+                
+                passed = bool(worst) and all(v >= self.threshold_db for v in worst.values())
+                checks[precision] = PrecisionCheck(
+                    precision,
+                    passed=passed,
+                    stem_si_sdr=worst,
+                    speedup=reference_time / elapsed if elapsed > 0 else None
+                )
+                logger.info(
+                    f"{precision}: {'pass' if passed else 'FAIL'} "
+                    f"(min {checks[precision].min_si_sdr} dB vs fp32, "
+                    f"{time.time() - start:.1f}s)"
+                )
+        
+        return checks
+    
+    def _report_key(self) -> str:
+        device = self._engine("fp32").device
+        return self.report_key(self.model_name, device)
+    
+    @staticmethod
+    def report_key(model_name: str, device: str) -> str:
+        """Report entry for a model on a device type ('cuda:1' -> 'cuda')."""
+        return f"{model_name}:{device.split(':')[0]}"
+    
+    def save_report(self, checks: dict[str, PrecisionCheck], path: Path) -> None:
+        """Merge results into a report file."""
+        path = Path(path)
+        report = self.load_report(path)
+        report[self._report_key()] = {
+            "threshold_db": self.threshold_db,
+            "validated_at": time.time(),
+            "modes": {name: asdict(check) for name, check in checks.items()},
+        }
+        path.parent.mkdir(parents=True, exist_ok=True)
+        tmp = path.with_name(f".{path.name}.tmp")
+        tmp.write_text(json.dumps(report, indent=2))
+        tmp.replace(path)
+    
+    @staticmethod
+    def load_report(path: Path) -> dict:
+        """Load a report file ({} if missing or unreadable)."""
+        try:
+            return json.loads(Path(path).read_text())
+        except (OSError, ValueError):
+            return {}
+    
+    @classmethod
+    def is_approved(cls, report: dict, model_name: str, device: str, precision: str) -> Optional[bool]:
+        """
+        Look a mode up in a report.
+        
+        Returns:
+            True/False if the mode was validated for this model and
+            device type, None if it never was (fp32 is always True)
+        """
+        if precision == "fp32":
+            return True
+        mode = report.get(cls.report_key(model_name, device), {}).get("modes", {}).get(precision)
+        if mode is None:
+            return None
+        return bool(mode.get("passed"))
@@ -0,0 +1,156 @@
+"""
+Stage Profiler
+
+Process-wide wall-time accounting for the stages of stem generation
+(decode, resample, inference, write, hash, QA, DB).
+"""
+
+import threading
+import time
+from contextlib import contextmanager, nullcontext
+from dataclasses import dataclass
+from typing import Iterable, Iterator, Optional, TypeVar
+
+
+T = TypeVar("T")
+
+# Stages instrumented across the pipeline, in pipeline order
+STAGES = ("decode", "resample", "inference", "write", "hash", "qa", "db")
+
+
+@dataclass
+class StageTiming:
+    """Accumulated time in one stage."""
+    calls: int = 0
+    seconds: float = 0.0
+
+
+class StageProfiler:
+    """
+    Accumulates time spent per pipeline stage.
+    
+    Stages are timed where they run, including background threads (stem
+    flushes, decode-ahead), so a stage's seconds are summed over threads
+    and stage totals can exceed wall time when work overlaps.
+    
+    Instrumented code calls the module-level profile_stage() /
+    profile_iter(), which do nothing unless a profiler is active (see
+    profiling()), so the hooks cost one global lookup in normal runs.
+    
+    Example:
+        profiler = StageProfiler()
+        with profiling(profiler):
+            pipeline.separate(path)
+        print(profiler.snapshot())
+    """
+    
+    def __init__(self):
+        """Initialize an empty profiler."""
+        self._lock = threading.Lock()
+        self._stages: dict[str, StageTiming] = {}
+    
+    def add(self, stage: str, seconds: float) -> None:
+        """Record one timed call of a stage."""
+        with self._lock:
+            timing = self._stages.setdefault(stage, StageTiming())
+            timing.calls += 1
+            timing.seconds += seconds
+    
+    @contextmanager
+    def stage(self, stage: str) -> Iterator[None]:
+        """Time the enclosed block as one call of a stage."""
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.add(stage, time.perf_counter() - start)
+    
+    def snapshot(self) -> dict[str, StageTiming]:
+        """Copy of the totals so far, in STAGES order then any others."""
+        with self._lock:
+            names = [s for s in STAGES if s in self._stages]
+            names += sorted(set(self._stages) - set(STAGES))
+            return {
+                name: StageTiming(self._stages[name].calls, self._stages[name].seconds)
+                for name in names
+            }
+    
+    def reset(self) -> None:
+        """Clear all totals."""
+        with self._lock:
+            self._stages.clear()
+
+
+# The active profiler; a plain global rather than a context variable so
+# executor threads report into it too
+_active: Optional[StageProfiler] = None
+
+_NULL_CONTEXT = nullcontext()
+
+
+def is_profiling() -> bool:
+    """Whether a profiler is active (e.g. to sync the GPU before timing)."""
+    return _active is not None
+
+
+def profile_stage(stage: str):
+    """
+    Context manager timing a block as a stage of the active profiler.
+    
+    Args:
+        stage: Stage name (one of STAGES)
+    """
+    profiler = _active
+    if profiler is None:
+        return _NULL_CONTEXT
+    return profiler.stage(stage)
+
+
+def profile_iter(iterable: Iterable[T], stage: str) -> Iterable[T]:
+    """
+    Time each step of an iterator (e.g. block decoding) as a stage.
+    
+    Args:
+        iterable: Iterable whose __next__ does the work
+        stage: Stage name (one of STAGES)
+    
+    Returns:
+        The iterable itself when no profiler is active
+    """
+    profiler = _active
+    if profiler is None:
+        return iterable
+    
+    def timed() -> Iterator[T]:
+        iterator = iter(iterable)
+        while True:
+            start = time.perf_counter()
+            try:
+                item = next(iterator)
+            except StopIteration:
+                profiler.add(stage, time.perf_counter() - start)
+                return
+            profiler.add(stage, time.perf_counter() - start)
+            yield item
+    
+    return timed()
+
+
+@contextmanager
+def profiling(profiler: Optional[StageProfiler] = None) -> Iterator[StageProfiler]:
+    """
+    Make a profiler active for the enclosed block.
+    
+    Args:
+        profiler: Profiler to activate (a new one by default)
+    
+    Yields:
+        The active profiler
+    """
+    global _active
+    profiler = profiler or StageProfiler()
+    previous, _active = _active, profiler
+    try:
+        yield profiler
+    finally:
+        _active = previous
@@ -1,17 +1,28 @@
 """
 Stem Cache System
 
-MD5-based caching to prevent re-processing identical files.
+Content-addressed caching to prevent re-processing identical files.
 """
 
-import hashlib
 import json
-import os
-import shutil
+import logging
+import sqlite3
+import threading
+import time
+from contextlib import contextmanager
 from dataclasses import dataclass
 from datetime import datetime, timedelta
 from pathlib import Path
-from typing import Optional
+from typing import Generator, Literal, Optional
+
+from ..utils.content_hash import ContentHasher, get_default_hasher
+from ..utils.audio_io import find_stem_file, get_stem_format, write_stem
+from ..utils.file_linker import link_or_copy
+
+
+logger = logging.getLogger(__name__)
+
+EvictionPolicy = Literal["lru", "lfu"]
 
 
 @dataclass
@@ -26,59 +37,289 @@ class CacheEntry:
 
 class StemCache:
     """
-    MD5-based cache for stem separation results.
+    Content-addressed cache for stem separation results.
     
     Prevents re-processing identical audio files by caching
     results indexed by file hash + engine ID.
     
+    Stem files are stored once per unique content (SHA-256 of the stem)
+    and hardlinked or reflinked from the stem library where the
+    filesystem allows, so caching a result normally costs no extra
+    space. A SQLite index maps entries to objects and keeps running
+    totals, so statistics and eviction never walk the tree.
+    
     Cache Structure:
         cache_dir/
-            {md5_hash}_{engine_id}/
-                cache_meta.json
-                vocals.wav
-                drums.wav
-                bass.wav
-                other.wav
+            index.db
+            objects/
+                {sha[:2]}/{sha256}.wav (or .flac)
+    
+    When max_size_bytes is set, the least recently used ("lru") or least
+    frequently used ("lfu") entries are evicted after each put until the
+    unique object bytes fit.
     """
     
+    INDEX_FILE = "index.db"
+    OBJECTS_DIR = "objects"
+    
+    # Per-entry metadata of the directory-per-entry layout used before
+    # the content-addressed store; imported on first open
     META_FILE = "cache_meta.json"
     
-    def __init__(self, cache_dir: str = "data/cache"):
+    SCHEMA = """
+    CREATE TABLE IF NOT EXISTS entries (
+        cache_key TEXT PRIMARY KEY,
+        file_hash TEXT NOT NULL,
+        engine_id TEXT NOT NULL,
+        created_at TEXT NOT NULL,
+        last_access REAL NOT NULL,
+        access_count INTEGER NOT NULL DEFAULT 0,
+        quality_scores TEXT
+    );
+    
+    CREATE TABLE IF NOT EXISTS entry_stems (
+        cache_key TEXT NOT NULL REFERENCES entries(cache_key) ON DELETE CASCADE,
+        stem_name TEXT NOT NULL,
+        object_hash TEXT NOT NULL REFERENCES objects(object_hash),
+        PRIMARY KEY (cache_key, stem_name)
+    );
+    
+    CREATE TABLE IF NOT EXISTS objects (
+        object_hash TEXT PRIMARY KEY,
+        size_bytes INTEGER NOT NULL,
+        refcount INTEGER NOT NULL DEFAULT 0
+    );
+    
+    -- Single-row running totals so stats are O(1)
+    CREATE TABLE IF NOT EXISTS totals (
+        id INTEGER PRIMARY KEY CHECK (id = 1),
+        entries INTEGER NOT NULL DEFAULT 0,
+        objects INTEGER NOT NULL DEFAULT 0,
+        object_bytes INTEGER NOT NULL DEFAULT 0,
+        hits INTEGER NOT NULL DEFAULT 0,
+        misses INTEGER NOT NULL DEFAULT 0,
+        evictions INTEGER NOT NULL DEFAULT 0
+    );
+    INSERT OR IGNORE INTO totals (id) VALUES (1);
+    
+    CREATE INDEX IF NOT EXISTS idx_entries_lru ON entries(last_access);
+    CREATE INDEX IF NOT EXISTS idx_entries_lfu ON entries(access_count, last_access);
+    CREATE INDEX IF NOT EXISTS idx_entry_stems_object ON entry_stems(object_hash);
+    """
+    
+    def __init__(
+        self,
+        cache_dir: str = "data/cache",
+        hasher: Optional[ContentHasher] = None,
+        max_size_bytes: Optional[int] = None,
+        eviction_policy: EvictionPolicy = "lru"
+    ):
         """
         Initialize the cache system.
         
         Args:
             cache_dir: Directory for cached results
+            hasher: Shared ContentHasher (defaults to the process-wide one)
+            max_size_bytes: Size bound on unique stem bytes (None for unbounded)
+            eviction_policy: "lru" or "lfu"
         """
+        self.hasher = hasher or get_default_hasher()
         self.cache_dir = Path(cache_dir)
         self.cache_dir.mkdir(parents=True, exist_ok=True)
+        self.objects_dir = self.cache_dir / self.OBJECTS_DIR
+        self.objects_dir.mkdir(exist_ok=True)
+        self.index_path = self.cache_dir / self.INDEX_FILE
+        self.max_size_bytes = max_size_bytes
+        self.eviction_policy = eviction_policy
+        
+        # Serializes index updates with the object files they describe
+        self._lock = threading.RLock()
+        
+        with self._get_connection() as conn:
+            conn.executescript(self.SCHEMA)
+        self._report_legacy_entries()
+    
+    @contextmanager
+    def _get_connection(self) -> Generator[sqlite3.Connection, None, None]:
+        """Context manager for index connections (one transaction each)."""
+        conn = sqlite3.connect(self.index_path, timeout=30)
+        conn.row_factory = sqlite3.Row
+        conn.execute("PRAGMA journal_mode=WAL")
+        conn.execute("PRAGMA foreign_keys=ON")
+        try:
+            yield conn
+            conn.commit()
+        except sqlite3.Error:
+            conn.rollback()
+            raise
+        finally:
+            conn.close()
     
     def _compute_file_hash(self, file_path: Path) -> str:
         """
-        Compute MD5 hash of a file.
+        Compute the content hash of a file.
         
-        Uses the entire file for accurate caching.
+        Uses the entire file for accurate caching. Memoized per
+        (path, size, mtime), so exists() followed by get() or put()
+        hashes the file only once.
         
         Args:
             file_path: Path to file
-            
+        
         Returns:
-            MD5 hash string
+            SHA-256 hash string
         """
-        hasher = hashlib.md5()
-        with open(file_path, 'rb') as f:
-            # Read in chunks to handle large files
-            for chunk in iter(lambda: f.read(8192), b''):
-                hasher.update(chunk)
-        return hasher.hexdigest()
+        return self.hasher.content_hash(file_path)
     
     def _get_cache_key(self, file_hash: str, engine_id: str) -> str:
         """Generate cache key from hash and engine."""
         return f"{file_hash}_{engine_id}"
     
-    def _get_cache_path(self, cache_key: str) -> Path:
-        """Get the cache directory path for a key."""
-        return self.cache_dir / cache_key
+    def _object_path(self, object_hash: str, suffix: Optional[str] = None) -> Path:
+        """
+        Get the store path for a stem object.
+        
+        Objects keep their stem format's extension; without a suffix the
+        existing object file is looked up (equal hashes imply equal bytes,
+        so one hash never exists in two formats).
+        """
+        shard = self.objects_dir / object_hash[:2]
+        if suffix is None:
+            return find_stem_file(shard, object_hash) or shard / f"{object_hash}.wav"
+        return shard / f"{object_hash}{suffix}"
+    
+    # -------------------------------------------------------------------------
+    # Object store
+    # -------------------------------------------------------------------------
+    
+    def _store_object(self, conn: sqlite3.Connection, src: Path) -> str:
+        """
+        Add a stem file to the object store (deduplicated by content).
+        
+        Returns:
+            The object's hash
+        """
+        object_hash = self.hasher.content_hash(src)
+        exists = conn.execute(
+            "SELECT 1 FROM objects WHERE object_hash = ?", (object_hash,)
+        ).fetchone()
+        
+        obj_path = self._object_path(object_hash, src.suffix)
+        if exists and obj_path.exists():
+            return object_hash
+        
+        link_or_copy(src, obj_path)
+        if not exists:
+            size = obj_path.stat().st_size
+            conn.execute(
+                "INSERT INTO objects (object_hash, size_bytes, refcount) VALUES (?, ?, 0)",
+                (object_hash, size)
+            )
+            conn.execute(
+                "UPDATE totals SET objects = objects + 1, object_bytes = object_bytes + ?",
+                (size,)
+            )
+        return object_hash
+    
+    def _insert_entry(
+        self,
+        conn: sqlite3.Connection,
+        cache_key: str,
+        file_hash: str,
+        engine_id: str,
+        created_at: datetime,
+        last_access: float,
+        quality_scores: dict[str, float],
+        object_hashes: dict[str, str]
+    ) -> None:
+        """Index an entry and take a reference on each of its objects."""
+        conn.execute(
+            """
+            INSERT INTO entries
+                (cache_key, file_hash, engine_id, created_at, last_access,
+                 access_count, quality_scores)
+            VALUES (?, ?, ?, ?, ?, 0, ?)
+            """,
+            (cache_key, file_hash, engine_id, created_at.isoformat(), last_access,
+             json.dumps(quality_scores))
+        )
+        conn.execute("UPDATE totals SET entries = entries + 1")
+        for stem_name, object_hash in object_hashes.items():
+            conn.execute(
+                "INSERT INTO entry_stems (cache_key, stem_name, object_hash) VALUES (?, ?, ?)",
+                (cache_key, stem_name, object_hash)
+            )
+            conn.execute(
+                "UPDATE objects SET refcount = refcount + 1 WHERE object_hash = ?",
+                (object_hash,)
+            )
+    
+    def _release_entry(self, conn: sqlite3.Connection, cache_key: str) -> bool:
+        """Remove an entry and delete objects no other entry references."""
+        object_hashes = [
+            row['object_hash'] for row in conn.execute(
+                "SELECT object_hash FROM entry_stems WHERE cache_key = ?", (cache_key,)
+            )
+        ]
+        deleted = conn.execute(
+            "DELETE FROM entries WHERE cache_key = ?", (cache_key,)
+        ).rowcount
+        if not deleted:
+            return False
+        
+        conn.execute("DELETE FROM entry_stems WHERE cache_key = ?", (cache_key,))
+        conn.execute("UPDATE totals SET entries = entries - 1")
+        
+        for object_hash in object_hashes:
+            conn.execute(
+                "UPDATE objects SET refcount = refcount - 1 WHERE object_hash = ?",
+                (object_hash,)
+            )
+            row = conn.execute(
+                "SELECT size_bytes, refcount FROM objects WHERE object_hash = ?",
+                (object_hash,)
+            ).fetchone()
+            if row and row['refcount'] <= 0:
+                conn.execute("DELETE FROM objects WHERE object_hash = ?", (object_hash,))
+                conn.execute(
+                    "UPDATE totals SET objects = objects - 1, object_bytes = object_bytes - ?",
+                    (row['size_bytes'],)
+                )
+                # Only this name goes; library copies sharing the inode stay
+                self._object_path(object_hash).unlink(missing_ok=True)
+        return True
+    
+    def _evict(self, conn: sqlite3.Connection, keep: Optional[str] = None) -> int:
+        """Evict entries until the store fits max_size_bytes."""
+        if self.max_size_bytes is None:
+            return 0
+        
+        order = (
+            "access_count ASC, last_access ASC" if self.eviction_policy == "lfu"
+            else "last_access ASC"
+        )
+        evicted = 0
+        while True:
+            total = conn.execute("SELECT object_bytes FROM totals").fetchone()[0]
+            if total <= self.max_size_bytes:
+                break
+            row = conn.execute(
+                f"SELECT cache_key FROM entries WHERE cache_key != ? ORDER BY {order} LIMIT 1",
+                (keep or "",)
+            ).fetchone()
+            if row is None:
+                break
+            self._release_entry(conn, row['cache_key'])
+            evicted += 1
+        
+        if evicted:
+            conn.execute("UPDATE totals SET evictions = evictions + ?", (evicted,))
+            logger.info(f"Evicted {evicted} cache entries ({self.eviction_policy})")
+        return evicted
+    
+    # -------------------------------------------------------------------------
+    # Public API
+    # -------------------------------------------------------------------------
     
     def get(
         self,
@@ -91,59 +332,60 @@ class StemCache:
         Args:
             file_path: Path to original audio file
             engine_id: Engine used for separation
-            
+        
         Returns:
             CacheEntry if found, None otherwise
         """
         file_hash = self._compute_file_hash(file_path)
         cache_key = self._get_cache_key(file_hash, engine_id)
-        cache_path = self._get_cache_path(cache_key)
         
-        meta_path = cache_path / self.META_FILE
-        
-        if not meta_path.exists():
-            return None
-        
-        try:
-            with open(meta_path, 'r') as f:
-                meta = json.load(f)
+        with self._lock, self._get_connection() as conn:
+            row = conn.execute(
+                "SELECT * FROM entries WHERE cache_key = ?", (cache_key,)
+            ).fetchone()
+            if row is None:
+                conn.execute("UPDATE totals SET misses = misses + 1")
+                return None
             
-            # Verify stems exist and paths stay within cache directory
             stem_paths = {}
-            cache_path_resolved = cache_path.resolve()
-            
-            for stem_name, rel_path in meta.get('stem_paths', {}).items():
-                stem_path = (cache_path / rel_path).resolve()
-                
-                # SECURITY: Prevent path traversal attacks
-                if not str(stem_path).startswith(str(cache_path_resolved)):
-                    continue  # Skip malicious paths
-                
-                if stem_path.exists():
-                    stem_paths[stem_name] = str(stem_path)
+            for stem in conn.execute(
+                "SELECT stem_name, object_hash FROM entry_stems WHERE cache_key = ?",
+                (cache_key,)
+            ):
+                obj_path = self._object_path(stem['object_hash'])
+                if obj_path.exists():
+                    stem_paths[stem['stem_name']] = str(obj_path)
             
             if len(stem_paths) != 4:
                 # Cache is incomplete, remove it
-                self.invalidate(file_path, engine_id)
+                self._release_entry(conn, cache_key)
+                conn.execute("UPDATE totals SET misses = misses + 1")
                 return None
             
+            conn.execute(
+                "UPDATE entries SET last_access = ?, access_count = access_count + 1 "
+                "WHERE cache_key = ?",
+                (time.time(), cache_key)
+            )
+            conn.execute("UPDATE totals SET hits = hits + 1")
+            
             return CacheEntry(
-                file_hash=meta['file_hash'],
-                engine_id=meta['engine_id'],
-                created_at=datetime.fromisoformat(meta['created_at']),
+                file_hash=row['file_hash'],
+                engine_id=row['engine_id'],
+                created_at=datetime.fromisoformat(row['created_at']),
                 stem_paths=stem_paths,
-                quality_scores=meta.get('quality_scores', {})
+                quality_scores=json.loads(row['quality_scores'] or "{}")
             )
-            
-        except (json.JSONDecodeError, KeyError):
-            return None
     
     def put(
         self,
         file_path: Path,
         engine_id: str,
         stem_paths: dict[str, Path],
-        quality_scores: Optional[dict[str, float]] = None
+        quality_scores: Optional[dict[str, float]] = None,
+        stem_audio: Optional[dict] = None,
+        sample_rate: Optional[int] = None,
+        stem_format: Optional[str] = None
     ) -> CacheEntry:
         """
         Store a separation result in the cache.
@@ -153,47 +395,71 @@ class StemCache:
             engine_id: Engine used for separation
             stem_paths: Dictionary of stem names to paths
             quality_scores: Optional quality scores
-            
+            stem_audio: In-memory stems from SeparationResult.stem_audio;
+                used for any stem whose file in stem_paths doesn't exist
+                (otherwise the file is linked, which costs no space)
+            sample_rate: Sample rate of stem_audio
+            stem_format: Format stems from stem_audio are stored in
+        
         Returns:
             CacheEntry for the stored result
         """
         file_hash = self._compute_file_hash(file_path)
         cache_key = self._get_cache_key(file_hash, engine_id)
-        cache_path = self._get_cache_path(cache_key)
-        
-        # Create cache directory
-        cache_path.mkdir(parents=True, exist_ok=True)
-        
-        # Copy stems to cache
-        cached_stems = {}
-        for stem_name, src_path in stem_paths.items():
-            dst_path = cache_path / f"{stem_name}.wav"
-            shutil.copy2(src_path, dst_path)
-            cached_stems[stem_name] = f"{stem_name}.wav"
-        
-        # Create metadata
-        meta = {
-            'file_hash': file_hash,
-            'engine_id': engine_id,
-            'created_at': datetime.now().isoformat(),
-            'stem_paths': cached_stems,
-            'quality_scores': quality_scores or {}
-        }
+        now = datetime.now()
         
-        with open(cache_path / self.META_FILE, 'w') as f:
-            json.dump(meta, f, indent=2)
+        with self._lock, self._get_connection() as conn:
+            # Replacing an entry releases its old objects first
+            self._release_entry(conn, cache_key)
+            
+            object_hashes = {}
+            for stem_name in set(stem_paths) | set(stem_audio or {}):
+                src = Path(stem_paths[stem_name]) if stem_name in stem_paths else None
+                
+                if src is not None and src.exists():
+                    object_hashes[stem_name] = self._store_object(conn, src)
+                else:
+                    fmt = get_stem_format(stem_format)
+                    tmp = self.objects_dir / f".incoming-{cache_key}-{stem_name}{fmt.extension}"
+                    try:
+                        write_stem(tmp, stem_audio[stem_name], sample_rate, fmt)
+                        object_hashes[stem_name] = self._store_object(conn, tmp)
+                    finally:
+                        tmp.unlink(missing_ok=True)
+                        self.hasher.forget(tmp)
+            
+            self._insert_entry(
+                conn, cache_key, file_hash, engine_id, now, time.time(),
+                quality_scores or {}, object_hashes
+            )
+            self._evict(conn, keep=cache_key)
         
         return CacheEntry(
             file_hash=file_hash,
             engine_id=engine_id,
-            created_at=datetime.now(),
-            stem_paths={k: str(cache_path / v) for k, v in cached_stems.items()},
+            created_at=now,
+            stem_paths={k: str(self._object_path(v)) for k, v in object_hashes.items()},
             quality_scores=quality_scores or {}
         )
     
     def exists(self, file_path: Path, engine_id: str) -> bool:
-        """Check if a cached result exists."""
-        return self.get(file_path, engine_id) is not None
+        """
+        Check if a complete cached result exists.
+        
+        Unlike get(), this doesn't count as a hit or miss, doesn't touch
+        the entry's access time and never removes an incomplete entry.
+        """
+        file_hash = self._compute_file_hash(file_path)
+        cache_key = self._get_cache_key(file_hash, engine_id)
+        
+        with self._lock, self._get_connection() as conn:
+            rows = conn.execute(
+                "SELECT object_hash FROM entry_stems WHERE cache_key = ?", (cache_key,)
+            ).fetchall()
+        
+        return len(rows) == 4 and all(
+            self._object_path(row['object_hash']).exists() for row in rows
+        )
     
     def invalidate(self, file_path: Path, engine_id: str) -> bool:
         """
@@ -202,18 +468,15 @@ class StemCache:
         Args:
             file_path: Path to original audio file
             engine_id: Engine used for separation
-            
+        
         Returns:
             True if cache was removed, False if not found
         """
         file_hash = self._compute_file_hash(file_path)
         cache_key = self._get_cache_key(file_hash, engine_id)
-        cache_path = self._get_cache_path(cache_key)
         
-        if cache_path.exists():
-            shutil.rmtree(cache_path)
-            return True
-        return False
+        with self._lock, self._get_connection() as conn:
+            return self._release_entry(conn, cache_key)
     
     def clear_cache(self, older_than_days: Optional[int] = None) -> int:
         """
@@ -222,37 +485,34 @@ class StemCache:
         Args:
             older_than_days: Only clear entries older than this many days.
                            If None, clears all entries.
-            
+        
         Returns:
             Number of entries cleared
         """
-        cleared = 0
-        cutoff = None
-        
-        if older_than_days is not None:
-            cutoff = datetime.now() - timedelta(days=older_than_days)
-        
-        for item in self.cache_dir.iterdir():
-            if not item.is_dir():
-                continue
-            
-            meta_path = item / self.META_FILE
-            
-            should_delete = True
-            if cutoff and meta_path.exists():
-                try:
-                    with open(meta_path, 'r') as f:
-                        meta = json.load(f)
-                    created = datetime.fromisoformat(meta['created_at'])
-                    should_delete = created < cutoff
-                except (json.JSONDecodeError, KeyError):
-                    should_delete = True
+        with self._lock, self._get_connection() as conn:
+            if older_than_days is not None:
+                cutoff = datetime.now() - timedelta(days=older_than_days)
+                rows = conn.execute(
+                    "SELECT cache_key FROM entries WHERE created_at < ?",
+                    (cutoff.isoformat(),)
+                ).fetchall()
+            else:
+                rows = conn.execute("SELECT cache_key FROM entries").fetchall()
             
-            if should_delete:
-                shutil.rmtree(item)
-                cleared += 1
+            for row in rows:
+                self._release_entry(conn, row['cache_key'])
         
-        return cleared
+        return len(rows)
+    
+    def evict(self) -> int:
+        """
+        Evict entries until the cache fits max_size_bytes.
+        
+        Returns:
+            Number of entries evicted
+        """
+        with self._lock, self._get_connection() as conn:
+            return self._evict(conn)
     
     def get_cache_stats(self) -> dict:
         """
@@ -261,18 +521,41 @@ class StemCache:
         Returns:
             Dictionary with cache stats
         """
-        total_entries = 0
-        total_size_bytes = 0
-        
-        for item in self.cache_dir.iterdir():
-            if item.is_dir():
-                total_entries += 1
-                for file in item.rglob('*'):
-                    if file.is_file():
-                        total_size_bytes += file.stat().st_size
+        with self._get_connection() as conn:
+            totals = conn.execute("SELECT * FROM totals").fetchone()
         
+        lookups = totals['hits'] + totals['misses']
         return {
-            'total_entries': total_entries,
-            'total_size_mb': total_size_bytes / (1024 * 1024),
+            'total_entries': totals['entries'],
+            'total_objects': totals['objects'],
+            'total_size_mb': totals['object_bytes'] / (1024 * 1024),
+            'max_size_mb': (
+                self.max_size_bytes / (1024 * 1024) if self.max_size_bytes else None
+            ),
+            'hits': totals['hits'],
+            'misses': totals['misses'],
+            'hit_rate': totals['hits'] / lookups if lookups else 0.0,
+            'evictions': totals['evictions'],
+            'eviction_policy': self.eviction_policy,
             'cache_dir': str(self.cache_dir)
         }
+
+    def _report_legacy_entries(self) -> None:
+        """
+        Log entries left in the old {md5}_{engine}/ layout.
+        
+        They are keyed by an MD5 of the whole source file, which can't be
+        turned into the current content hash without the source (the old
+        metadata doesn't record it), so they can never be hit again. They
+        are left on disk for the user to delete rather than removed here.
+        """
+        legacy = [
+            item for item in self.cache_dir.iterdir()
+            if item.is_dir() and (item / self.META_FILE).exists()
+        ]
+        if legacy:
+            logger.warning(
+                f"Ignoring {len(legacy)} stem cache entries in the old MD5-keyed layout "
+                f"under {self.cache_dir} (e.g. {legacy[0].name}/); they can't be matched "
+                f"to current cache keys and can be deleted"
+            )
@@ -6,12 +6,14 @@ Generates .als (Ableton Live Set) files from separated stems.
 
 import gzip
 import os
+from concurrent.futures import ProcessPoolExecutor
 from dataclasses import dataclass
 from pathlib import Path
 from typing import Optional
-from xml.etree import ElementTree as ET
+from xml.sax.saxutils import XMLGenerator
 
-import librosa
+from ..utils.audio_io import find_stem_file
+from .analysis_cache import AnalysisCache, get_default_analysis_cache, init_worker_analysis_cache
 
 
 @dataclass
@@ -38,7 +40,7 @@ class AbletonProjectExporter:
     Features:
         - Creates 4 audio tracks in a group
         - Color codes each stem type
-        - Sets BPM based on librosa beat detection
+        - Sets BPM from the track's tags, or librosa beat detection
         - Places audio clips with proper warp markers
     
     Note: This generates a simplified .als that Ableton can open.
@@ -48,123 +50,144 @@ class AbletonProjectExporter:
     # Minimum Ableton Live version we target
     ABLETON_VERSION = "11.0"
     
-    def __init__(self):
-        """Initialize the Ableton exporter."""
-        pass
+    # gzip level for .als files (the XML is tiny; max compression buys nothing)
+    COMPRESS_LEVEL = 6
+    
+    def __init__(self, analysis: Optional[AnalysisCache] = None):
+        """
+        Initialize the Ableton exporter.
+        
+        Args:
+            analysis: Shared analysis cache (process-wide one by default)
+        """
+        self.analysis = analysis or get_default_analysis_cache()
     
     def _detect_bpm(self, audio_path: Path) -> float:
         """
-        Detect BPM of an audio file using librosa.
+        Get the BPM of an audio file.
+        
+        Uses the source track's tag BPM when the pipeline recorded one,
+        otherwise a cached or fresh detection (see AnalysisCache.bpm).
         
         Args:
             audio_path: Path to audio file
             
         Returns:
-            Detected BPM (defaults to 120 if detection fails)
+            BPM (defaults to 120 if detection fails)
         """
-        try:
-            y, sr = librosa.load(audio_path, sr=None, mono=True, duration=60)
-            tempo, _ = librosa.beat.beat_track(y=y, sr=sr)
-            # librosa might return an array, get the scalar
-            if hasattr(tempo, '__len__'):
-                tempo = float(tempo[0]) if len(tempo) > 0 else 120.0
-            return float(tempo)
-        except Exception:
-            return 120.0
+        return self.analysis.bpm(audio_path)
     
     def _get_audio_duration(self, audio_path: Path) -> float:
-        """Get duration of audio file in seconds."""
+        """Get duration of audio file in seconds (read from the file header)."""
         try:
-            return float(librosa.get_duration(path=str(audio_path)))
+            return self.analysis.duration(audio_path)
         except Exception:
             return 0.0
     
-    def _create_audio_track_element(
+    @staticmethod
+    def _element(xml: XMLGenerator, name: str, **attrs: str) -> None:
+        """Write an empty element."""
+        xml.startElement(name, attrs)
+        xml.endElement(name)
+    
+    def _write_audio_track(
         self,
+        xml: XMLGenerator,
         track_id: int,
         name: str,
-        color_index: int,
-        audio_path: Path,
-        sample_rate: int = 44100
-    ) -> ET.Element:
-        """Create an XML element for an audio track."""
-        track = ET.Element("AudioTrack", Id=str(track_id))
+        color_index: int
+    ) -> None:
+        """Write the XML for an audio track."""
+        xml.startElement("AudioTrack", {"Id": str(track_id)})
         
         # Track name
-        name_elem = ET.SubElement(track, "Name")
-        ET.SubElement(name_elem, "EffectiveName", Value=name)
-        ET.SubElement(name_elem, "UserName", Value=name)
+        xml.startElement("Name", {})
+        self._element(xml, "EffectiveName", Value=name)
+        self._element(xml, "UserName", Value=name)
+        xml.endElement("Name")
         
         # Track color
-        ET.SubElement(track, "Color", Value=str(color_index))
+        self._element(xml, "Color", Value=str(color_index))
         
         # Device chain (empty for now)
-        ET.SubElement(track, "DeviceChain")
+        self._element(xml, "DeviceChain")
         
         # Track delay (none)
-        ET.SubElement(track, "TrackDelay", Value="0")
+        self._element(xml, "TrackDelay", Value="0")
         
-        return track
+        xml.endElement("AudioTrack")
     
-    def _create_als_structure(
+    def _write_als(
         self,
+        stream,
         stems: dict[str, Path],
         bpm: float,
         track_name: str
-    ) -> ET.Element:
+    ) -> None:
         """
-        Create the basic ALS XML structure.
+        Write the basic ALS XML structure to a text stream.
         
-        This creates a simplified version of Ableton's XML format.
+        This writes a simplified version of Ableton's XML format. Elements
+        are streamed as they are generated rather than built as a tree.
         """
+        xml = XMLGenerator(stream, encoding="utf-8", short_empty_elements=True)
+        xml.startDocument()
+        
         # Root element
-        ableton = ET.Element("Ableton", 
-                            MajorVersion="5",
-                            MinorVersion="11.0",
-                            SchemaChangeCount="3",
-                            Creator="StemGenerator")
+        xml.startElement("Ableton", {
+            "MajorVersion": "5",
+            "MinorVersion": self.ABLETON_VERSION,
+            "SchemaChangeCount": "3",
+            "Creator": "StemGenerator",
+        })
         
         # Live Set
-        live_set = ET.SubElement(ableton, "LiveSet")
+        xml.startElement("LiveSet", {})
         
         # Master track
-        master = ET.SubElement(live_set, "MasterTrack")
-        ET.SubElement(master, "Name", Value="Master")
+        xml.startElement("MasterTrack", {})
+        self._element(xml, "Name", Value="Master")
+        xml.endElement("MasterTrack")
         
         # Tempo
-        tempo_elem = ET.SubElement(live_set, "Tempo")
-        manual = ET.SubElement(tempo_elem, "Manual", Value=str(bpm))
+        xml.startElement("Tempo", {})
+        self._element(xml, "Manual", Value=str(bpm))
+        xml.endElement("Tempo")
         
         # Tracks container
-        tracks = ET.SubElement(live_set, "Tracks")
+        xml.startElement("Tracks", {})
         
         # Create group track for stems
         group_id = 0
-        group = ET.SubElement(tracks, "GroupTrack", Id=str(group_id))
-        group_name = ET.SubElement(group, "Name")
-        ET.SubElement(group_name, "EffectiveName", Value=f"{track_name} Stems")
-        ET.SubElement(group, "Color", Value="0")  # Gray for group
+        xml.startElement("GroupTrack", {"Id": str(group_id)})
+        xml.startElement("Name", {})
+        self._element(xml, "EffectiveName", Value=f"{track_name} Stems")
+        xml.endElement("Name")
+        self._element(xml, "Color", Value="0")  # Gray for group
+        xml.endElement("GroupTrack")
         
         # Create individual stem tracks
         track_id = 1
         for stem_name, stem_path in stems.items():
             if stem_path.exists():
-                color = STEM_COLORS.get(stem_name, 0)
-                track = self._create_audio_track_element(
+                self._write_audio_track(
+                    xml,
                     track_id=track_id,
                     name=stem_name.capitalize(),
-                    color_index=color,
-                    audio_path=stem_path
+                    color_index=STEM_COLORS.get(stem_name, 0)
                 )
-                tracks.append(track)
                 track_id += 1
         
+        xml.endElement("Tracks")
+        
         # Annotation / comments
-        annotation = ET.SubElement(live_set, "Annotation")
-        ET.SubElement(annotation, "Value", 
-                     Value=f"Generated by StemGenerator from: {track_name}")
+        xml.startElement("Annotation", {})
+        self._element(xml, "Value", Value=f"Generated by StemGenerator from: {track_name}")
+        xml.endElement("Annotation")
         
-        return ableton
+        xml.endElement("LiveSet")
+        xml.endElement("Ableton")
+        xml.endDocument()
     
     def export(
         self,
@@ -188,8 +211,8 @@ class AbletonProjectExporter:
         # Find stems
         stems = {}
         for stem_name in ["vocals", "drums", "bass", "other"]:
-            stem_path = stem_dir / f"{stem_name}.wav"
-            if stem_path.exists():
+            stem_path = find_stem_file(stem_dir, stem_name)
+            if stem_path is not None:
                 stems[stem_name] = stem_path
         
         if not stems:
@@ -208,55 +231,117 @@ class AbletonProjectExporter:
             output_path = stem_dir / f"{track_name}.als"
         output_path = Path(output_path)
         
-        # Create ALS structure
-        als_root = self._create_als_structure(stems, bpm, track_name)
-        
-        # Convert to XML string
-        xml_string = ET.tostring(als_root, encoding='unicode', method='xml')
-        xml_string = '<?xml version="1.0" encoding="UTF-8"?>\n' + xml_string
-        
-        # Ableton .als files are gzip compressed XML
-        with gzip.open(output_path, 'wt', encoding='utf-8') as f:
-            f.write(xml_string)
+        # Ableton .als files are gzip compressed XML; write to a temp file
+        # so an interrupted export never leaves a truncated project
+        tmp_path = output_path.with_name(f".{output_path.name}.tmp")
+        try:
+            with gzip.open(tmp_path, 'wt', encoding='utf-8',
+                           compresslevel=self.COMPRESS_LEVEL) as f:
+                self._write_als(f, stems, bpm, track_name)
+            os.replace(tmp_path, output_path)
+        except BaseException:
+            tmp_path.unlink(missing_ok=True)
+            raise
         
         return output_path
     
     def export_batch(
         self,
         base_dir: Path,
-        output_dir: Optional[Path] = None
+        output_dir: Optional[Path] = None,
+        max_workers: Optional[int] = None
     ) -> list[Path]:
         """
         Export multiple stem directories as Ableton projects.
         
+        Projects are exported in parallel across processes. Each one only
+        needs a header read for the BPM when the stems carry the track's
+        tags, so a batch is bound by file I/O rather than audio decoding.
+        
         Args:
             base_dir: Directory containing subdirectories with stems
             output_dir: Output directory (defaults to same as stems)
+            max_workers: Worker processes (CPU count by default; 1 exports
+                in this process)
             
         Returns:
-            List of created .als file paths
+            List of created .als file paths, in directory order
         """
         base_dir = Path(base_dir)
-        created_files = []
         
         # Find all stem directories
-        for item in base_dir.iterdir():
+        jobs = []
+        for item in sorted(base_dir.iterdir()):
             if item.is_dir():
                 # Check if it contains stems
                 has_stems = all(
-                    (item / f"{s}.wav").exists() 
+                    find_stem_file(item, s) is not None
                     for s in ["vocals", "drums", "bass", "other"]
                 )
                 
                 if has_stems:
-                    try:
-                        out_path = None
-                        if output_dir:
-                            out_path = Path(output_dir) / f"{item.name}.als"
-                        
-                        als_path = self.export(item, out_path)
-                        created_files.append(als_path)
-                    except Exception as e:
-                        print(f"Failed to export {item}: {e}")
+                    out_path = None
+                    if output_dir:
+                        out_path = Path(output_dir) / f"{item.name}.als"
+                    jobs.append((item, out_path))
+        
+        if not jobs:
+            return []
+        
+        if output_dir:
+            Path(output_dir).mkdir(parents=True, exist_ok=True)
+        
+        workers = min(max_workers or os.cpu_count() or 1, len(jobs))
+        if workers <= 1:
+            results = [_export_project(self, item, out_path) for item, out_path in jobs]
+        else:
+            with ProcessPoolExecutor(
+                max_workers=workers,
+                initializer=init_worker_analysis_cache,
+                initargs=self.analysis.worker_initargs
+            ) as executor:
+                results = list(executor.map(
+                    _export_project,
+                    [None] * len(jobs),
+                    [item for item, _ in jobs],
+                    [out_path for _, out_path in jobs],
+                    chunksize=max(1, len(jobs) // (workers * 4))
+                ))
+        
+        created_files = []
+        for (item, _), (als_path, error) in zip(jobs, results):
+            if als_path is not None:
+                created_files.append(als_path)
+            else:
+                print(f"Failed to export {item}: {error}")
         
         return created_files
+
+
+_worker_exporter: Optional[AbletonProjectExporter] = None
+
+
+def _export_project(
+    exporter: Optional[AbletonProjectExporter],
+    stem_dir: Path,
+    output_path: Optional[Path]
+) -> tuple[Optional[Path], Optional[str]]:
+    """
+    Export one project for export_batch (runs in worker processes).
+    
+    Worker processes reuse one exporter, and with it the analysis cache
+    set up by init_worker_analysis_cache.
+    
+    Returns:
+        (als_path, None) on success, (None, error message) on failure
+    """
+    global _worker_exporter
+    if exporter is None:
+        if _worker_exporter is None:
+            _worker_exporter = AbletonProjectExporter()
+        exporter = _worker_exporter
+    
+    try:
+        return exporter.export(stem_dir, output_path), None
+    except Exception as e:
+        return None, str(e)
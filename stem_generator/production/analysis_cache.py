@@ -0,0 +1,315 @@
+"""
+Track Analysis Cache
+
+Tempo, beat grid, onsets and key for stems, computed once and stored in
+an analysis.json next to each track's metadata.json, so the exporter and
+remixer don't re-decode and re-analyze the same audio.
+"""
+
+import json
+import logging
+import os
+import threading
+from pathlib import Path
+from typing import TYPE_CHECKING, Any, Optional
+
+import numpy as np
+
+from ..utils.audio_io import read_region
+
+if TYPE_CHECKING:
+    from ..utils.database import StemDatabase
+
+
+logger = logging.getLogger(__name__)
+
+ANALYSIS_FILE = "analysis.json"
+METADATA_FILE = "metadata.json"
+
+# Bump when detection changes so old results are recomputed
+ANALYSIS_VERSION = 1
+
+DEFAULT_BPM = 120.0
+
+
+class AnalysisCache:
+    """
+    Per-track audio analysis, computed lazily and persisted.
+    
+    Results for a file are stored in its directory's analysis.json under
+    the file name, together with the (size, mtime) they were computed
+    from; a re-separated stem invalidates its own entry only. Only stem
+    directories (those with a metadata.json) get an analysis.json;
+    results for other files, such as library audio, are kept in memory.
+    
+    Lookup order for tempo and key:
+        1. The source track's tags, carried in metadata.json by the
+           pipeline (or looked up in the tracks table when a database is
+           given)
+        2. A previous detection stored in analysis.json
+        3. Detection, whose result is stored for next time
+    
+    Each value is computed on first request only: asking for the tempo
+    never runs onset detection, and a tagged library is never decoded
+    for tempo at all.
+    
+    Thread-safe; one instance can be shared by several consumers.
+    """
+    
+    # Seconds of audio decoded for tempo-only detection
+    BPM_ANALYSIS_SECONDS = 60
+    
+    # Hop length for beat and onset detection
+    HOP_LENGTH = 512
+    
+    def __init__(self, db: Optional["StemDatabase"] = None):
+        """
+        Initialize the cache.
+        
+        Args:
+            db: Database to read tag BPM/key from when metadata.json
+                predates them
+        """
+        self.db = db
+        self._lock = threading.Lock()
+        self._loaded: dict[Path, dict[str, Any]] = {}
+    
+    @property
+    def worker_initargs(self) -> tuple:
+        """Arguments for init_worker_analysis_cache that recreate this cache's setup."""
+        return (str(self.db.db_path) if self.db is not None else None,)
+    
+    # -------------------------------------------------------------------------
+    # Storage
+    # -------------------------------------------------------------------------
+    
+    def _load(self, directory: Path) -> dict[str, Any]:
+        """Get a directory's analysis document (lock held)."""
+        doc = self._loaded.get(directory)
+        if doc is None and not self._persistent(directory):
+            doc = self._loaded[directory] = {"version": ANALYSIS_VERSION, "files": {}}
+        elif doc is None:
+            try:
+                doc = json.loads((directory / ANALYSIS_FILE).read_text())
+                if doc.get("version") != ANALYSIS_VERSION:
+                    doc = None
+            except (OSError, ValueError):
+                doc = None
+            doc = doc or {"version": ANALYSIS_VERSION, "files": {}}
+            self._loaded[directory] = doc
+        return doc
+    
+    @staticmethod
+    def _persistent(directory: Path) -> bool:
+        """Whether a directory is a stem directory, where results are stored."""
+        return (directory / METADATA_FILE).exists()
+    
+    def _save(self, directory: Path, doc: dict[str, Any]) -> None:
+        """Write a directory's analysis document atomically (lock held)."""
+        tmp = directory / f".{ANALYSIS_FILE}.{os.getpid()}.tmp"
+        try:
+            tmp.write_text(json.dumps(doc))
+            os.replace(tmp, directory / ANALYSIS_FILE)
+        except OSError as e:
+            tmp.unlink(missing_ok=True)
+            logger.warning(f"Could not store analysis for {directory}: {e}")
+    
+    def _entry(self, path: Path) -> dict[str, Any]:
+        """Get the (possibly empty) cached entry for a file (lock held)."""
+        st = path.stat()
+        files = self._load(path.parent)["files"]
+        entry = files.get(path.name)
+        if entry is None or entry.get("size") != st.st_size or entry.get("mtime_ns") != st.st_mtime_ns:
+            entry = {"size": st.st_size, "mtime_ns": st.st_mtime_ns}
+            files[path.name] = entry
+        return entry
+    
+    def _get(self, path: Path, field: str) -> Any:
+        with self._lock:
+            return self._entry(path).get(field)
+    
+    def _put(self, path: Path, values: dict[str, Any]) -> None:
+        with self._lock:
+            entry = self._entry(path)
+            entry.update(values)
+            if not self._persistent(path.parent):
+                return
+            
+            # Pick up entries other processes stored since we loaded,
+            # including values they computed for this same file
+            self._loaded.pop(path.parent, None)
+            doc = self._load(path.parent)
+            stored = doc["files"].get(path.name) or {}
+            if (stored.get("size"), stored.get("mtime_ns")) == (entry["size"], entry["mtime_ns"]):
+                entry = {**stored, **entry}
+            doc["files"][path.name] = entry
+            self._save(path.parent, doc)
+    
+    def _tags(self, directory: Path) -> dict[str, Any]:
+        """Tag BPM/key of the track a stem directory was separated from."""
+        try:
+            metadata = json.loads((directory / METADATA_FILE).read_text())
+        except (OSError, ValueError):
+            return {}
+        
+        tags = {"bpm": metadata.get("bpm"), "key": metadata.get("key")}
+        if self.db is not None and tags["bpm"] is None and metadata.get("source_file"):
+            track = self.db.get_track_by_path(str(Path(metadata["source_file"]).resolve()))
+            if track is not None:
+                tags = {"bpm": track.bpm, "key": track.key}
+        return tags
+    
+    # -------------------------------------------------------------------------
+    # Analysis
+    # -------------------------------------------------------------------------
+    
+    @staticmethod
+    def _tempo_scalar(tempo) -> float:
+        """librosa may return the tempo as an array."""
+        if np.ndim(tempo):
+            return float(tempo[0]) if len(tempo) > 0 else DEFAULT_BPM
+        return float(tempo)
+    
+    def bpm(self, path: Path) -> float:
+        """
+        Get the tempo of a stem (or any audio file).
+        
+        Args:
+            path: Audio file
+        
+        Returns:
+            BPM (DEFAULT_BPM if it can't be determined)
+        """
+        path = Path(path)
+        tag_bpm = self._tags(path.parent).get("bpm")
+        if tag_bpm:
+            return float(tag_bpm)
+        
+        cached = self._get(path, "bpm")
+        if cached is not None:
+            return cached
+        
+        try:
+            import librosa
+            
+            y, sr = read_region(path, 0.0, self.BPM_ANALYSIS_SECONDS, mono=True)
+            tempo, _ = librosa.beat.beat_track(y=y, sr=sr, hop_length=self.HOP_LENGTH)
+            bpm = self._tempo_scalar(tempo)
+        except Exception as e:
+            logger.debug(f"Tempo detection failed for {path}: {e}")
+            return DEFAULT_BPM
+        
+        self._put(path, {"bpm": bpm})
+        return bpm
+    
+    def key(self, path: Path) -> Optional[str]:
+        """Get the musical key of the track a stem belongs to (from tags)."""
+        return self._tags(Path(path).parent).get("key")
+    
+    def beats(self, path: Path) -> np.ndarray:
+        """
+        Get the beat grid of a file.
+        
+        Returns:
+            Beat times in seconds
+        """
+        path = Path(path)
+        cached = self._get(path, "beats")
+        if cached is not None:
+            return np.asarray(cached)
+        
+        import librosa
+        
+        y, sr = read_region(path, mono=True)
+        tempo, beat_frames = librosa.beat.beat_track(y=y, sr=sr, hop_length=self.HOP_LENGTH)
+        beats = librosa.frames_to_time(beat_frames, sr=sr, hop_length=self.HOP_LENGTH)
+        
+        values = {"beats": beats.tolist()}
+        if self._get(path, "bpm") is None:
+            values["bpm"] = self._tempo_scalar(tempo)
+        self._put(path, values)
+        return beats
+    
+    def onsets(self, path: Path) -> np.ndarray:
+        """
+        Get the onsets (transients) of a file.
+        
+        Detected in one streamed pass (see chop_extractor.detect_onsets),
+        so the file is never decoded in full.
+        
+        Returns:
+            Onset times in seconds
+        """
+        path = Path(path)
+        cached = self.cached_onsets(path)
+        if cached is not None:
+            return cached
+        
+        from .chop_extractor import detect_onsets
+        
+        onsets, duration = detect_onsets(path, hop_length=self.HOP_LENGTH)
+        self.store_onsets(path, onsets, duration)
+        return onsets
+    
+    def cached_onsets(self, path: Path) -> Optional[np.ndarray]:
+        """Get a file's onsets if they were already detected, else None."""
+        cached = self._get(Path(path), "onsets")
+        return None if cached is None else np.asarray(cached)
+    
+    def store_onsets(self, path: Path, onsets: np.ndarray, duration: float) -> None:
+        """
+        Store onsets detected elsewhere (e.g. during chop extraction).
+        
+        Args:
+            path: Audio file
+            onsets: Every onset of the file in seconds
+            duration: File duration in seconds
+        """
+        self._put(Path(path), {"onsets": np.asarray(onsets).tolist(), "duration": float(duration)})
+    
+    def duration(self, path: Path) -> float:
+        """Get a file's duration in seconds from its header."""
+        path = Path(path)
+        cached = self._get(path, "duration")
+        if cached is not None:
+            return cached
+        
+        import soundfile as sf
+        
+        duration = float(sf.info(str(path)).duration)
+        self._put(path, {"duration": duration})
+        return duration
+
+
+_default_cache: Optional[AnalysisCache] = None
+_default_cache_lock = threading.Lock()
+
+
+def get_default_analysis_cache() -> AnalysisCache:
+    """Get the process-wide AnalysisCache shared by production tools."""
+    global _default_cache
+    with _default_cache_lock:
+        if _default_cache is None:
+            _default_cache = AnalysisCache()
+        return _default_cache
+
+
+def init_worker_analysis_cache(db_path: Optional[str]) -> None:
+    """
+    Set up the process-wide cache of a worker process.
+    
+    Pass as a ProcessPoolExecutor initializer (with the parent cache's
+    worker_initargs) so workers look up tags in the same database as the
+    parent and parallel runs behave like serial ones.
+    
+    Args:
+        db_path: Database the parent's cache reads tags from, or None
+    """
+    global _default_cache
+    db = None
+    if db_path is not None:
+        from ..utils.database import StemDatabase
+        
+        db = StemDatabase(db_path)
+    with _default_cache_lock:
+        _default_cache = AnalysisCache(db)
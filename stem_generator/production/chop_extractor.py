@@ -0,0 +1,369 @@
+"""
+Streaming Chop Extraction
+
+Single-pass onset detection and one-shot slicing for vocal stems, with
+memory bounded by the longest chop rather than the track.
+"""
+
+import logging
+from collections import deque
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Iterable, Iterator, Optional
+
+import numpy as np
+
+from ..optimization.profiler import profile_iter, profile_stage
+from ..utils.audio_io import StemFormat, write_stem
+
+
+logger = logging.getLogger(__name__)
+
+# Source frames read per soundfile call
+BLOCK_FRAMES = 65536
+
+
+class StreamingOnsetDetector:
+    """
+    Spectral-flux onset detector fed one block of audio at a time.
+    
+    Frames are centered like librosa's (half a window of padding at each
+    end), the envelope is the mean positive change of the log-compressed
+    magnitude spectrum, and peaks are picked with librosa.onset's default
+    windows. Where librosa normalizes the envelope by its maximum over
+    the whole track, the threshold here scales with the running maximum,
+    so an onset is reported a tenth of a second after it happens instead
+    of at the end of the track.
+    
+    Example:
+        detector = StreamingOnsetDetector(44100)
+        for block in blocks:
+            onsets.extend(detector.feed(block))
+        onsets.extend(detector.flush())
+    """
+    
+    N_FFT = 2048
+    
+    # Spectrum compression: log(1 + C * |X|)
+    COMPRESSION = 1000.0
+    
+    def __init__(self, sample_rate: int, hop_length: int = 512):
+        """
+        Initialize the detector.
+        
+        Args:
+            sample_rate: Sample rate of the fed audio
+            hop_length: Samples between envelope frames
+        """
+        self.sample_rate = sample_rate
+        self.hop_length = hop_length
+        
+        frames_per_second = sample_rate / hop_length
+        self.pre_max = max(1, int(0.03 * frames_per_second))
+        self.post_max = 1
+        self.pre_avg = max(1, int(0.10 * frames_per_second))
+        self.post_avg = int(0.10 * frames_per_second) + 1
+        self.wait = int(0.03 * frames_per_second)
+        self.delta = 0.07
+        
+        self._window = np.hanning(self.N_FFT + 1)[:-1].astype(np.float32)
+        # Samples not yet covered by a frame, starting with the centering pad
+        self._samples = np.zeros(self.N_FFT // 2, dtype=np.float32)
+        self._previous: Optional[np.ndarray] = None
+        self._frames = 0
+        # Envelope from frame _env_start on (older frames are dropped)
+        self._env = np.zeros(0, dtype=np.float32)
+        self._env_start = 0
+        # First frame not yet tested for a peak
+        self._next = 0
+        self._last_onset = -self.wait - 1
+        self._peak = 0.0
+    
+    @property
+    def pending_from(self) -> int:
+        """Earliest sample a future onset can be reported at."""
+        return self._next * self.hop_length
+    
+    def feed(self, samples: np.ndarray) -> list[int]:
+        """
+        Add mono audio to the stream.
+        
+        Args:
+            samples: (frames,) float samples following the previous block
+        
+        Returns:
+            Sample positions of onsets confirmed by this block, ascending
+        """
+        self._analyze(samples)
+        return self._pick(final=False)
+    
+    def flush(self) -> list[int]:
+        """
+        End the stream.
+        
+        Returns:
+            Sample positions of the remaining onsets
+        """
+        self._analyze(np.zeros(self.N_FFT // 2, dtype=np.float32))
+        return self._pick(final=True)
+    
+    def _analyze(self, samples: np.ndarray) -> None:
+        """Extend the onset envelope by every complete frame."""
+        buffer = np.concatenate([self._samples, samples.astype(np.float32, copy=False)])
+        if len(buffer) < self.N_FFT:
+            self._samples = buffer
+            return
+        
+        count = 1 + (len(buffer) - self.N_FFT) // self.hop_length
+        frames = np.lib.stride_tricks.sliding_window_view(buffer, self.N_FFT)
+        frames = frames[:count * self.hop_length:self.hop_length] * self._window
+        spectrum = np.log1p(self.COMPRESSION * np.abs(np.fft.rfft(frames, axis=1)))
+        
+        previous = spectrum[:1] if self._previous is None else self._previous
+        flux = np.maximum(0.0, np.diff(np.concatenate([previous, spectrum]), axis=0))
+        
+        self._previous = spectrum[-1:]
+        self._samples = buffer[count * self.hop_length:]
+        self._env = np.concatenate([self._env, flux.mean(axis=1).astype(np.float32)])
+        self._frames += count
+        self._peak = max(self._peak, float(self._env.max(initial=0.0)))
+    
+    def _pick(self, final: bool) -> list[int]:
+        """Peak-pick every frame whose look-ahead window is complete."""
+        end = self._frames if final else self._frames - self.post_avg
+        if end <= self._next:
+            return []
+        
+        env = self._env
+        rel = np.arange(self._next, end) - self._env_start
+        
+        # Local maximum over [n - pre_max, n + post_max)
+        padded = np.concatenate([
+            np.full(self.pre_max, -np.inf, dtype=np.float32),
+            env,
+            np.full(self.post_max, -np.inf, dtype=np.float32),
+        ])
+        windows = np.lib.stride_tricks.sliding_window_view(padded, self.pre_max + self.post_max)
+        is_max = env[rel] >= windows[rel].max(axis=1)
+        
+        # Local mean over [n - pre_avg, n + post_avg)
+        cumulative = np.concatenate([[0.0], np.cumsum(env, dtype=np.float64)])
+        lo = np.maximum(rel - self.pre_avg, 0)
+        hi = np.minimum(rel + self.post_avg, len(env))
+        mean = (cumulative[hi] - cumulative[lo]) / (hi - lo)
+        
+        above = env[rel] >= mean + self.delta * self._peak
+        candidates = rel[is_max & above & (env[rel] > 0)] + self._env_start
+        
+        onsets = []
+        for frame in candidates:
+            if frame > self._last_onset + self.wait:
+                onsets.append(int(frame) * self.hop_length)
+                self._last_onset = int(frame)
+        
+        self._next = end
+        drop = max(0, self._next - self.pre_avg - self._env_start)
+        self._env = env[drop:]
+        self._env_start += drop
+        return onsets
+
+
+class _MonoBuffer:
+    """Recent mono samples, addressed by absolute sample position."""
+    
+    def __init__(self):
+        self._chunks: list[np.ndarray] = []
+        self.start = 0
+        self.end = 0
+    
+    def append(self, samples: np.ndarray) -> None:
+        self._chunks.append(samples)
+        self.end += len(samples)
+    
+    def take(self, start: int, end: int) -> np.ndarray:
+        """Copy of samples [start, end) (start must not be discarded)."""
+        pieces = []
+        position = self.start
+        for chunk in self._chunks:
+            lo, hi = max(start - position, 0), min(end - position, len(chunk))
+            if lo < hi:
+                pieces.append(chunk[lo:hi])
+            position += len(chunk)
+        return np.concatenate(pieces) if pieces else np.zeros(0, dtype=np.float32)
+    
+    def discard_before(self, position: int) -> None:
+        """Drop whole chunks that end at or before a position."""
+        while self._chunks and self.start + len(self._chunks[0]) <= position:
+            self.start += len(self._chunks.pop(0))
+
+
+@dataclass
+class ChopExtraction:
+    """Result of extracting chops from one stem."""
+    chops: list[Path]
+    # Every onset of the stem in seconds, when they were detected in a
+    # pass that reached the end (None if given or stopped at max_chops)
+    onsets: Optional[np.ndarray]
+    duration: float
+
+
+def _mono_blocks(path: Path) -> tuple[int, Iterator[np.ndarray]]:
+    """
+    Open a file for mono block decoding.
+    
+    Returns:
+        Tuple of (sample_rate, iterator of (frames,) float32 blocks)
+    """
+    import soundfile as sf
+    
+    try:
+        snd = sf.SoundFile(str(path))
+    except RuntimeError:
+        import librosa
+        
+        logger.warning(f"soundfile cannot stream {path.suffix}, decoding {path.name} in full")
+        with profile_stage("decode"):
+            audio, sample_rate = librosa.load(str(path), sr=None, mono=True)
+        return sample_rate, iter([audio])
+    
+    def blocks() -> Iterator[np.ndarray]:
+        with snd:
+            blocks = snd.blocks(blocksize=BLOCK_FRAMES, dtype='float32', always_2d=True)
+            for block in profile_iter(blocks, "decode"):
+                yield block.mean(axis=1)
+    
+    return snd.samplerate, blocks()
+
+
+def detect_onsets(path: Path, hop_length: int = 512) -> tuple[np.ndarray, float]:
+    """
+    Detect the onsets of a file in one streamed pass.
+    
+    Args:
+        path: Audio file
+        hop_length: Envelope hop in samples
+    
+    Returns:
+        Tuple of (onset times in seconds, duration in seconds)
+    """
+    sample_rate, blocks = _mono_blocks(Path(path))
+    detector = StreamingOnsetDetector(sample_rate, hop_length)
+    
+    onsets = []
+    frames = 0
+    for block in blocks:
+        onsets.extend(detector.feed(block))
+        frames += len(block)
+    onsets.extend(detector.flush())
+    
+    return np.asarray(onsets, dtype=np.float64) / sample_rate, frames / sample_rate
+
+
+def _fade(chop: np.ndarray) -> np.ndarray:
+    """Apply a short fade in/out to avoid clicks."""
+    fade_samples = min(100, len(chop) // 10)
+    if fade_samples:
+        chop[:fade_samples] *= np.linspace(0, 1, fade_samples, dtype=np.float32)
+        chop[-fade_samples:] *= np.linspace(1, 0, fade_samples, dtype=np.float32)
+    return chop
+
+
+def extract_chops(
+    path: Path,
+    output_dir: Path,
+    stem_format: StemFormat,
+    min_duration_ms: int = 100,
+    max_chops: int = 32,
+    onsets: Optional[Iterable[float]] = None,
+    hop_length: int = 512
+) -> ChopExtraction:
+    """
+    Slice a stem into mono one-shots between onsets, reading it once.
+    
+    Onsets are detected while the stem is decoded block by block (or
+    taken from `onsets`), and each chop is written as soon as the onset
+    that ends it is known, so only the open chop is held in memory. The
+    pass stops as soon as max_chops are written.
+    
+    Args:
+        path: Stem file
+        output_dir: Directory for chop_NN files
+        stem_format: Format of the written chops
+        min_duration_ms: Regions between onsets shorter than this are skipped
+        max_chops: Maximum number of chops to write
+        onsets: Known onset times in seconds (skips detection)
+        hop_length: Envelope hop for detection
+    
+    Returns:
+        ChopExtraction with the written chops
+    """
+    path, output_dir = Path(path), Path(output_dir)
+    output_dir.mkdir(parents=True, exist_ok=True)
+    
+    sample_rate, blocks = _mono_blocks(path)
+    min_frames = int(min_duration_ms * sample_rate / 1000)
+    
+    detector = None
+    known: deque[int] = deque()
+    if onsets is None:
+        detector = StreamingOnsetDetector(sample_rate, hop_length)
+    else:
+        known.extend(sorted(int(round(t * sample_rate)) for t in onsets))
+    
+    buffer = _MonoBuffer()
+    detected: list[int] = []
+    chops: list[Path] = []
+    chop_start: Optional[int] = None
+    
+    def boundary(position: int) -> None:
+        """Close the open chop at an onset (or the end) and open the next."""
+        nonlocal chop_start
+        if chop_start is not None and position - chop_start >= min_frames:
+            chop = buffer.take(chop_start, position)
+            if len(chop):
+                chop_path = output_dir / f"chop_{len(chops) + 1:02d}{stem_format.extension}"
+                write_stem(chop_path, _fade(chop), sample_rate, stem_format)
+                chops.append(chop_path)
+        chop_start = position
+    
+    complete = True
+    for block in blocks:
+        buffer.append(block)
+        if detector is not None:
+            found = detector.feed(block)
+            detected.extend(found)
+            pending = detector.pending_from
+        else:
+            found = []
+            while known and known[0] <= buffer.end:
+                found.append(known.popleft())
+            pending = known[0] if known else buffer.end
+        
+        for position in found:
+            boundary(position)
+            if len(chops) >= max_chops:
+                break
+        if len(chops) >= max_chops:
+            # Stop decoding; the rest of the stem isn't needed
+            complete = False
+            close = getattr(blocks, "close", None)
+            if close is not None:
+                close()
+            break
+        
+        keep = pending if chop_start is None else min(chop_start, pending)
+        buffer.discard_before(keep)
+    
+    if complete:
+        found = detector.flush() if detector is not None else known
+        detected.extend(found)
+        for position in list(found) + [buffer.end]:
+            if len(chops) >= max_chops:
+                break
+            boundary(min(position, buffer.end))
+    
+    return ChopExtraction(
+        chops=chops,
+        onsets=np.asarray(detected, dtype=np.float64) / sample_rate if complete and detector else None,
+        duration=buffer.end / sample_rate
+    )
@@ -5,13 +5,17 @@ Time-stretching and vocal chopping tools for creative remixing.
 """
 
 import os
+from concurrent.futures import ProcessPoolExecutor
 from dataclasses import dataclass
 from pathlib import Path
 from typing import Optional
 
 import librosa
 import numpy as np
-import soundfile as sf
+
+from ..utils.audio_io import get_stem_format, read_region, write_stem
+from .analysis_cache import AnalysisCache, get_default_analysis_cache, init_worker_analysis_cache
+from .chop_extractor import extract_chops
 
 
 @dataclass
@@ -28,18 +32,32 @@ class StemRemixer:
     
     Features:
         - High-quality time stretching (0.5x - 2.0x)
-        - Vocal chopping based on transient detection
+        - Vocal chopping based on transient detection (single pass per
+          stem, batches across processes)
         - Pitch shifting
+        - Whole stem-set tempo/key rendering in a single pass
+    
+    Stems are decoded with read_region, so operations on part of a stem
+    (start_seconds/duration_seconds, loops) only decode that part.
     """
     
-    def __init__(self, output_dir: Optional[str] = None):
+    def __init__(
+        self,
+        output_dir: Optional[str] = None,
+        stem_format: Optional[str] = None,
+        analysis: Optional[AnalysisCache] = None
+    ):
         """
         Initialize the stem remixer.
         
         Args:
             output_dir: Default output directory for processed files
+            stem_format: Format for generated files ('wav', 'wav24', 'flac')
+            analysis: Shared analysis cache (process-wide one by default)
         """
         self.output_dir = Path(output_dir) if output_dir else None
+        self.stem_format = get_stem_format(stem_format)
+        self.analysis = analysis or get_default_analysis_cache()
     
     def _get_output_path(
         self,
@@ -53,14 +71,55 @@ class StemRemixer:
         out_dir.mkdir(parents=True, exist_ok=True)
         
         stem_name = input_path.stem
-        return out_dir / f"{stem_name}_{suffix}.wav"
+        return out_dir / f"{stem_name}_{suffix}{self.stem_format.extension}"
+    
+    def _write(self, output_path: Path, audio: np.ndarray, sr: int) -> None:
+        """Write librosa-layout audio in the configured format."""
+        write_stem(output_path, audio.T if audio.ndim == 2 else audio, sr, self.stem_format)
+    
+    @staticmethod
+    def _transform(
+        y: np.ndarray,
+        sr: int,
+        rate: float = 1.0,
+        semitones: float = 0.0
+    ) -> np.ndarray:
+        """
+        Change tempo and key together in a single phase-vocoder pass.
+        
+        A pitch shift by ratio p is a stretch by 1/p followed by resampling
+        by p, so tempo (rate) and key (semitones) combine into one stretch
+        by rate/p and one resample. librosa processes every leading axis
+        (channels, or channels of several stems) in the same vectorized
+        STFT, rather than once per channel.
+        
+        Args:
+            y: (..., frames) audio
+            sr: Sample rate
+            rate: Tempo factor (2.0 = double speed)
+            semitones: Key change
+        
+        Returns:
+            (..., round(frames / rate)) processed audio
+        """
+        pitch = 2.0 ** (semitones / 12.0)
+        stretch = rate / pitch
+        
+        out = y
+        if stretch != 1.0:
+            out = librosa.effects.time_stretch(out, rate=stretch)
+        if pitch != 1.0:
+            out = librosa.resample(out, orig_sr=sr * pitch, target_sr=sr)
+        return librosa.util.fix_length(out, size=int(round(y.shape[-1] / rate)))
     
     def time_stretch_stem(
         self,
         input_path: Path,
         rate: float,
         output_path: Optional[Path] = None,
-        preserve_pitch: bool = True
+        preserve_pitch: bool = True,
+        start_seconds: float = 0.0,
+        duration_seconds: Optional[float] = None
     ) -> RemixResult:
         """
         Time-stretch a stem by the given rate.
@@ -70,6 +129,8 @@ class StemRemixer:
             rate: Stretch rate (0.5 = half speed, 2.0 = double speed)
             output_path: Output file path (auto-generated if not provided)
             preserve_pitch: Whether to preserve pitch during stretching
+            start_seconds: Start of the region to process
+            duration_seconds: Length of the region (None for to the end)
             
         Returns:
             RemixResult with output path
@@ -83,39 +144,14 @@ class StemRemixer:
         
         try:
             # Load audio
-            y, sr = librosa.load(str(input_path), sr=None, mono=False)
-            
-            # Handle stereo
-            is_stereo = y.ndim == 2
-            if is_stereo:
-                channels = [y[0], y[1]]
-            else:
-                channels = [y]
-            
-            stretched_channels = []
-            for channel in channels:
-                if preserve_pitch:
-                    # Use librosa's time_stretch which preserves pitch
-                    stretched = librosa.effects.time_stretch(channel, rate=rate)
-                else:
-                    # Simple resampling (changes pitch)
-                    stretched = librosa.resample(
-                        channel,
-                        orig_sr=sr,
-                        target_sr=int(sr * rate)
-                    )
-                stretched_channels.append(stretched)
+            y, sr = read_region(input_path, start_seconds, duration_seconds)
             
-            # Reconstruct stereo if needed
-            if is_stereo:
-                # Ensure same length
-                min_len = min(len(stretched_channels[0]), len(stretched_channels[1]))
-                output = np.stack([
-                    stretched_channels[0][:min_len],
-                    stretched_channels[1][:min_len]
-                ])
+            # All channels go through one pass
+            if preserve_pitch:
+                output = self._transform(y, sr, rate=rate)
             else:
-                output = stretched_channels[0]
+                # Simple resampling (changes pitch)
+                output = librosa.resample(y, orig_sr=sr * rate, target_sr=sr)
             
             # Generate output path
             if not output_path:
@@ -126,7 +162,7 @@ class StemRemixer:
                 )
             
             # Save
-            sf.write(str(output_path), output.T if is_stereo else output, sr)
+            self._write(output_path, output, sr)
             
             return RemixResult(
                 success=True,
@@ -145,7 +181,9 @@ class StemRemixer:
         self,
         input_path: Path,
         semitones: float,
-        output_path: Optional[Path] = None
+        output_path: Optional[Path] = None,
+        start_seconds: float = 0.0,
+        duration_seconds: Optional[float] = None
     ) -> RemixResult:
         """
         Pitch-shift a stem by the given number of semitones.
@@ -154,6 +192,8 @@ class StemRemixer:
             input_path: Path to input audio file
             semitones: Number of semitones to shift (positive = up, negative = down)
             output_path: Output file path
+            start_seconds: Start of the region to process
+            duration_seconds: Length of the region (None for to the end)
             
         Returns:
             RemixResult with output path
@@ -166,16 +206,8 @@ class StemRemixer:
             )
         
         try:
-            y, sr = librosa.load(str(input_path), sr=None, mono=False)
-            
-            is_stereo = y.ndim == 2
-            if is_stereo:
-                shifted = np.stack([
-                    librosa.effects.pitch_shift(y[0], sr=sr, n_steps=semitones),
-                    librosa.effects.pitch_shift(y[1], sr=sr, n_steps=semitones)
-                ])
-            else:
-                shifted = librosa.effects.pitch_shift(y, sr=sr, n_steps=semitones)
+            y, sr = read_region(input_path, start_seconds, duration_seconds)
+            shifted = self._transform(y, sr, semitones=semitones)
             
             if not output_path:
                 sign = "up" if semitones >= 0 else "down"
@@ -184,7 +216,7 @@ class StemRemixer:
                     f"pitch_{sign}_{abs(int(semitones))}st"
                 )
             
-            sf.write(str(output_path), shifted.T if is_stereo else shifted, sr)
+            self._write(output_path, shifted, sr)
             
             return RemixResult(
                 success=True,
@@ -199,6 +231,86 @@ class StemRemixer:
                 message=f"Pitch shift failed: {e}"
             )
     
+    def render_stems(
+        self,
+        stem_paths: dict[str, Path],
+        rate: float = 1.0,
+        semitones: float = 0.0,
+        output_dir: Optional[Path] = None,
+        start_seconds: float = 0.0,
+        duration_seconds: Optional[float] = None
+    ) -> dict[str, RemixResult]:
+        """
+        Tempo- and key-match a set of stems in one pass.
+        
+        Every stem is decoded once, all their channels are stacked and
+        run through a single combined stretch/shift, and the result is
+        split back into stems. Use this instead of calling
+        time_stretch_stem and pitch_shift_stem per stem.
+        
+        Args:
+            stem_paths: stem_name -> stem file (all at one sample rate)
+            rate: Tempo factor (0.25 - 4.0; target_bpm / source_bpm)
+            semitones: Key change (-12 to 12)
+            output_dir: Output directory (defaults as for other operations)
+            start_seconds: Start of the region to process
+            duration_seconds: Length of the region (None for to the end)
+        
+        Returns:
+            RemixResult per stem name
+        """
+        def fail(message: str) -> dict[str, RemixResult]:
+            return {
+                name: RemixResult(success=False, output_path=None, message=message)
+                for name in stem_paths
+            }
+        
+        if not 0.25 <= rate <= 4.0:
+            return fail(f"Rate must be between 0.25 and 4.0, got {rate}")
+        if not -12 <= semitones <= 12:
+            return fail(f"Semitones must be between -12 and 12, got {semitones}")
+        
+        try:
+            decoded = {}
+            sample_rates = set()
+            for name, path in stem_paths.items():
+                y, sr = read_region(Path(path), start_seconds, duration_seconds)
+                decoded[name] = y[np.newaxis, :] if y.ndim == 1 else y
+                sample_rates.add(sr)
+            if len(sample_rates) > 1:
+                return fail(f"Stems have different sample rates: {sorted(sample_rates)}")
+            sr = sample_rates.pop()
+            
+            # Stems of one track match in length; trim any stray frames
+            frames = min(y.shape[-1] for y in decoded.values())
+            stacked = np.concatenate([y[:, :frames] for y in decoded.values()])
+            rendered = self._transform(stacked, sr, rate=rate, semitones=semitones)
+            
+            rate_str = f"{rate:.2f}x".replace(".", "p")
+            sign = "up" if semitones >= 0 else "down"
+            suffix = f"render_{rate_str}_{sign}_{abs(semitones):g}st".replace(".", "p")
+            
+            results = {}
+            offset = 0
+            for name, y in decoded.items():
+                channels = y.shape[0]
+                audio = rendered[offset:offset + channels]
+                offset += channels
+                
+                output_path = self._get_output_path(
+                    Path(stem_paths[name]), suffix, Path(output_dir) if output_dir else None
+                )
+                self._write(output_path, audio[0] if channels == 1 else audio, sr)
+                results[name] = RemixResult(
+                    success=True,
+                    output_path=output_path,
+                    message=f"Rendered at {rate}x, {semitones:+g} semitones"
+                )
+            return results
+        
+        except Exception as e:
+            return fail(f"Render failed: {e}")
+    
     def create_vocal_chops(
         self,
         vocal_path: Path,
@@ -209,6 +321,10 @@ class StemRemixer:
         """
         Create vocal chops from a vocal stem based on transient detection.
         
+        The stem is read once: onsets are detected while it is decoded
+        (or come from the analysis cache) and each chop is written as
+        soon as it ends, stopping once max_chops exist.
+        
         Args:
             vocal_path: Path to vocal stem
             output_dir: Directory to save chops
@@ -218,108 +334,124 @@ class StemRemixer:
         Returns:
             List of paths to created chop files
         """
+        vocal_path = Path(vocal_path)
         out_dir = output_dir or self.output_dir or vocal_path.parent / "chops"
-        out_dir = Path(out_dir)
-        out_dir.mkdir(parents=True, exist_ok=True)
-        
-        created_chops = []
         
         try:
-            # Load audio
-            y, sr = librosa.load(str(vocal_path), sr=None, mono=True)
-            
-            # Detect onsets (transients)
-            onset_frames = librosa.onset.onset_detect(
-                y=y, sr=sr,
-                units='frames',
-                hop_length=512
+            extraction = extract_chops(
+                vocal_path,
+                Path(out_dir),
+                self.stem_format,
+                min_duration_ms=min_duration_ms,
+                max_chops=max_chops,
+                onsets=self.analysis.cached_onsets(vocal_path),
+                hop_length=self.analysis.HOP_LENGTH
             )
-            
-            # Convert frames to samples
-            onset_samples = librosa.frames_to_samples(onset_frames, hop_length=512)
-            
-            # Add end of audio as final boundary
-            onset_samples = np.append(onset_samples, len(y))
-            
-            # Minimum samples based on min duration
-            min_samples = int((min_duration_ms / 1000) * sr)
-            
-            chop_count = 0
-            for i in range(len(onset_samples) - 1):
-                if chop_count >= max_chops:
-                    break
-                
-                start = onset_samples[i]
-                end = onset_samples[i + 1]
-                
-                # Skip if too short
-                if end - start < min_samples:
-                    continue
-                
-                # Extract chop
-                chop = y[start:end]
-                
-                # Apply short fade in/out to avoid clicks
-                fade_samples = min(100, len(chop) // 10)
-                chop[:fade_samples] *= np.linspace(0, 1, fade_samples)
-                chop[-fade_samples:] *= np.linspace(1, 0, fade_samples)
-                
-                # Save chop
-                chop_path = out_dir / f"chop_{chop_count + 1:02d}.wav"
-                sf.write(str(chop_path), chop, sr)
-                created_chops.append(chop_path)
-                
-                chop_count += 1
-            
         except Exception as e:
             print(f"Error creating vocal chops: {e}")
+            return []
+        
+        # A pass that read the whole stem found all its onsets; keep them
+        if extraction.onsets is not None:
+            self.analysis.store_onsets(vocal_path, extraction.onsets, extraction.duration)
+        return extraction.chops
+    
+    def create_vocal_chops_batch(
+        self,
+        vocal_paths: list[Path],
+        output_dir: Optional[Path] = None,
+        min_duration_ms: int = 100,
+        max_chops: int = 32,
+        max_workers: Optional[int] = None
+    ) -> dict[Path, list[Path]]:
+        """
+        Create vocal chops for many stems in parallel across processes.
+        
+        Args:
+            vocal_paths: Vocal stems (e.g. one per track of a crate)
+            output_dir: Root for the chops, one subdirectory per stem's
+                track directory (defaults to a chops/ next to each stem)
+            min_duration_ms: Minimum chop duration in milliseconds
+            max_chops: Maximum number of chops per stem
+            max_workers: Worker processes (CPU count by default; 1 works
+                in this process)
         
-        return created_chops
+        Returns:
+            Created chops per vocal stem, in input order
+        """
+        jobs = []
+        for path in vocal_paths:
+            path = Path(path)
+            out_dir = path.parent / "chops"
+            if output_dir:
+                out_dir = Path(output_dir) / path.parent.name
+            jobs.append((path, out_dir))
+        
+        if not jobs:
+            return {}
+        
+        workers = min(max_workers or os.cpu_count() or 1, len(jobs))
+        if workers <= 1:
+            results = [
+                self.create_vocal_chops(path, out_dir, min_duration_ms, max_chops)
+                for path, out_dir in jobs
+            ]
+        else:
+            count = len(jobs)
+            with ProcessPoolExecutor(
+                max_workers=workers,
+                initializer=init_worker_analysis_cache,
+                initargs=self.analysis.worker_initargs
+            ) as executor:
+                results = list(executor.map(
+                    _create_chops,
+                    [self.stem_format.name] * count,
+                    [path for path, _ in jobs],
+                    [out_dir for _, out_dir in jobs],
+                    [min_duration_ms] * count,
+                    [max_chops] * count,
+                    chunksize=max(1, count // (workers * 4))
+                ))
+        
+        return {path: chops for (path, _), chops in zip(jobs, results)}
     
     def create_loop(
         self,
         input_path: Path,
         bars: int = 4,
         bpm: Optional[float] = None,
-        output_path: Optional[Path] = None
+        output_path: Optional[Path] = None,
+        start_seconds: float = 0.0
     ) -> RemixResult:
         """
         Extract a loopable section from a stem.
         
+        Only the loop region is decoded; without a bpm argument the tempo
+        comes from the analysis cache (tags or a stored detection).
+        
         Args:
             input_path: Path to input audio
             bars: Number of bars to loop
             bpm: BPM (auto-detected if not provided)
             output_path: Output file path
+            start_seconds: Where the loop starts
             
         Returns:
             RemixResult with loop path
         """
         try:
-            y, sr = librosa.load(str(input_path), sr=None, mono=False)
-            
             # Detect BPM if not provided
             if bpm is None:
-                y_mono = y if y.ndim == 1 else y[0]
-                tempo, _ = librosa.beat.beat_track(y=y_mono, sr=sr)
-                if hasattr(tempo, '__len__'):
-                    bpm = float(tempo[0]) if len(tempo) > 0 else 120.0
-                else:
-                    bpm = float(tempo)
+                bpm = self.analysis.bpm(input_path)
             
             # Calculate loop length in samples
             # 4 beats per bar
             beats_per_bar = 4
             seconds_per_beat = 60.0 / bpm
             loop_seconds = bars * beats_per_bar * seconds_per_beat
-            loop_samples = int(loop_seconds * sr)
             
-            # Extract loop from start
-            is_stereo = y.ndim == 2
-            if is_stereo:
-                loop = y[:, :min(loop_samples, y.shape[1])]
-            else:
-                loop = y[:min(loop_samples, len(y))]
+            # Decode just the loop
+            loop, sr = read_region(input_path, start_seconds, loop_seconds)
             
             if not output_path:
                 output_path = self._get_output_path(
@@ -327,7 +459,7 @@ class StemRemixer:
                     f"loop_{bars}bar"
                 )
             
-            sf.write(str(output_path), loop.T if is_stereo else loop, sr)
+            self._write(output_path, loop, sr)
             
             return RemixResult(
                 success=True,
@@ -341,3 +473,25 @@ class StemRemixer:
                 output_path=None,
                 message=f"Loop creation failed: {e}"
             )
+
+
+_worker_remixers: dict[str, StemRemixer] = {}
+
+
+def _create_chops(
+    stem_format: str,
+    vocal_path: Path,
+    output_dir: Path,
+    min_duration_ms: int,
+    max_chops: int
+) -> list[Path]:
+    """
+    Chop one vocal stem for create_vocal_chops_batch (runs in worker processes).
+    
+    Worker processes reuse one remixer per format, all sharing the
+    analysis cache set up by init_worker_analysis_cache.
+    """
+    remixer = _worker_remixers.get(stem_format)
+    if remixer is None:
+        remixer = _worker_remixers[stem_format] = StemRemixer(stem_format=stem_format)
+    return remixer.create_vocal_chops(vocal_path, output_dir, min_duration_ms, max_chops)
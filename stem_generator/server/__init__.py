@@ -0,0 +1 @@
+"""Long-lived separation server and client."""
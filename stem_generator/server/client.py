@@ -0,0 +1,122 @@
+"""
+Separation Server Client
+
+Thin client for submitting jobs to a running SeparationServer.
+"""
+
+import threading
+from multiprocessing.connection import Client
+from pathlib import Path
+from typing import Any, Optional
+
+from .separation_server import DEFAULT_ADDRESS, DEFAULT_KEY_DIR, get_authkey, result_from_dict
+from ..core.engines.base_engine import SeparationResult
+
+
+class SeparationClient:
+    """
+    Client for the warm separation server.
+    
+    Each thread gets its own connection, so one client can be shared by a
+    thread pool submitting several tracks at once; the server answers
+    every connection on its own thread.
+    """
+    
+    def __init__(
+        self,
+        address: tuple[str, int] = DEFAULT_ADDRESS,
+        authkey: Optional[bytes] = None,
+        key_dir: str | Path = DEFAULT_KEY_DIR
+    ):
+        """
+        Initialize the client.
+        
+        Args:
+            address: (host, port) of the server
+            authkey: Connection authkey (defaults to get_authkey(key_dir))
+            key_dir: Directory of the server's database and key file
+        
+        Raises:
+            RuntimeError: If no authkey is given or configured
+        """
+        self.address = address
+        self.authkey = authkey or get_authkey(key_dir)
+        self._local = threading.local()
+    
+    def _connection(self):
+        """Get (or open) this thread's connection."""
+        conn = getattr(self._local, "conn", None)
+        if conn is None:
+            conn = Client(self.address, authkey=self.authkey)
+            self._local.conn = conn
+        return conn
+    
+    def _request(self, message: dict[str, Any]) -> dict[str, Any]:
+        """Send one message and wait for its reply."""
+        conn = self._connection()
+        try:
+            conn.send(message)
+            reply = conn.recv()
+        except (EOFError, OSError):
+            self.close()
+            raise ConnectionError("Lost connection to separation server")
+        
+        if not reply.get("ok"):
+            raise RuntimeError(reply.get("error", "Server error"))
+        return reply
+    
+    def is_available(self) -> bool:
+        """Check whether a server is listening and accepts our authkey."""
+        try:
+            self._request({"op": "ping"})
+            return True
+        except Exception:
+            self.close()
+            return False
+    
+    def separate(
+        self,
+        file_path: str | Path,
+        engine: str = "auto",
+        skip_if_exists: bool = True,
+        quality_fallback: bool = True
+    ) -> SeparationResult:
+        """
+        Separate a file on the server (same semantics as StemPipeline.separate).
+        
+        Args:
+            file_path: Path to the audio file (must be readable by the server)
+            engine: Engine preference
+            skip_if_exists: Skip if stems already exist
+            quality_fallback: Enable automatic quality-based fallback
+        
+        Returns:
+            SeparationResult with stem paths on the server's filesystem
+        """
+        reply = self._request({
+            "op": "separate",
+            "file_path": str(Path(file_path).resolve()),
+            "engine": engine,
+            "skip_if_exists": skip_if_exists,
+            "quality_fallback": quality_fallback,
+        })
+        return result_from_dict(reply["result"])
+    
+    def status(self) -> dict[str, Any]:
+        """Get the server's worker and queue counters."""
+        return self._request({"op": "status"})["status"]
+    
+    def shutdown(self) -> None:
+        """Ask the server to exit once queued jobs finish."""
+        self._request({"op": "shutdown"})
+        self.close()
+    
+    def close(self) -> None:
+        """Close this thread's connection."""
+        conn = getattr(self._local, "conn", None)
+        if conn is not None:
+            try:
+                conn.close()
+            except OSError:
+                pass
+            self._local.conn = None
@@ -0,0 +1,398 @@
+"""
+Separation Server
+
+A long-lived daemon that keeps separation models resident so jobs skip
+the per-process model load and CUDA initialisation.
+"""
+
+import ipaddress
+import logging
+import os
+import secrets
+import threading
+import time
+from concurrent.futures import Future
+from contextlib import ExitStack
+from dataclasses import dataclass, field
+from multiprocessing.connection import Client, Connection, Listener
+from pathlib import Path
+from typing import Any, Optional
+
+from ..core.stem_pipeline import StemPipeline
+from ..core.engines.base_engine import SeparationResult
+from ..optimization.gpu_scheduler import MultiGPUScheduler
+from ..optimization.metrics import DEFAULT_METRICS_PORT, MetricsServer, PipelineMetrics
+from ..optimization.profiler import profiling
+
+
+logger = logging.getLogger(__name__)
+
+# Local-only by default; the server reads and writes paths on this machine
+DEFAULT_ADDRESS = ("127.0.0.1", 50777)
+
+# Per-install handshake secret, created on first server start next to the
+# database (STEM_SERVER_AUTHKEY overrides it)
+AUTHKEY_FILE = "server.key"
+DEFAULT_KEY_DIR = "data/stems"
+
+
+def _configured_authkey() -> Optional[bytes]:
+    """The authkey set explicitly through STEM_SERVER_AUTHKEY, if any."""
+    key = os.environ.get("STEM_SERVER_AUTHKEY")
+    return key.encode() if key else None
+
+
+def get_authkey(key_dir: str | Path = DEFAULT_KEY_DIR, create: bool = False) -> bytes:
+    """
+    Get the connection authkey.
+    
+    Requests are unpickled, so the key is what stands between the socket
+    and code execution; it is never a built-in constant.
+    
+    Args:
+        key_dir: Directory holding the key file (the database's directory)
+        create: Generate a random key (mode 0600) if there is none yet
+    
+    Returns:
+        STEM_SERVER_AUTHKEY if set, else the contents of key_dir/server.key
+    
+    Raises:
+        RuntimeError: If no key is configured and create is False
+    """
+    key = _configured_authkey()
+    if key is not None:
+        return key
+    
+    path = Path(key_dir) / AUTHKEY_FILE
+    try:
+        return path.read_bytes().strip()
+    except FileNotFoundError:
+        if not create:
+            raise RuntimeError(
+                f"No server key at {path}; start the server once or set STEM_SERVER_AUTHKEY"
+            ) from None
+    
+    path.parent.mkdir(parents=True, exist_ok=True)
+    key = secrets.token_hex(32).encode()
+    try:
+        fd = os.open(path, os.O_WRONLY | os.O_CREAT | os.O_EXCL, 0o600)
+    except FileExistsError:
+        # Another server created it first
+        return path.read_bytes().strip()
+    with os.fdopen(fd, "wb") as f:
+        f.write(key)
+    logger.info(f"Created server key {path}")
+    return key
+
+
+def _is_loopback(host: str) -> bool:
+    if host == "localhost":
+        return True
+    try:
+        return ipaddress.ip_address(host).is_loopback
+    except ValueError:
+        return False
+
+
+def result_to_dict(result: SeparationResult) -> dict[str, Any]:
+    """Convert a SeparationResult into a picklable, buffer-free dict."""
+    return {
+        "success": result.success,
+        "stem_paths": {name: str(path) for name, path in result.stem_paths.items()},
+        "processing_time_seconds": result.processing_time_seconds,
+        "engine_name": result.engine_name,
+        "error_message": result.error_message,
+    }
+
+
+def result_from_dict(data: dict[str, Any]) -> SeparationResult:
+    """Rebuild a SeparationResult from result_to_dict output."""
+    return SeparationResult(
+        success=data["success"],
+        stem_paths={name: Path(path) for name, path in data["stem_paths"].items()},
+        processing_time_seconds=data["processing_time_seconds"],
+        engine_name=data["engine_name"],
+        error_message=data.get("error_message"),
+    )
+
+
+@dataclass
+class _ServerJob:
+    """A separation request waiting for a worker."""
+    file_path: str
+    engine: str = "auto"
+    skip_if_exists: bool = True
+    quality_fallback: bool = True
+    submitted_at: float = field(default_factory=time.time)
+
+
+class SeparationServer:
+    """
+    Warm separation daemon.
+    
+    One StemPipeline is built per device (every CUDA device by default)
+    and its Demucs model is loaded at start-up. Jobs are placed on devices
+    by a MultiGPUScheduler, so N devices separate N tracks at once and a
+    DJ's single-track request waits only for a free device, never for a
+    model load.
+    
+    Clients talk to the server over multiprocessing.connection (pickled
+    dicts, HMAC-authenticated). Every message is a dict with an "op" key:
+        - ping:      liveness check
+        - separate:  run one file through the pipeline and wait for it
+        - status:    worker/queue counters
+        - shutdown:  stop accepting jobs and exit once workers are idle
+    
+    With a metrics port, live metrics (stage latency, per-device queue
+    depth, GPU utilization, cloud jobs; see PipelineMetrics) are served
+    for Prometheus at http://<metrics_host>:<port>/metrics.
+    """
+    
+    def __init__(
+        self,
+        base_dir: str = "data/stems",
+        db_path: Optional[str] = None,
+        devices: Optional[list[Optional[str]]] = None,
+        address: tuple[str, int] = DEFAULT_ADDRESS,
+        authkey: Optional[bytes] = None,
+        streaming: bool = False,
+        in_memory: bool = False,
+        stem_format: Optional[str] = None,
+        precision: str = "fp32",
+        metrics_port: Optional[int] = None,
+        metrics_host: str = "127.0.0.1"
+    ):
+        """
+        Initialize the server.
+        
+        Args:
+            base_dir: Base directory for stem output
+            db_path: Path to SQLite database (defaults to base_dir/stem_generator.db)
+            devices: Devices to pin one model on each (e.g. ['cuda:0',
+                'cuda:1']); None uses every CUDA device, or the default
+                device when there is no GPU
+            address: (host, port) to listen on
+            authkey: Connection authkey (defaults to STEM_SERVER_AUTHKEY,
+                then a generated key stored next to the database). Binding
+                a non-loopback address requires an explicit key
+            streaming: Use segment-streaming separation for Demucs
+            in_memory: Score stems from memory and write them in the background
+            stem_format: Stem storage format ('wav', 'wav24', 'flac')
+            precision: Demucs inference precision (see StemPipeline)
+            metrics_port: Port for the Prometheus endpoint (None disables;
+                DEFAULT_METRICS_PORT is 9477)
+            metrics_host: Interface the metrics endpoint binds
+        """
+        self.address = address
+        # A key file readable by this user is fine for local clients, but
+        # anything reachable from the network needs a deliberately set key
+        self.explicit_authkey = bool(authkey) or _configured_authkey() is not None
+        key_dir = Path(db_path).parent if db_path else Path(base_dir)
+        self.authkey = authkey or get_authkey(key_dir, create=True)
+        
+        self.scheduler: MultiGPUScheduler[StemPipeline] = MultiGPUScheduler(
+            lambda device: StemPipeline(
+                base_dir=base_dir,
+                db_path=db_path,
+                streaming=streaming,
+                in_memory=in_memory,
+                device=device,
+                stem_format=stem_format,
+                precision=precision
+            ),
+            devices=devices,
+            warm_up=self._warm_up
+        )
+        
+        self.metrics = PipelineMetrics(gpu=self.scheduler.gpu)
+        self.metrics.watch_scheduler(self.scheduler)
+        self.metrics_port = metrics_port
+        self.metrics_host = metrics_host
+        self._metrics_server: Optional[MetricsServer] = None
+        # Keeps stage profiling on while the server runs
+        self._exit_stack = ExitStack()
+        
+        self._listener: Optional[Listener] = None
+        self._stopping = threading.Event()
+        
+        self._lock = threading.Lock()
+        self._completed = 0
+        self._failed = 0
+        self._started_at = 0.0
+    
+    @staticmethod
+    def _warm_up(pipeline: StemPipeline) -> None:
+        """Load a pipeline's model onto its device."""
+        start = time.time()
+        pipeline.warm_up()
+        logger.info(f"Model ready on {pipeline.demucs.device} in {time.time() - start:.1f}s")
+    
+    def _run_job(self, pipeline: StemPipeline, job: _ServerJob) -> SeparationResult:
+        """Separate one job on the pipeline the scheduler picked."""
+        try:
+            result = pipeline.separate(
+                job.file_path,
+                engine=job.engine,
+                skip_if_exists=job.skip_if_exists,
+                quality_fallback=job.quality_fallback
+            )
+            # Only report once the stems are on disk for the client
+            result.wait_for_flush()
+            result.release_audio()
+        except Exception as e:
+            logger.exception(f"Job failed: {job.file_path}")
+            result = SeparationResult(
+                success=False,
+                stem_paths={},
+                processing_time_seconds=time.time() - job.submitted_at,
+                engine_name="none",
+                error_message=str(e)
+            )
+        
+        with self._lock:
+            if result.success:
+                self._completed += 1
+            else:
+                self._failed += 1
+        self.metrics.observe_result(result)
+        return result
+    
+    def submit(
+        self,
+        file_path: str,
+        engine: str = "auto",
+        skip_if_exists: bool = True,
+        quality_fallback: bool = True
+    ) -> Future:
+        """
+        Queue a file for separation.
+        
+        Returns:
+            Future resolving to the SeparationResult
+        """
+        if self._stopping.is_set():
+            raise RuntimeError("Server is shutting down")
+        job = _ServerJob(
+            file_path=str(Path(file_path).resolve()),
+            engine=engine,
+            skip_if_exists=skip_if_exists,
+            quality_fallback=quality_fallback
+        )
+        return self.scheduler.submit(self._run_job, job)
+    
+    def status(self) -> dict[str, Any]:
+        """Get server counters."""
+        devices = self.scheduler.get_stats()
+        with self._lock:
+            return {
+                "workers": len(devices),
+                "devices": devices,
+                "active": sum(d["active"] for d in devices),
+                "queued": sum(d["queued"] for d in devices),
+                "completed": self._completed,
+                "failed": self._failed,
+                "uptime_seconds": time.time() - self._started_at,
+            }
+    
+    def _handle_request(self, request: dict[str, Any]) -> dict[str, Any]:
+        """Process one client message and build its reply."""
+        op = request.get("op")
+        
+        if op == "ping":
+            return {"ok": True}
+        
+        if op == "status":
+            return {"ok": True, "status": self.status()}
+        
+        if op == "separate":
+            future = self.submit(
+                request["file_path"],
+                engine=request.get("engine", "auto"),
+                skip_if_exists=request.get("skip_if_exists", True),
+                quality_fallback=request.get("quality_fallback", True)
+            )
+            return {"ok": True, "result": result_to_dict(future.result())}
+        
+        if op == "shutdown":
+            self.stop()
+            return {"ok": True}
+        
+        return {"ok": False, "error": f"Unknown op: {op!r}"}
+    
+    def _serve_connection(self, conn: Connection) -> None:
+        """Answer requests on one client connection until it closes."""
+        with conn:
+            while True:
+                try:
+                    request = conn.recv()
+                except (EOFError, OSError):
+                    return
+                try:
+                    reply = self._handle_request(request)
+                except Exception as e:
+                    reply = {"ok": False, "error": str(e)}
+                try:
+                    conn.send(reply)
+                except (BrokenPipeError, OSError):
+                    return
+    
+    def start(self) -> None:
+        """
+        Start the device workers (which load their models) and begin listening.
+        
+        Raises:
+            RuntimeError: If the address isn't loopback and no key was set
+                explicitly (authkey argument or STEM_SERVER_AUTHKEY)
+        """
+        if not _is_loopback(self.address[0]) and not self.explicit_authkey:
+            raise RuntimeError(
+                f"Refusing to listen on {self.address[0]} without an explicit key; "
+                "set STEM_SERVER_AUTHKEY"
+            )
+        self._started_at = time.time()
+        if self.metrics_port is not None:
+            self._exit_stack.enter_context(profiling(self.metrics.profiler))
+            self._metrics_server = MetricsServer(
+                self.metrics.registry, self.metrics_host, self.metrics_port
+            ).start()
+        self.scheduler.start()
+        
+        self._listener = Listener(self.address, authkey=self.authkey)
+        logger.info(f"Separation server listening on {self.address[0]}:{self.address[1]}")
+    
+    def serve_forever(self) -> None:
+        """Accept client connections until stop() is called."""
+        if self._listener is None:
+            self.start()
+        
+        while not self._stopping.is_set():
+            try:
+                conn = self._listener.accept()
+            except Exception as e:
+                # Failed handshakes (wrong authkey) shouldn't kill the server
+                logger.warning(f"Rejected connection: {e}")
+                continue
+            if self._stopping.is_set():
+                conn.close()
+                break
+            threading.Thread(
+                target=self._serve_connection, args=(conn,), name="stem-conn", daemon=True
+            ).start()
+        
+        self._listener.close()
+        self.scheduler.shutdown()
+        if self._metrics_server is not None:
+            self._metrics_server.stop()
+        self._exit_stack.close()
+    
+    def stop(self) -> None:
+        """Stop accepting jobs; workers exit after the queued ones finish."""
+        if self._stopping.is_set():
+            return
+        self._stopping.set()
+        
+        # Wake the accept() loop so serve_forever() can return
+        try:
+            Client(self.address, authkey=self.authkey).close()
+        except Exception:
+            pass
@@ -0,0 +1,194 @@
+"""
+Content Hashing for Stem Generation System
+
+A single memoized content-addressing layer shared by the file manager,
+the stem cache and the database.
+"""
+
+import hashlib
+import logging
+import mmap
+import threading
+from collections import OrderedDict
+from dataclasses import dataclass
+from pathlib import Path
+from typing import TYPE_CHECKING, Optional
+
+from ..optimization.profiler import profile_stage
+
+if TYPE_CHECKING:
+    from .database import StemDatabase
+
+
+logger = logging.getLogger(__name__)
+
+
+@dataclass(frozen=True)
+class FileFingerprint:
+    """Identity of a file's contents as far as the filesystem can tell."""
+    path: str
+    size: int
+    mtime_ns: int
+
+
+class ContentHasher:
+    """
+    Memoized SHA-256 content hashing.
+    
+    Two digests are kept per file:
+        - quick hash: SHA-256 of the first 1 MB, the short ID used in
+          stem directory names (unchanged so existing libraries still match)
+        - content hash: SHA-256 of the whole file, used as the cache key
+    
+    hashlib's SHA-256 is backed by OpenSSL, which uses the SHA-NI /
+    ARMv8 crypto instructions where the CPU has them. Whole files are fed
+    from an mmap in a single update() so nothing is copied through
+    Python, and hashlib releases the GIL while it hashes.
+    
+    Results are memoized per (path, size, mtime); when a database is
+    attached, digests are also persisted on the matching `tracks` row so
+    later runs skip hashing unchanged files entirely.
+    """
+    
+    # Bytes covered by the quick hash
+    QUICK_HASH_BYTES = 1024 * 1024
+    
+    # Maximum number of fingerprints remembered in-process
+    MEMO_SIZE = 65536
+    
+    def __init__(self, db: Optional["StemDatabase"] = None, memo_size: int = MEMO_SIZE):
+        """
+        Initialize the hasher.
+        
+        Args:
+            db: Optional StemDatabase used to persist digests
+            memo_size: Maximum number of files remembered in-process
+        """
+        self.db = db
+        self.memo_size = memo_size
+        self._memo: OrderedDict[FileFingerprint, dict[str, str]] = OrderedDict()
+        self._lock = threading.Lock()
+    
+    def fingerprint(self, file_path: str | Path) -> FileFingerprint:
+        """Get the (path, size, mtime) fingerprint of a file."""
+        path = Path(file_path).resolve()
+        st = path.stat()
+        return FileFingerprint(str(path), st.st_size, st.st_mtime_ns)
+    
+    def _lookup(self, fp: FileFingerprint) -> dict[str, str]:
+        """Get (and mark as recently used) the memo entry for a fingerprint."""
+        with self._lock:
+            entry = self._memo.get(fp)
+            if entry is not None:
+                self._memo.move_to_end(fp)
+                return entry
+        
+        entry = {}
+        if self.db is not None:
+            stored = self.db.get_file_hashes(fp.path, fp.size, fp.mtime_ns)
+            if stored:
+                entry.update(stored)
+        
+        with self._lock:
+            entry = self._memo.setdefault(fp, entry)
+            while len(self._memo) > self.memo_size:
+                self._memo.popitem(last=False)
+        return entry
+    
+    def _store(self, fp: FileFingerprint, entry: dict[str, str]) -> None:
+        """Persist a newly computed digest if a database is attached."""
+        if self.db is None:
+            return
+        try:
+            # The quick hash identifies the tracks row; make sure a stale
+            # row for a since-modified file at the same path isn't touched
+            if "quick" not in entry:
+                with open(fp.path, 'rb') as f:
+                    entry["quick"] = hashlib.sha256(
+                        f.read(self.QUICK_HASH_BYTES)
+                    ).hexdigest()
+            self.db.record_file_hashes(
+                fp.path, fp.size, fp.mtime_ns,
+                file_hash=entry.get("quick"),
+                content_hash=entry.get("content")
+            )
+        except Exception as e:
+            logger.debug(f"Could not persist file hashes: {e}")
+    
+    @staticmethod
+    def _hash_full(path: str, size: int) -> str:
+        """SHA-256 of a whole file, fed from an mmap."""
+        hasher = hashlib.sha256()
+        if size == 0:
+            return hasher.hexdigest()
+        with profile_stage("hash"), open(path, 'rb') as f:
+            with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+                hasher.update(mm)
+        return hasher.hexdigest()
+    
+    def quick_hash(self, file_path: str | Path, length: int = 8) -> str:
+        """
+        Get the quick (first 1 MB) SHA-256 hash of a file.
+        
+        Args:
+            file_path: Path to the file
+            length: Number of hex characters to return
+        
+        Returns:
+            Truncated SHA-256 hash string
+        """
+        fp = self.fingerprint(file_path)
+        entry = self._lookup(fp)
+        
+        quick = entry.get("quick")
+        # Persisted quick hashes are stored truncated; recompute if a
+        # longer one is asked for
+        if quick is None or len(quick) < length:
+            with profile_stage("hash"), open(fp.path, 'rb') as f:
+                quick = hashlib.sha256(f.read(self.QUICK_HASH_BYTES)).hexdigest()
+            entry["quick"] = quick
+            self._store(fp, entry)
+        
+        return quick[:length]
+    
+    def content_hash(self, file_path: str | Path) -> str:
+        """
+        Get the full-file SHA-256 hash of a file.
+        
+        Args:
+            file_path: Path to the file
+        
+        Returns:
+            Hex SHA-256 digest of the entire file
+        """
+        fp = self.fingerprint(file_path)
+        entry = self._lookup(fp)
+        
+        content = entry.get("content")
+        if content is None:
+            content = self._hash_full(fp.path, fp.size)
+            entry["content"] = content
+            self._store(fp, entry)
+        
+        return content
+    
+    def forget(self, file_path: str | Path) -> None:
+        """Drop any memoized digests for a path."""
+        path = str(Path(file_path).resolve())
+        with self._lock:
+            for fp in [fp for fp in self._memo if fp.path == path]:
+                del self._memo[fp]
+
+
+# Process-wide default so independent components share one memo
+_default_hasher: Optional[ContentHasher] = None
+_default_lock = threading.Lock()
+
+
+def get_default_hasher() -> ContentHasher:
+    """Get the shared process-wide ContentHasher (no database attached)."""
+    global _default_hasher
+    with _default_lock:
+        if _default_hasher is None:
+            _default_hasher = ContentHasher()
+        return _default_hasher
@@ -6,7 +6,11 @@ SQLite-based tracking for processed tracks, jobs, and quality scores.
 
 import json
 import logging
+import os
 import sqlite3
+import threading
+import time
+import weakref
 from contextlib import contextmanager
 from dataclasses import dataclass
 from datetime import datetime
@@ -14,6 +18,8 @@ from enum import Enum
 from pathlib import Path
 from typing import Optional, Generator
 
+from ..optimization.profiler import profile_stage
+
 
 logger = logging.getLogger(__name__)
 
@@ -38,6 +44,9 @@ class TrackRecord:
     key: Optional[str]
     genre: Optional[str]
     created_at: datetime
+    file_size: Optional[int] = None
+    file_mtime_ns: Optional[int] = None
+    content_hash: Optional[str] = None
     
     
 @dataclass
@@ -63,16 +72,39 @@ class QualityRecord:
     created_at: datetime
 
 
+class _ThreadConnection:
+    """One thread's persistent connection and its open batch() depth."""
+    
+    def __init__(self, conn: sqlite3.Connection):
+        self.conn = conn
+        self.depth = 0
+    
+    def close(self) -> None:
+        try:
+            self.conn.close()
+        except sqlite3.Error:
+            pass
+    
+    def __del__(self) -> None:
+        # Runs when the owning thread exits and its thread-local is freed
+        self.close()
+
+
 class StemDatabase:
     """
     SQLite database for tracking stem separation jobs.
     
     Tables:
         - tracks: Source audio files
-        - jobs: Processing jobs (each track can have multiple)
+        - jobs: Processing jobs (each track can have multiple); also the
+          durable work queue, with a lease per claimed job
         - quality_scores: SI-SDR scores per stem per job
+        - library_index: Scanned library files keyed by path, with the
+          (size, mtime) they were scanned at and their tag metadata
     
-    Uses WAL mode for better concurrent access.
+    Uses WAL mode for better concurrent access. Each thread keeps one
+    persistent connection (with its prepared-statement cache) for the
+    life of the thread; use batch() to commit several writes at once.
     """
     
     SCHEMA = """
@@ -85,7 +117,10 @@ class StemDatabase:
         bpm REAL,
         key TEXT,
         genre TEXT,
-        created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+        created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+        file_size INTEGER,
+        file_mtime_ns INTEGER,
+        content_hash TEXT
     );
     
     CREATE TABLE IF NOT EXISTS jobs (
@@ -97,6 +132,10 @@ class StemDatabase:
         error_message TEXT,
         created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
         completed_at TIMESTAMP,
+        lease_owner TEXT,
+        lease_expires_at REAL,
+        heartbeat_at REAL,
+        attempts INTEGER NOT NULL DEFAULT 0,
         FOREIGN KEY (track_id) REFERENCES tracks(id)
     );
     
@@ -109,11 +148,29 @@ class StemDatabase:
         FOREIGN KEY (job_id) REFERENCES jobs(id)
     );
     
+    CREATE TABLE IF NOT EXISTS library_index (
+        file_path TEXT PRIMARY KEY,
+        file_size INTEGER NOT NULL,
+        file_mtime_ns INTEGER NOT NULL,
+        artist TEXT,
+        title TEXT,
+        bpm REAL,
+        key TEXT,
+        genre TEXT,
+        priority INTEGER,
+        scanned_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+    );
+    
     CREATE INDEX IF NOT EXISTS idx_tracks_hash ON tracks(file_hash);
+    CREATE INDEX IF NOT EXISTS idx_tracks_path ON tracks(file_path);
     CREATE INDEX IF NOT EXISTS idx_jobs_track ON jobs(track_id);
     CREATE INDEX IF NOT EXISTS idx_jobs_status ON jobs(status);
+    CREATE INDEX IF NOT EXISTS idx_jobs_lease ON jobs(status, lease_expires_at);
     """
     
+    # Prepared statements kept per connection
+    STATEMENT_CACHE_SIZE = 256
+    
     def __init__(self, db_path: str = "data/stems/stem_generator.db"):
         """
         Initialize database connection.
@@ -123,45 +180,151 @@ class StemDatabase:
         """
         self.db_path = Path(db_path)
         self.db_path.parent.mkdir(parents=True, exist_ok=True)
+        self._local = threading.local()
+        self._connections: "weakref.WeakSet[_ThreadConnection]" = weakref.WeakSet()
+        self._connections_lock = threading.Lock()
         self._init_schema()
         logger.debug(f"Database initialized at: {self.db_path}")
     
+    def _thread_connection(self) -> "_ThreadConnection":
+        """Get (or open) the calling thread's connection."""
+        holder = getattr(self._local, "holder", None)
+        if holder is None:
+            conn = sqlite3.connect(
+                self.db_path, 
+                detect_types=sqlite3.PARSE_DECLTYPES,
+                timeout=30,  # Wait up to 30 seconds for locks
+                cached_statements=self.STATEMENT_CACHE_SIZE,
+                check_same_thread=False  # Only so close() can run anywhere
+            )
+            conn.row_factory = sqlite3.Row
+            
+            # Connection setup runs once per thread instead of per call.
+            # WAL gives concurrent readers; NORMAL sync is durable across
+            # crashes in WAL mode and only fsyncs at checkpoints.
+            conn.execute("PRAGMA journal_mode=WAL")
+            conn.execute("PRAGMA busy_timeout=30000")  # 30 second timeout
+            conn.execute("PRAGMA synchronous=NORMAL")
+            
+            holder = _ThreadConnection(conn)
+            self._local.holder = holder
+            with self._connections_lock:
+                self._connections.add(holder)
+        return holder
+    
     @contextmanager
     def _get_connection(self) -> Generator[sqlite3.Connection, None, None]:
-        """Context manager for database connections with WAL mode."""
-        conn = sqlite3.connect(
-            self.db_path, 
-            detect_types=sqlite3.PARSE_DECLTYPES,
-            timeout=30  # Wait up to 30 seconds for locks
-        )
-        conn.row_factory = sqlite3.Row
+        """
+        Context manager for the calling thread's connection.
         
-        # Enable WAL mode for better concurrent access
-        conn.execute("PRAGMA journal_mode=WAL")
-        conn.execute("PRAGMA busy_timeout=30000")  # 30 second timeout
+        Commits on exit unless a batch() is open on this thread, in which
+        case the work joins the batch's transaction.
+        """
+        holder = self._thread_connection()
+        conn = holder.conn
+        
+        if holder.depth:
+            with profile_stage("db"):
+                yield conn
+            return
         
         try:
-            yield conn
-            conn.commit()
+            with profile_stage("db"):
+                yield conn
+                conn.commit()
         except sqlite3.Error as e:
             conn.rollback()
             logger.error(f"Database error: {type(e).__name__}: {e}")
             raise
-        finally:
-            conn.close()
+    
+    @contextmanager
+    def batch(self) -> Generator["StemDatabase", None, None]:
+        """
+        Group this thread's writes into one transaction.
+        
+        Every StemDatabase call made on the same thread inside the block
+        shares a single commit (and fsync); an exception rolls all of it
+        back. Batches nest, committing when the outermost one exits.
+        Keep batches short: other writers wait while one is open.
+        
+        Example:
+            with db.batch():
+                db.add_quality_scores(job_id, scores)
+                db.update_job_status(job_id, JobStatus.COMPLETED)
+        """
+        holder = self._thread_connection()
+        holder.depth += 1
+        try:
+            yield self
+        except BaseException:
+            holder.depth -= 1
+            if not holder.depth:
+                holder.conn.rollback()
+            raise
+        holder.depth -= 1
+        if not holder.depth:
+            try:
+                with profile_stage("db"):
+                    holder.conn.commit()
+            except sqlite3.Error as e:
+                holder.conn.rollback()
+                logger.error(f"Database error: {type(e).__name__}: {e}")
+                raise
+    
+    def close(self) -> None:
+        """Close every thread's connection (further calls reopen them)."""
+        with self._connections_lock:
+            holders = list(self._connections)
+            self._connections = weakref.WeakSet()
+        for holder in holders:
+            holder.close()
+        self._local = threading.local()
+    
+    # Columns added after the first release: table -> [(column, type)]
+    MIGRATIONS = {
+        "tracks": [
+            ("file_size", "INTEGER"),
+            ("file_mtime_ns", "INTEGER"),
+            ("content_hash", "TEXT"),
+        ],
+        "jobs": [
+            ("lease_owner", "TEXT"),
+            ("lease_expires_at", "REAL"),
+            ("heartbeat_at", "REAL"),
+            ("attempts", "INTEGER NOT NULL DEFAULT 0"),
+        ],
+    }
     
     def _init_schema(self) -> None:
         """Initialize database schema."""
         with self._get_connection() as conn:
+            # Bring tables created by older versions up to date first so
+            # the schema's indexes can reference the new columns
+            self._migrate(conn)
             conn.executescript(self.SCHEMA)
     
+    def _migrate(self, conn: sqlite3.Connection) -> None:
+        """Add any columns missing from existing tables."""
+        for table, columns in self.MIGRATIONS.items():
+            existing = {
+                row['name'] for row in conn.execute(f"PRAGMA table_info({table})")
+            }
+            if not existing:
+                continue  # Table will be created by SCHEMA
+            for column, column_type in columns:
+                if column not in existing:
+                    conn.execute(f"ALTER TABLE {table} ADD COLUMN {column} {column_type}")
+    
     # -------------------------------------------------------------------------
     # Track Operations
     # -------------------------------------------------------------------------
     
     def add_track(self, file_path: str, file_hash: str, artist: str = "",
                   title: str = "", bpm: Optional[float] = None,
-                  key: Optional[str] = None, genre: Optional[str] = None) -> int:
+                  key: Optional[str] = None, genre: Optional[str] = None,
+                  file_size: Optional[int] = None,
+                  file_mtime_ns: Optional[int] = None,
+                  content_hash: Optional[str] = None) -> int:
         """
         Add a new track to the database.
         
@@ -171,13 +334,39 @@ class StemDatabase:
         with self._get_connection() as conn:
             cursor = conn.execute(
                 """
-                INSERT INTO tracks (file_path, file_hash, artist, title, bpm, key, genre)
-                VALUES (?, ?, ?, ?, ?, ?, ?)
+                INSERT INTO tracks (file_path, file_hash, artist, title, bpm, key, genre,
+                                    file_size, file_mtime_ns, content_hash)
+                VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
                 """,
-                (file_path, file_hash, artist, title, bpm, key, genre)
+                (file_path, file_hash, artist, title, bpm, key, genre,
+                 file_size, file_mtime_ns, content_hash)
             )
             return cursor.lastrowid
     
+    @staticmethod
+    def _track_record(row: sqlite3.Row) -> TrackRecord:
+        """Convert a tracks row to a TrackRecord."""
+        return TrackRecord(
+            id=row['id'],
+            file_path=row['file_path'],
+            file_hash=row['file_hash'],
+            artist=row['artist'],
+            title=row['title'],
+            bpm=row['bpm'],
+            key=row['key'],
+            genre=row['genre'],
+            created_at=row['created_at'],
+            file_size=row['file_size'],
+            file_mtime_ns=row['file_mtime_ns'],
+            content_hash=row['content_hash']
+        )
+    
+    def get_track(self, track_id: int) -> Optional[TrackRecord]:
+        """Get a track by ID."""
+        with self._get_connection() as conn:
+            row = conn.execute("SELECT * FROM tracks WHERE id = ?", (track_id,)).fetchone()
+            return self._track_record(row) if row else None
+    
     def get_track_by_hash(self, file_hash: str) -> Optional[TrackRecord]:
         """Get a track by its file hash."""
         with self._get_connection() as conn:
@@ -187,19 +376,18 @@ class StemDatabase:
             ).fetchone()
             
             if row:
-                return TrackRecord(
-                    id=row['id'],
-                    file_path=row['file_path'],
-                    file_hash=row['file_hash'],
-                    artist=row['artist'],
-                    title=row['title'],
-                    bpm=row['bpm'],
-                    key=row['key'],
-                    genre=row['genre'],
-                    created_at=row['created_at']
-                )
+                return self._track_record(row)
         return None
     
+    def get_track_by_path(self, file_path: str) -> Optional[TrackRecord]:
+        """Get the most recently added track for a (resolved) file path."""
+        with self._get_connection() as conn:
+            row = conn.execute(
+                "SELECT * FROM tracks WHERE file_path = ? ORDER BY id DESC LIMIT 1",
+                (file_path,)
+            ).fetchone()
+            return self._track_record(row) if row else None
+    
     def track_exists(self, file_hash: str) -> bool:
         """Check if a track with the given hash exists."""
         with self._get_connection() as conn:
@@ -209,6 +397,53 @@ class StemDatabase:
             ).fetchone()
             return row is not None
     
+    def get_file_hashes(self, file_path: str, file_size: int,
+                        file_mtime_ns: int) -> Optional[dict[str, str]]:
+        """
+        Get digests stored for a file, if it is unchanged since they were taken.
+        
+        Returns:
+            Dict with 'quick' and/or 'content' hashes, or None if unknown
+        """
+        with self._get_connection() as conn:
+            row = conn.execute(
+                """
+                SELECT file_hash, content_hash FROM tracks
+                WHERE file_path = ? AND file_size = ? AND file_mtime_ns = ?
+                LIMIT 1
+                """,
+                (file_path, file_size, file_mtime_ns)
+            ).fetchone()
+            
+            if row is None:
+                return None
+            hashes = {"quick": row['file_hash']}
+            if row['content_hash']:
+                hashes["content"] = row['content_hash']
+            return hashes
+    
+    def record_file_hashes(self, file_path: str, file_size: int, file_mtime_ns: int,
+                           file_hash: Optional[str] = None,
+                           content_hash: Optional[str] = None) -> None:
+        """
+        Store size/mtime and content hash on the track row for a file.
+        
+        Only the row whose quick hash matches is updated, so a row for an
+        older version of the file at the same path is left alone.
+        """
+        if file_hash is None:
+            return
+        with self._get_connection() as conn:
+            conn.execute(
+                """
+                UPDATE tracks
+                SET file_size = ?, file_mtime_ns = ?,
+                    content_hash = COALESCE(?, content_hash)
+                WHERE file_path = ? AND file_hash = substr(?, 1, length(file_hash))
+                """,
+                (file_size, file_mtime_ns, content_hash, file_path, file_hash)
+            )
+    
     # -------------------------------------------------------------------------
     # Job Operations
     # -------------------------------------------------------------------------
@@ -233,19 +468,55 @@ class StemDatabase:
     def update_job_status(self, job_id: int, status: JobStatus,
                           processing_time: Optional[float] = None,
                           error_message: Optional[str] = None) -> None:
-        """Update job status and optionally processing time/error."""
+        """
+        Update job status and optionally processing time/error.
+        
+        Finishing a job (COMPLETED/FAILED) also releases its lease.
+        """
         with self._get_connection() as conn:
-            completed_at = datetime.now() if status in (JobStatus.COMPLETED, JobStatus.FAILED) else None
+            finished = status in (JobStatus.COMPLETED, JobStatus.FAILED)
+            completed_at = datetime.now() if finished else None
             
             conn.execute(
                 """
                 UPDATE jobs 
-                SET status = ?, processing_time_seconds = ?, error_message = ?, completed_at = ?
+                SET status = ?, processing_time_seconds = ?, error_message = ?, completed_at = ?,
+                    lease_owner = CASE WHEN ? THEN NULL ELSE lease_owner END,
+                    lease_expires_at = CASE WHEN ? THEN NULL ELSE lease_expires_at END
                 WHERE id = ?
                 """,
-                (status.value, processing_time, error_message, completed_at, job_id)
+                (status.value, processing_time, error_message, completed_at,
+                 finished, finished, job_id)
+            )
+    
+    def start_job(self, job_id: int, engine: str) -> None:
+        """Mark a queued job as processing on the engine that was selected."""
+        with self._get_connection() as conn:
+            conn.execute(
+                "UPDATE jobs SET engine = ?, status = ? WHERE id = ?",
+                (engine, JobStatus.PROCESSING.value, job_id)
             )
     
+    @staticmethod
+    def _job_record(row: sqlite3.Row) -> JobRecord:
+        """Convert a jobs row to a JobRecord."""
+        return JobRecord(
+            id=row['id'],
+            track_id=row['track_id'],
+            engine=row['engine'],
+            status=JobStatus(row['status']),
+            processing_time_seconds=row['processing_time_seconds'],
+            error_message=row['error_message'],
+            created_at=row['created_at'],
+            completed_at=row['completed_at']
+        )
+    
+    def get_job(self, job_id: int) -> Optional[JobRecord]:
+        """Get a job by ID."""
+        with self._get_connection() as conn:
+            row = conn.execute("SELECT * FROM jobs WHERE id = ?", (job_id,)).fetchone()
+            return self._job_record(row) if row else None
+    
     def get_latest_job_for_track(self, track_id: int) -> Optional[JobRecord]:
         """Get the most recent job for a track."""
         with self._get_connection() as conn:
@@ -260,16 +531,7 @@ class StemDatabase:
             ).fetchone()
             
             if row:
-                return JobRecord(
-                    id=row['id'],
-                    track_id=row['track_id'],
-                    engine=row['engine'],
-                    status=JobStatus(row['status']),
-                    processing_time_seconds=row['processing_time_seconds'],
-                    error_message=row['error_message'],
-                    created_at=row['created_at'],
-                    completed_at=row['completed_at']
-                )
+                return self._job_record(row)
         return None
     
     def has_successful_job(self, file_hash: str) -> bool:
@@ -286,6 +548,203 @@ class StemDatabase:
             ).fetchone()
             return row is not None
     
+    # -------------------------------------------------------------------------
+    # Job Queue Operations
+    # -------------------------------------------------------------------------
+    
+    # A job can be claimed from the queue when it is pending, or when it
+    # was claimed but its worker stopped renewing the lease
+    _CLAIMABLE = """
+        (status = 'pending'
+         OR (status = 'processing' AND lease_owner IS NOT NULL AND lease_expires_at < ?))
+    """
+    
+    def enqueue_job(self, track_id: int, engine: str = "auto") -> int:
+        """
+        Queue a job for a track.
+        
+        Idempotent: a track that already has a pending job, or a
+        processing job under a lease, gets that job back instead of a
+        second one. Processing jobs without a lease were started by the
+        pipeline outside the queue and can never be claimed, so they are
+        not reused (a run killed outside the queue would otherwise leave
+        its track stuck).
+        
+        Args:
+            track_id: Track to process
+            engine: Engine preference, replaced by the selected engine's
+                name once the job starts
+        
+        Returns:
+            The ID of the queued job
+        """
+        with self._get_connection() as conn:
+            row = conn.execute(
+                """
+                SELECT id FROM jobs
+                WHERE track_id = ?
+                  AND (status = ? OR (status = ? AND lease_owner IS NOT NULL))
+                ORDER BY id DESC LIMIT 1
+                """,
+                (track_id, JobStatus.PENDING.value, JobStatus.PROCESSING.value)
+            ).fetchone()
+            if row:
+                return row['id']
+            cursor = conn.execute(
+                "INSERT INTO jobs (track_id, engine, status) VALUES (?, ?, ?)",
+                (track_id, engine, JobStatus.PENDING.value)
+            )
+            return cursor.lastrowid
+    
+    def claim_job(self, job_id: int, owner: str, lease_seconds: float,
+                  max_attempts: Optional[int] = None) -> bool:
+        """
+        Take the lease on a queued job.
+        
+        The claim is a single conditional UPDATE, so two workers (or two
+        processes) can never both win it. A job that has already been
+        claimed max_attempts times is marked failed instead, so a track
+        that keeps killing its worker doesn't wedge every resume.
+        
+        Args:
+            job_id: Job to claim
+            owner: Worker identity the lease is held under
+            lease_seconds: Lease length; renew with renew_leases()
+            max_attempts: Claims allowed before the job is abandoned
+        
+        Returns:
+            True if the lease is now held by owner
+        """
+        now = time.time()
+        with self._get_connection() as conn:
+            if max_attempts is not None:
+                conn.execute(
+                    f"""
+                    UPDATE jobs
+                    SET status = ?, error_message = ?, completed_at = ?,
+                        lease_owner = NULL, lease_expires_at = NULL
+                    WHERE id = ? AND attempts >= ? AND {self._CLAIMABLE}
+                    """,
+                    (JobStatus.FAILED.value, f"Abandoned after {max_attempts} attempts",
+                     datetime.now(), job_id, max_attempts, now)
+                )
+            cursor = conn.execute(
+                f"""
+                UPDATE jobs
+                SET status = ?, lease_owner = ?, lease_expires_at = ?,
+                    heartbeat_at = ?, attempts = attempts + 1
+                WHERE id = ? AND {self._CLAIMABLE}
+                """,
+                (JobStatus.PROCESSING.value, owner, now + lease_seconds, now, job_id, now)
+            )
+            return cursor.rowcount == 1
+    
+    def renew_leases(self, owner: str, lease_seconds: float) -> int:
+        """
+        Heartbeat: extend every lease held by owner.
+        
+        Returns:
+            Number of leases renewed
+        """
+        now = time.time()
+        with self._get_connection() as conn:
+            cursor = conn.execute(
+                """
+                UPDATE jobs SET lease_expires_at = ?, heartbeat_at = ?
+                WHERE lease_owner = ? AND status = ?
+                """,
+                (now + lease_seconds, now, owner, JobStatus.PROCESSING.value)
+            )
+            return cursor.rowcount
+    
+    def release_job(self, job_id: int, owner: str) -> None:
+        """Return a leased job to the queue without finishing it."""
+        with self._get_connection() as conn:
+            conn.execute(
+                """
+                UPDATE jobs SET status = ?, lease_owner = NULL, lease_expires_at = NULL
+                WHERE id = ? AND lease_owner = ? AND status = ?
+                """,
+                (JobStatus.PENDING.value, job_id, owner, JobStatus.PROCESSING.value)
+            )
+    
+    def finish_leased_job(self, job_id: int, owner: str, status: JobStatus,
+                          processing_time: Optional[float] = None,
+                          error_message: Optional[str] = None) -> bool:
+        """
+        Finish a job only if owner still holds its lease.
+        
+        A no-op when the job was already finished (e.g. by the pipeline)
+        or its lease passed to another worker.
+        
+        Returns:
+            True if the job was finished
+        """
+        with self._get_connection() as conn:
+            cursor = conn.execute(
+                """
+                UPDATE jobs
+                SET status = ?, processing_time_seconds = ?, error_message = ?,
+                    completed_at = ?, lease_owner = NULL, lease_expires_at = NULL
+                WHERE id = ? AND lease_owner = ? AND status = ?
+                """,
+                (status.value, processing_time, error_message, datetime.now(),
+                 job_id, owner, JobStatus.PROCESSING.value)
+            )
+            return cursor.rowcount == 1
+    
+    def abandon_unleased_job(self, job_id: int, error_message: str) -> bool:
+        """
+        Fail a job the pipeline started outside the queue, if still running.
+        
+        Such jobs have no lease that could expire, so an interrupted run
+        must finish them itself. Leased and finished jobs are left alone.
+        
+        Returns:
+            True if the job was failed
+        """
+        with self._get_connection() as conn:
+            cursor = conn.execute(
+                """
+                UPDATE jobs SET status = ?, error_message = ?, completed_at = ?
+                WHERE id = ? AND status = ? AND lease_owner IS NULL
+                """,
+                (JobStatus.FAILED.value, error_message, datetime.now(),
+                 job_id, JobStatus.PROCESSING.value)
+            )
+            return cursor.rowcount == 1
+    
+    def get_queued_jobs(self, root: Optional[str] = None) -> list[sqlite3.Row]:
+        """
+        Get claimable jobs with their track details.
+        
+        Cost is proportional to the number of queued jobs (served from
+        the status index), not the size of the library.
+        
+        Args:
+            root: Only jobs for tracks under this absolute directory
+        
+        Returns:
+            Rows with job_id, attempts, the track's columns and, if the
+            file was scanned, its library priority; highest priority first
+        """
+        query = f"""
+            SELECT j.id AS job_id, j.attempts, t.*, li.priority
+            FROM (SELECT id, track_id, attempts FROM jobs WHERE {self._CLAIMABLE}) j
+            JOIN tracks t ON t.id = j.track_id
+            LEFT JOIN library_index li ON li.file_path = t.file_path
+            WHERE 1
+        """
+        params: list = [time.time()]
+        if root is not None:
+            prefix = root.rstrip('/\\') + os.sep
+            query += " AND t.file_path >= ? AND t.file_path < ?"
+            params += [prefix, prefix[:-1] + chr(ord(prefix[-1]) + 1)]
+        query += " ORDER BY COALESCE(li.priority, 99), j.id"
+        
+        with self._get_connection() as conn:
+            return conn.execute(query, params).fetchall()
+    
     # -------------------------------------------------------------------------
     # Quality Score Operations
     # -------------------------------------------------------------------------
@@ -302,6 +761,19 @@ class StemDatabase:
             )
             return cursor.lastrowid
     
+    def add_quality_scores(self, job_id: int, scores: dict[str, float]) -> None:
+        """Add quality scores for several stems of a job in one statement."""
+        if not scores:
+            return
+        with self._get_connection() as conn:
+            conn.executemany(
+                """
+                INSERT INTO quality_scores (job_id, stem_name, si_sdr)
+                VALUES (?, ?, ?)
+                """,
+                [(job_id, stem_name, si_sdr) for stem_name, si_sdr in scores.items()]
+            )
+    
     def get_quality_scores(self, job_id: int) -> dict[str, float]:
         """Get all quality scores for a job."""
         with self._get_connection() as conn:
@@ -319,3 +791,148 @@ class StemDatabase:
                 (job_id,)
             ).fetchone()
             return row['avg_sdr'] if row and row['avg_sdr'] else None
+    
+    # -------------------------------------------------------------------------
+    # Library Index Operations
+    # -------------------------------------------------------------------------
+    
+    def get_library_index(self, root: str) -> dict[str, sqlite3.Row]:
+        """
+        Get every indexed file under a directory.
+        
+        Args:
+            root: Absolute directory path
+        
+        Returns:
+            Dictionary mapping file paths to library_index rows
+        """
+        prefix = root.rstrip('/\\') + os.sep
+        with self._get_connection() as conn:
+            # Range scan on the primary key instead of LIKE (paths may
+            # contain % and _)
+            rows = conn.execute(
+                "SELECT * FROM library_index WHERE file_path >= ? AND file_path < ?",
+                (prefix, prefix[:-1] + chr(ord(prefix[-1]) + 1))
+            ).fetchall()
+            return {row['file_path']: row for row in rows}
+    
+    def upsert_library_entries(self, entries: list[tuple]) -> None:
+        """
+        Insert or refresh library index rows in one transaction.
+        
+        Args:
+            entries: (file_path, file_size, file_mtime_ns, artist, title,
+                bpm, key, genre, priority) tuples
+        """
+        if not entries:
+            return
+        with self._get_connection() as conn:
+            conn.executemany(
+                """
+                INSERT INTO library_index
+                    (file_path, file_size, file_mtime_ns, artist, title,
+                     bpm, key, genre, priority, scanned_at)
+                VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, CURRENT_TIMESTAMP)
+                ON CONFLICT(file_path) DO UPDATE SET
+                    file_size = excluded.file_size,
+                    file_mtime_ns = excluded.file_mtime_ns,
+                    artist = excluded.artist,
+                    title = excluded.title,
+                    bpm = excluded.bpm,
+                    key = excluded.key,
+                    genre = excluded.genre,
+                    priority = excluded.priority,
+                    scanned_at = CURRENT_TIMESTAMP
+                """,
+                entries
+            )
+    
+    def remove_library_entries(self, file_paths: list[str]) -> None:
+        """Drop library index rows for files that no longer exist."""
+        if not file_paths:
+            return
+        with self._get_connection() as conn:
+            conn.executemany(
+                "DELETE FROM library_index WHERE file_path = ?",
+                [(path,) for path in file_paths]
+            )
+    
+    # -------------------------------------------------------------------------
+    # Engine Statistics
+    # -------------------------------------------------------------------------
+    
+    def get_engine_throughput(self, recent_jobs: int = 2000) -> dict[str, tuple[int, float, int]]:
+        """
+        Get separation time against file size per engine.
+        
+        Only completed jobs with a measured time among the last
+        `recent_jobs` jobs are counted (cached results take no time).
+        
+        Returns:
+            engine -> (jobs, total seconds, total bytes)
+        """
+        with self._get_connection() as conn:
+            rows = conn.execute(
+                """
+                SELECT j.engine, COUNT(*) AS jobs,
+                       SUM(j.processing_time_seconds) AS seconds,
+                       SUM(t.file_size) AS bytes
+                FROM jobs j JOIN tracks t ON t.id = j.track_id
+                WHERE j.status = ?
+                  AND j.processing_time_seconds > 0
+                  AND t.file_size > 0
+                  AND j.id > (SELECT COALESCE(MAX(id), 0) FROM jobs) - ?
+                GROUP BY j.engine
+                """,
+                (JobStatus.COMPLETED.value, recent_jobs)
+            ).fetchall()
+            return {
+                row['engine']: (row['jobs'], row['seconds'], row['bytes'])
+                for row in rows
+            }
+    
+    def get_job_counts(self) -> dict[str, int]:
+        """Get the number of jobs per status (served from the status index)."""
+        with self._get_connection() as conn:
+            rows = conn.execute(
+                "SELECT status, COUNT(*) AS jobs FROM jobs GROUP BY status"
+            ).fetchall()
+            return {row['status']: row['jobs'] for row in rows}
+    
+    def get_quality_failures(
+        self,
+        vocal_threshold: float,
+        stem_threshold: float,
+        recent_jobs: int = 2000
+    ) -> dict[tuple[str, Optional[str]], tuple[int, int]]:
+        """
+        Count how often jobs failed the quality gate, per engine and genre.
+        
+        A job fails when its vocals scored below vocal_threshold or any
+        other stem below stem_threshold (StemQualityAnalyzer.needs_reprocessing).
+        
+        Returns:
+            (engine, genre) -> (scored jobs, jobs that failed)
+        """
+        with self._get_connection() as conn:
+            rows = conn.execute(
+                """
+                SELECT engine, genre, COUNT(*) AS jobs, SUM(failed) AS failures
+                FROM (
+                    SELECT j.engine, t.genre,
+                           MAX(q.si_sdr < CASE WHEN q.stem_name = 'vocals'
+                                               THEN ? ELSE ? END) AS failed
+                    FROM quality_scores q
+                    JOIN jobs j ON j.id = q.job_id
+                    JOIN tracks t ON t.id = j.track_id
+                    WHERE j.id > (SELECT COALESCE(MAX(id), 0) FROM jobs) - ?
+                    GROUP BY j.id
+                )
+                GROUP BY engine, genre
+                """,
+                (vocal_threshold, stem_threshold, recent_jobs)
+            ).fetchall()
+            return {
+                (row['engine'], row['genre']): (row['jobs'], row['failures'])
+                for row in rows
+            }
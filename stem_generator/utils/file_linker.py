@@ -0,0 +1,232 @@
+"""
+File Linking for Stem Generation System
+
+Deduplicating placement of stem files: hardlink where possible, reflink
+(copy-on-write clone) next, and a plain copy only as a last resort.
+"""
+
+import hashlib
+import logging
+import os
+import shutil
+import tempfile
+from pathlib import Path
+from typing import Callable, Literal, Optional
+
+
+logger = logging.getLogger(__name__)
+
+LinkMethod = Literal["existing", "hardlink", "reflink", "copy"]
+
+# ioctl(FICLONE) request number on Linux (_IOW(0x94, 9, int))
+_FICLONE = 0x40049409
+
+# Copy buffer; large enough that USB mass storage sees long sequential
+# writes instead of per-64KB round trips
+COPY_BUFFER_BYTES = 8 * 1024 * 1024
+
+# FAT/exFAT store mtimes with 2 s resolution
+_MTIME_TOLERANCE_NS = 2_000_000_000
+
+# Called with the number of bytes just copied
+ProgressCallback = Callable[[int], None]
+
+
+def _same_file(a: Path, b: Path) -> bool:
+    """Check whether two paths already refer to the same inode."""
+    try:
+        return os.path.samefile(a, b)
+    except OSError:
+        return False
+
+
+def _reflink(src: Path, dst: Path) -> bool:
+    """Clone src to dst with FICLONE (Btrfs, XFS, bcachefs, ...)."""
+    try:
+        import fcntl
+    except ImportError:
+        return False  # Not on a POSIX platform
+    
+    try:
+        with open(src, 'rb') as fsrc, open(dst, 'wb') as fdst:
+            fcntl.ioctl(fdst.fileno(), _FICLONE, fsrc.fileno())
+        shutil.copystat(src, dst)
+        return True
+    except OSError:
+        dst.unlink(missing_ok=True)
+        return False
+
+
+def _device(path: Path) -> Optional[int]:
+    """st_dev of path, or of its nearest existing ancestor."""
+    for candidate in (path, *path.parents):
+        try:
+            return candidate.stat().st_dev
+        except OSError:
+            continue
+    return None
+
+
+def same_filesystem(a: Path, b: Path) -> bool:
+    """
+    Check whether two paths (existing or not) are on one filesystem.
+    
+    Hardlinks and reflinks never work across filesystems, so exports to
+    another device (a USB stick) go straight to copying.
+    """
+    dev_a, dev_b = _device(Path(a).absolute()), _device(Path(b).absolute())
+    return dev_a is not None and dev_a == dev_b
+
+
+def is_up_to_date(src: Path, dst: Path) -> bool:
+    """Check whether dst is an earlier copy of src (same size and mtime)."""
+    try:
+        s, d = Path(src).stat(), Path(dst).stat()
+    except OSError:
+        return False
+    return s.st_size == d.st_size and abs(s.st_mtime_ns - d.st_mtime_ns) <= _MTIME_TOLERANCE_NS
+
+
+def _hash_file(path: Path, buffer_size: int, drop_cache: bool) -> str:
+    """SHA-256 of a file, optionally reading past the page cache."""
+    digest = hashlib.sha256()
+    with open(path, 'rb', buffering=0) as f:
+        if drop_cache and hasattr(os, "posix_fadvise"):
+            # Make the read-back come from the device, not from the
+            # pages we just wrote
+            os.posix_fadvise(f.fileno(), 0, 0, os.POSIX_FADV_DONTNEED)
+        while chunk := f.read(buffer_size):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+
+def copy_file(
+    src: Path,
+    dst: Path,
+    verify: bool = False,
+    buffer_size: int = COPY_BUFFER_BYTES,
+    progress: Optional[ProgressCallback] = None
+) -> None:
+    """
+    Copy a file with a large buffer, optionally verifying the result.
+    
+    Data goes to a temporary file next to dst that is fsynced and renamed
+    into place, so an interrupted copy (a stick pulled mid-export) never
+    leaves a truncated stem under the final name. With verify, the copy
+    is read back from the device and compared with a digest taken while
+    reading src.
+    
+    Args:
+        src: Existing file
+        dst: Destination path (replaced if it exists)
+        verify: Read the copy back and compare digests
+        buffer_size: Read/write chunk size in bytes
+        progress: Called with the byte count of each chunk written
+    
+    Raises:
+        OSError: If the copy fails or doesn't match the source
+    """
+    src, dst = Path(src), Path(dst)
+    dst.parent.mkdir(parents=True, exist_ok=True)
+    
+    fd, tmp_name = tempfile.mkstemp(dir=dst.parent, prefix=f".{dst.name}.")
+    tmp = Path(tmp_name)
+    digest = hashlib.sha256()
+    try:
+        with open(src, 'rb', buffering=0) as fsrc, os.fdopen(fd, 'wb', buffering=0) as fdst:
+            buffer = bytearray(buffer_size)
+            view = memoryview(buffer)
+            while n := fsrc.readinto(buffer):
+                digest.update(view[:n])
+                fdst.write(view[:n])
+                if progress is not None:
+                    progress(n)
+            fdst.flush()
+            os.fsync(fdst.fileno())
+        shutil.copystat(src, tmp)
+        
+        if verify and _hash_file(tmp, buffer_size, drop_cache=True) != digest.hexdigest():
+            raise OSError(f"Verification failed: {dst} does not match {src}")
+        
+        os.replace(tmp, dst)
+    except BaseException:
+        tmp.unlink(missing_ok=True)
+        raise
+
+
+def prepare_output(path: Path) -> Path:
+    """
+    Make a path safe to (re)write.
+    
+    Creates the parent directory and unlinks any existing file, so a
+    rewrite never modifies an inode that is hardlinked into the cache or
+    a DJ library export. Every stem writer should call this before
+    opening its output.
+    
+    Args:
+        path: File about to be written
+    
+    Returns:
+        The same path
+    """
+    path = Path(path)
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.unlink(missing_ok=True)
+    return path
+
+
+def link_or_copy(
+    src: Path,
+    dst: Path,
+    allow_hardlink: bool = True,
+    verify: bool = False,
+    progress: Optional[ProgressCallback] = None
+) -> LinkMethod:
+    """
+    Place src at dst, sharing storage wherever the filesystem allows.
+    
+    Hardlinks cost no space but tie both names to one inode; reflinks
+    also cost no space until either side is modified and are fully
+    independent files. Writers must not modify a hardlinked file in
+    place (see prepare_output).
+    
+    Across filesystems no linking is attempted: an earlier copy with the
+    same size and mtime is kept, anything else is copied with copy_file.
+    
+    Args:
+        src: Existing file
+        dst: Destination path (replaced if it exists)
+        allow_hardlink: Set False when dst may be edited in place by
+            other software (reflink/copy only)
+        verify: Read copies back and compare them with src
+        progress: Called with byte counts as a copy proceeds
+    
+    Returns:
+        How dst was created: "existing" (already in place), "hardlink",
+        "reflink" or "copy"
+    """
+    src, dst = Path(src), Path(dst)
+    
+    if _same_file(src, dst):
+        return "existing"
+    
+    if not same_filesystem(src, dst):
+        if is_up_to_date(src, dst):
+            return "existing"
+        copy_file(src, dst, verify=verify, progress=progress)
+        return "copy"
+    
+    prepare_output(dst)
+    
+    if allow_hardlink:
+        try:
+            os.link(src, dst)
+            return "hardlink"
+        except OSError:
+            pass  # Cross-device, unsupported filesystem or link limit
+    
+    if _reflink(src, dst):
+        return "reflink"
+    
+    copy_file(src, dst, verify=verify, progress=progress)
+    return "copy"
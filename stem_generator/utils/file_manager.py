@@ -4,7 +4,6 @@ File Manager for Stem Generation System
 Handles standardized input/output paths for stem separation.
 """
 
-import hashlib
 import logging
 import os
 import re
@@ -14,6 +13,8 @@ from typing import Optional
 
 import music_tag
 
+from .audio_io import find_stem_file, get_stem_format
+from .content_hash import ContentHasher, get_default_hasher
 
 logger = logging.getLogger(__name__)
 
@@ -40,17 +41,29 @@ class StemFileManager:
             ├── bass.wav
             ├── other.wav
             └── metadata.json
+    
+    Stems use the extension of the configured stem format (.wav or
+    .flac); lookups find existing stems in any supported format.
     """
     
     STEM_NAMES = ["vocals", "drums", "bass", "other"]
     
-    def __init__(self, base_dir: str = "data/stems"):
+    def __init__(
+        self,
+        base_dir: str = "data/stems",
+        hasher: Optional[ContentHasher] = None,
+        stem_format: Optional[str] = None
+    ):
         """
         Initialize the file manager.
         
         Args:
             base_dir: Base directory for stem output (relative or absolute)
+            hasher: Shared ContentHasher (defaults to the process-wide one)
+            stem_format: Format new stems are written in ('wav', 'wav24', 'flac')
         """
+        self.hasher = hasher or get_default_hasher()
+        self.stem_format = get_stem_format(stem_format)
         self.base_dir = Path(base_dir).resolve()  # Use absolute path
         self.base_dir.mkdir(parents=True, exist_ok=True)
         logger.debug(f"File manager initialized with base_dir: {self.base_dir}")
@@ -59,7 +72,9 @@ class StemFileManager:
         """
         Calculate SHA-256 hash of a file (first 1MB for speed).
         
-        Uses SHA-256 for stronger collision resistance than MD5.
+        Uses SHA-256 for stronger collision resistance than MD5. Memoized
+        per (path, size, mtime) by the shared ContentHasher, so repeated
+        lookups for the same track don't re-read the file.
         
         Args:
             file_path: Path to the audio file
@@ -68,12 +83,7 @@ class StemFileManager:
         Returns:
             Truncated SHA-256 hash string
         """
-        hasher = hashlib.sha256()
-        with open(file_path, 'rb') as f:
-            # Read first 1MB for speed on large files
-            chunk = f.read(1024 * 1024)
-            hasher.update(chunk)
-        return hasher.hexdigest()[:length]
+        return self.hasher.quick_hash(file_path, length)
     
     def extract_metadata(self, file_path: str | Path) -> TrackMetadata:
         """
@@ -180,13 +190,20 @@ class StemFileManager:
             stem_name: One of 'vocals', 'drums', 'bass', 'other'
             
         Returns:
-            Path to the stem wav file
+            Path to the existing stem file, or where a new one would be
+            written in the configured format
         """
         if stem_name not in self.STEM_NAMES:
             raise ValueError(f"Invalid stem name: {stem_name}. Must be one of {self.STEM_NAMES}")
             
         output_dir = self.get_output_dir(file_path)
-        return output_dir / f"{stem_name}.wav"
+        return self._stem_path(output_dir, stem_name)
+    
+    def _stem_path(self, output_dir: Path, stem_name: str) -> Path:
+        """Resolve a stem in an output directory (existing file first)."""
+        return find_stem_file(output_dir, stem_name) or (
+            output_dir / f"{stem_name}{self.stem_format.extension}"
+        )
     
     def get_all_stem_paths(self, file_path: str | Path) -> dict[str, Path]:
         """
@@ -199,7 +216,7 @@ class StemFileManager:
             Dictionary mapping stem names to their file paths
         """
         output_dir = self.get_output_dir(file_path)
-        return {stem: output_dir / f"{stem}.wav" for stem in self.STEM_NAMES}
+        return {stem: self._stem_path(output_dir, stem) for stem in self.STEM_NAMES}
     
     def stems_exist(self, file_path: str | Path) -> bool:
         """